@@ -0,0 +1,229 @@
+#include "analyzer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+
+#include "event_loop.h"
+#include "hal.h"
+#include "hal_adc.h"
+#include "sweep.h"
+
+#include "pico-ssd1306/shapeRenderer/ShapeRenderer.h"
+#include "pico-ssd1306/ssd1306.h"
+#include "pico-ssd1306/textRenderer/TextRenderer.h"
+#include "pico/stdio.h"
+
+extern "C" {
+#include "si5351/si5351.h"
+}
+
+// ADC inputs of the bridge detectors
+#define ANALYZER_INPUT_FORWARD 0
+#define ANALYZER_INPUT_REFLECTED 1
+
+// Plot area below the text line; SWR 1 on the bottom row, ANALYZER_PLOT_MAX_X100 on the top
+#define ANALYZER_PLOT_TOP 10
+#define ANALYZER_PLOT_BOTTOM 63
+#define ANALYZER_PLOT_MAX_X100 400
+
+namespace vfo_analyzer
+{
+
+vfo_link::Mailbox<Curve> curves;
+
+namespace
+{
+
+static_assert(std::has_single_bit(uint32_t(ANALYZER_SAMPLES)) && ANALYZER_SAMPLES >= 4);
+static_assert(ANALYZER_MAX_POINTS <= SWEEP_MAX_POINTS);
+
+// Sum of ANALYZER_SAMPLES to average in quarter codes
+constexpr uint32_t q2_shift = std::countr_zero(uint32_t(ANALYZER_SAMPLES)) - 2;
+
+uint16_t samples[ANALYZER_SAMPLES * 2];
+bool adc_ready = false;
+
+Curve curve = {};
+uint32_t zero_forward_q2 = 0;
+uint32_t zero_reflected_q2 = 0;
+uint32_t started_us = 0;
+bool unreported = false;
+
+AnalyzerStats stats = {};
+
+// Both detectors, averaged, in quarter codes
+void measure(uint32_t& forward_q2, uint32_t& reflected_q2)
+{
+    hal_adc_read(samples, ANALYZER_SAMPLES * 2);
+    uint32_t forward = 0;
+    uint32_t reflected = 0;
+    for (uint32_t i = 0; i < ANALYZER_SAMPLES; i++)
+    {
+        forward += samples[i * 2];
+        reflected += samples[i * 2 + 1];
+    }
+    forward_q2 = forward >> q2_shift;
+    reflected_q2 = reflected >> q2_shift;
+}
+
+void on_step(uint32_t index, uint32_t, void*)
+{
+    uint32_t forward_q2;
+    uint32_t reflected_q2;
+    measure(forward_q2, reflected_q2);
+    forward_q2 = forward_q2 > zero_forward_q2 ? forward_q2 - zero_forward_q2 : 0;
+    reflected_q2 = reflected_q2 > zero_reflected_q2 ? reflected_q2 - zero_reflected_q2 : 0;
+
+    uint16_t swr = uint16_t(swr_x100(forward_q2, reflected_q2));
+    curve.swr_x100[index] = swr;
+    if (swr < curve.swr_x100[curve.min_index])
+    {
+        curve.min_index = uint16_t(index);
+    }
+
+    if (index + 1 == curve.count)
+    {
+        stats.analyses++;
+        stats.last_us = hal_time_us() - started_us;
+        unreported = true;
+        curves.publish(curve);
+        vfo_loop::post_wake(vfo_loop::WAKE_RADIO);
+    }
+}
+
+uint8_t plot_y(uint32_t swr)
+{
+    uint32_t above = std::min<uint32_t>(swr, ANALYZER_PLOT_MAX_X100) - std::min<uint32_t>(swr, 100);
+    return uint8_t(ANALYZER_PLOT_BOTTOM - above * (ANALYZER_PLOT_BOTTOM - ANALYZER_PLOT_TOP) / (ANALYZER_PLOT_MAX_X100 - 100));
+}
+
+} // namespace
+
+bool start(uint32_t start_hz, uint32_t stop_hz, uint32_t points)
+{
+#if VFO_RX_DEMOD
+    // The capture has the ADC
+    (void)start_hz;
+    (void)stop_hz;
+    (void)points;
+    return false;
+#else
+    if (vfo_sweep::active() || points < 2 || points > ANALYZER_MAX_POINTS || stop_hz <= start_hz)
+    {
+        return false;
+    }
+    uint32_t step_hz = (stop_hz - start_hz) / (points - 1);
+    if (!vfo_sweep::prepare({ start_hz, start_hz + step_hz * (points - 1), step_hz }))
+    {
+        return false;
+    }
+    if (!adc_ready)
+    {
+        adc_ready = hal_adc_start(1u << ANALYZER_INPUT_FORWARD | 1u << ANALYZER_INPUT_REFLECTED);
+        if (!adc_ready)
+        {
+            return false;
+        }
+    }
+
+    started_us = hal_time_us();
+    curve.seq++;
+    curve.start_hz = start_hz;
+    curve.step_hz = step_hz;
+    curve.count = uint16_t(points);
+    curve.min_index = 0;
+    std::fill(std::begin(curve.swr_x100), std::end(curve.swr_x100), uint16_t(ANALYZER_SWR_MAX_X100));
+    unreported = false;
+
+    // Detector offsets with no RF on the bridge; the first point is set up before it comes back
+    si5351_output_enable(SI5351_CLK0, 0);
+    measure(zero_forward_q2, zero_reflected_q2);
+    stats.zero_forward_q2 = zero_forward_q2;
+    stats.zero_reflected_q2 = zero_reflected_q2;
+
+    bool started = vfo_sweep::start(ANALYZER_PERIOD_US, on_step, nullptr);
+    si5351_output_enable(SI5351_CLK0, 1);
+    return started;
+#endif
+}
+
+void report()
+{
+    if (!unreported)
+    {
+        return;
+    }
+    unreported = false;
+
+    char line[48];
+    for (uint32_t i = 0; i < curve.count; i++)
+    {
+        int len = snprintf(line, sizeof(line), "#A %lu %u", (unsigned long)(curve.start_hz + i * curve.step_hz),
+            unsigned(curve.swr_x100[i]));
+        stdio_put_string(line, len, true, false);
+    }
+    int len = snprintf(line, sizeof(line), "#A min %lu %u",
+        (unsigned long)(curve.start_hz + curve.min_index * curve.step_hz), unsigned(curve.swr_x100[curve.min_index]));
+    stdio_put_string(line, len, true, false);
+    stdio_put_string("#A end", 6, true, false);
+}
+
+void draw_curve(pico_ssd1306::SSD1306& display, const Curve& curve)
+{
+    using namespace pico_ssd1306;
+
+    display.clear();
+
+    // Lowest SWR and where, across the top
+    uint32_t min_hz = curve.start_hz + curve.min_index * curve.step_hz;
+    uint32_t min_swr = curve.swr_x100[curve.min_index];
+    char text[24];
+    if (min_swr >= ANALYZER_SWR_MAX_X100)
+    {
+        snprintf(text, sizeof(text), "SWR high");
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "SWR %lu.%02lu %lu.%04lu MHz", (unsigned long)(min_swr / 100),
+            (unsigned long)(min_swr % 100), (unsigned long)(min_hz / 1000000), (unsigned long)(min_hz % 1000000 / 100));
+    }
+    drawText(&display, font_5x8, text, 0, 0);
+
+    // Dotted rules at SWR 2 and 3
+    for (uint32_t swr = 200; swr < ANALYZER_PLOT_MAX_X100; swr += 100)
+    {
+        for (int16_t x = 0; x < 128; x += 4)
+        {
+            display.setPixel(x, plot_y(swr));
+        }
+    }
+
+    // Points spread across the width, joined
+    uint8_t last_x = 0;
+    uint8_t last_y = plot_y(curve.swr_x100[0]);
+    for (uint32_t i = 1; i < curve.count; i++)
+    {
+        uint8_t x = uint8_t(i * 127 / (curve.count - 1));
+        uint8_t y = plot_y(curve.swr_x100[i]);
+        drawLine(&display, last_x, last_y, x, y);
+        last_x = x;
+        last_y = y;
+    }
+
+    // Dotted marker down through the minimum
+    int16_t min_x = int16_t(curve.min_index * 127 / (curve.count - 1));
+    for (int16_t y = ANALYZER_PLOT_TOP; y <= ANALYZER_PLOT_BOTTOM; y += 2)
+    {
+        display.setPixel(min_x, y);
+    }
+
+    display.sendBuffer();
+}
+
+AnalyzerStats get_analyzer_stats()
+{
+    return stats;
+}
+
+} // namespace vfo_analyzer
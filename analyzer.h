@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+
+#include "core_link.h"
+
+namespace pico_ssd1306
+{
+class SSD1306;
+}
+
+// Scalar antenna analyzer: CLK0 drives a return-loss bridge whose forward and
+// reflected detectors sit on ADC inputs 0 and 1 (GPIO 26 and 27, the capture
+// inputs, so not with VFO_RX_DEMOD). start() reads the detector offsets with
+// the output off, then runs a sweep (sweep.h); each point is measured from a
+// DMA burst of both detectors, averaged, and turned into SWR in fixed point.
+// 100 points take ANALYZER_PERIOD_US each, 250 ms in all.
+//
+// The finished curve is published to curves for the display, and written to
+// the CAT port as "#A" lines. Nothing is drawn while the sweep runs: a display
+// frame holds the bus for longer than the whole sweep.
+namespace vfo_analyzer
+{
+
+#define ANALYZER_POINTS 100 // Default for a band
+#define ANALYZER_MAX_POINTS 128 // One per display column
+#define ANALYZER_PERIOD_US 2500 // A 9 byte burst, then 625 us to settle and sample
+#define ANALYZER_SAMPLES 64 // Per detector and point, 256 us at 500 ksps
+#define ANALYZER_SWR_MAX_X100 9999 // Open, shorted, or no signal
+
+struct Curve
+{
+    uint32_t seq; // Numbers the analyses
+    uint32_t start_hz;
+    uint32_t step_hz;
+    uint16_t count;
+    uint16_t min_index; // Lowest SWR, first of equals
+    uint16_t swr_x100[ANALYZER_MAX_POINTS];
+};
+
+struct AnalyzerStats
+{
+    uint32_t analyses; // Run to the end
+    uint32_t zero_forward_q2; // Detector offsets from the last start, in quarter codes
+    uint32_t zero_reflected_q2;
+    uint32_t last_us; // Start to the last point, including the offsets
+};
+
+// SWR x100 from the detector levels above their offsets: gamma is
+// reflected/forward in Q16, SWR = (1 + gamma) / (1 - gamma)
+inline uint32_t swr_x100(uint32_t forward_q2, uint32_t reflected_q2)
+{
+    if (forward_q2 == 0 || reflected_q2 >= forward_q2)
+    {
+        return ANALYZER_SWR_MAX_X100;
+    }
+    // Detector levels are under 2^14 in Q2, so the shift fits
+    uint32_t gamma_q16 = (reflected_q2 << 16) / forward_q2;
+    uint32_t swr = 100 * (65536 + gamma_q16) / (65536 - gamma_q16);
+    return swr < ANALYZER_SWR_MAX_X100 ? swr : ANALYZER_SWR_MAX_X100;
+}
+
+extern vfo_link::Mailbox<Curve> curves;
+
+// Radio loop, which owns the synthesizer: sweep points evenly from start_hz
+// to stop_hz. False if a sweep is running, the plan does not fit or the ADC
+// is not free. The radio loop services the sweep and tunes back at the end.
+bool start(uint32_t start_hz, uint32_t stop_hz, uint32_t points);
+
+// Radio loop, once the sweep has stopped: write the curve to the CAT port if
+// it was run to the end and has not been written yet
+void report();
+
+// Whole-screen plot of SWR 1 to 4 with the minimum marked and written out
+void draw_curve(pico_ssd1306::SSD1306& display, const Curve& curve);
+
+AnalyzerStats get_analyzer_stats();
+
+} // namespace vfo_analyzer
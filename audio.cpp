@@ -1,5 +1,9 @@
 #include "audio.h"
+#include "dsp.h"
+#include "keyer.h"
+#include "placement.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdio>
 
@@ -9,6 +13,10 @@
 #define DATA 15
 #define BCLK 13
 
+// Keyer paddles, active low
+#define KEYER_DIT 6
+#define KEYER_DAH 7
+
 audio_buffer_pool* ap = nullptr;
 
 namespace vfo_audio
@@ -20,9 +28,28 @@ uint32_t pos = 0;
 uint32_t pos_max = 0x10000 * SINE_WAVE_TABLE_LEN;
 uint vol = 128;
 
-#define SAMPLES_PER_BUFFER 256
-
+// Filled at start up, so it is in SRAM with or without VFO_RAM_HOT
 static int16_t sine_wave_table[SINE_WAVE_TABLE_LEN];
+static Keyer keyer;
+
+// Set while another producer (the demodulator) owns the output pool
+static volatile bool external_source = false;
+
+// Published by the loop that fills the output (core 1 with VFO_DUAL_CORE) for
+// the main loop, which must not look at the keyer itself
+static std::atomic<bool> output_silent = true;
+
+// Output processing; vol is 1/256 steps, the gain stage is Q4.12
+static vfo_dsp::Pipeline output_chain {
+    vfo_dsp::Gain(vol << 4),
+    vfo_dsp::Limiter(vfo_dsp::q15(0.9))
+};
+
+Keyer& get_keyer()
+{
+    return keyer;
+}
+
 bool start_audio()
 {
     // gpio_set_function(BCLK, GPIO_FUNC_SIO);
@@ -36,14 +63,18 @@ bool start_audio()
     {
         sine_wave_table[i] = 32767 * cosf(i * 2 * (float)(M_PI / SINE_WAVE_TABLE_LEN));
     }
-    ap = init_audio(44100, DATA, BCLK, 0, 0);
+
+    hal_gpio_input(KEYER_DIT, true);
+    hal_gpio_input(KEYER_DAH, true);
+    keyer.init(AUDIO_SAMPLE_RATE);
+
+    ap = init_audio(AUDIO_SAMPLE_RATE, DATA, BCLK, 0, 0);
     return ap != nullptr;
 }
 
-int16_t get_audio_frame()
+int16_t HOT_FUNC(get_audio_frame)()
 {
-    auto v = (vol * sine_wave_table[pos >> 16u]) >> 8u;
-    v += 0x7FFF;
+    auto v = sine_wave_table[pos >> 16u];
     pos += step;
     if (pos >= pos_max)
     {
@@ -52,61 +83,89 @@ int16_t get_audio_frame()
     return v;
 }
 
-void update_audio_buffer()
+// Sidetone block: the keyer shapes the tone, so key timing is counted in samples
+// and does not depend on when the block gets filled.
+void HOT_FUNC(render_sidetone)(int16_t* samples, uint32_t count)
 {
-    update_buffer(ap, get_audio_frame);
-}
-} // namespace vfo_audio
+    for (uint32_t i = 0; i < count; i++)
+    {
+        samples[i] = get_audio_frame();
+    }
 
-typedef int16_t (*buffer_callback)(void);
+    keyer.set_paddles(!hal_gpio_get(KEYER_DIT), !hal_gpio_get(KEYER_DAH));
+    keyer.process(samples, count);
+}
 
-struct audio_buffer_pool* init_audio(uint32_t sample_rate, uint8_t pin_data, uint8_t pin_bclk, uint8_t pio_sm, uint8_t dma_ch)
+void HOT_FUNC(finish_block)(int16_t* samples, uint32_t count)
 {
-    static audio_format_t audio_format = {
-        .sample_freq = sample_rate,
-        .format = AUDIO_BUFFER_FORMAT_PCM_S16,
-        .channel_count = 1,
-    };
+    output_chain.process(samples, count);
 
-    static struct audio_buffer_format producer_format = {
-        .format = &audio_format,
-        .sample_stride = 2
-    };
+    for (uint32_t i = 0; i < count; i++)
+    {
+        samples[i] += 0x7FFF;
+    }
+}
 
-    struct audio_buffer_pool* producer_pool = audio_new_producer_pool(
-        &producer_format,
-        3,
-        SAMPLES_PER_BUFFER);
+void HOT_FUNC(fill_audio_block)(int16_t* samples, uint32_t count)
+{
+    render_sidetone(samples, count);
+    finish_block(samples, count);
+    output_silent.store(!keyer.busy(), std::memory_order_relaxed);
+}
 
-    const struct audio_format* output_format;
+void set_external_source(bool external)
+{
+    external_source = external;
+    output_silent.store(!external && !keyer.busy(), std::memory_order_relaxed);
+}
 
-    struct audio_i2s_config config = {
-        .data_pin = pin_data,
-        .clock_pin_base = pin_bclk,
-        .dma_channel = dma_ch,
-        .pio_sm = pio_sm,
-    };
+audio_buffer_pool* get_audio_pool()
+{
+    return ap;
+}
 
-    output_format = audio_i2s_setup(&audio_format, &config);
-    if (!output_format)
+bool is_output_silent()
+{
+    return output_silent.load(std::memory_order_relaxed);
+}
+
+void update_audio_buffer()
+{
+    if (external_source)
     {
-        panic("PicoAudio: Unable to open audio device.\n");
+        return;
     }
 
-    bool status = audio_i2s_connect(producer_pool);
-    if (!status)
+    // Top up every free buffer, the loop may have slept through more than one
+    while (update_buffer_block(ap, fill_audio_block))
     {
-        panic("PicoAudio: Unable to connect to audio device.\n");
     }
+}
+} // namespace vfo_audio
 
-    audio_i2s_set_enabled(true);
+struct audio_buffer_pool* init_audio(uint32_t sample_rate, uint8_t pin_data, uint8_t pin_bclk, uint8_t pio_sm, uint8_t dma_ch)
+{
+    hal_audio_config_t config = {
+        .sample_rate = sample_rate,
+        .buffer_count = 3,
+        .buffer_samples = SAMPLES_PER_BUFFER,
+        .pin_data = pin_data,
+        .pin_bclk = pin_bclk,
+        .pio_sm = pio_sm,
+        .dma_channel = dma_ch,
+    };
 
+    struct audio_buffer_pool* producer_pool = hal_audio_start(&config);
+    if (!producer_pool)
+    {
+        panic("PicoAudio: Unable to open audio device.\n");
+    }
     return producer_pool;
 }
 
 void update_buffer(struct audio_buffer_pool* ap, buffer_callback cb)
 {
-    struct audio_buffer* buffer = take_audio_buffer(ap, false);
+    struct audio_buffer* buffer = hal_audio_take(ap, false);
     if (!buffer)
     {
         return;
@@ -117,5 +176,18 @@ void update_buffer(struct audio_buffer_pool* ap, buffer_callback cb)
         samples[i] = cb();
     }
     buffer->sample_count = buffer->max_sample_count;
-    give_audio_buffer(ap, buffer);
-}
\ No newline at end of file
+    hal_audio_give(ap, buffer);
+}
+
+bool update_buffer_block(struct audio_buffer_pool* ap, block_callback cb)
+{
+    struct audio_buffer* buffer = hal_audio_take(ap, false);
+    if (!buffer)
+    {
+        return false;
+    }
+    cb((int16_t*)buffer->buffer->bytes, buffer->max_sample_count);
+    buffer->sample_count = buffer->max_sample_count;
+    hal_audio_give(ap, buffer);
+    return true;
+}
@@ -1,15 +1,31 @@
 
 #pragma once
-#include <pico/audio_i2s.h>
+#include "hal_audio.h"
 
 #define SAMPLES_PER_BUFFER 256
+#define AUDIO_SAMPLE_RATE 44100
 
 namespace vfo_audio {
+class Keyer;
+
 bool start_audio();
 void update_audio_buffer();
+Keyer& get_keyer();
+
+// Nothing audible queued: no demodulator output and the keyer idle as of the
+// last block filled. Safe to call from either core.
+bool is_output_silent();
+
+// For producers other than the main loop, e.g. the demodulator on core 1
+void set_external_source(bool external);
+audio_buffer_pool *get_audio_pool();
+void render_sidetone(int16_t *samples, uint32_t count);
+void finish_block(int16_t *samples, uint32_t count);
 }
  
 typedef int16_t (*buffer_callback)(void);
+typedef void (*block_callback)(int16_t *samples, uint32_t count);
 
 struct audio_buffer_pool *init_audio(uint32_t sample_rate, uint8_t pin_data, uint8_t pin_bclk, uint8_t pio_sm, uint8_t dma_ch);
-void update_buffer(struct audio_buffer_pool *ap, buffer_callback cb);
\ No newline at end of file
+void update_buffer(struct audio_buffer_pool *ap, buffer_callback cb);
+bool update_buffer_block(struct audio_buffer_pool *ap, block_callback cb);
\ No newline at end of file
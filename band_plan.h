@@ -0,0 +1,152 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Amateur HF band plan. Each band runs the Si5351 multisynth at a fixed even
+// integer divider (lowest jitter) and tunes by moving PLLA; the divider is
+// chosen so the VCO stays within 600-900 MHz across the whole band.
+namespace vfo_band
+{
+
+#define BAND_VCO_MIN 600000000ull
+#define BAND_VCO_MAX 900000000ull
+#define BAND_LOOKUP_MHZ 31 // Lookup buckets of 1 MHz, covering 0-30 MHz
+
+// Quadrature (VFO_QUADRATURE): CLK1 is offset by the multisynth divider in
+// quarter VCO periods, a quarter of its own period. The offset register has
+// 7 bits, so the divider is at most 126, and with the VCO kept at 600 MHz or
+// more the lowest frequency with a pair is 600 / 126 = 4.76 MHz. Bands below
+// that (160 and 80 metres) run CLK0 alone.
+#define BAND_QUAD_DIVIDER_MAX 126
+
+enum class Mode : uint8_t
+{
+    LSB,
+    USB,
+    CW
+};
+
+// Matches enum si5351_drive
+enum class Drive : uint8_t
+{
+    mA2,
+    mA4,
+    mA6,
+    mA8
+};
+
+struct Band
+{
+    const char* name;
+    uint32_t low_hz;
+    uint32_t high_hz;
+    uint32_t default_hz;
+    Mode mode;
+    uint8_t step_power; // Default tuning digit, as a power of ten
+    Drive drive;
+    uint16_t ms_divider; // Even integer multisynth divider; VCO = frequency * ms_divider
+    uint16_t quad_divider; // The same for a quadrature pair, 0 if the band is out of reach
+};
+
+// Largest even divider that keeps the top of the band under the VCO maximum
+constexpr uint16_t even_divider(uint32_t high_hz)
+{
+    return uint16_t((BAND_VCO_MAX / high_hz) & ~1ull);
+}
+
+// Even divider that also fits the phase offset register, if the VCO stays in range with it; 0 if none does
+constexpr uint16_t quadrature_divider(uint32_t low_hz, uint32_t high_hz)
+{
+    uint16_t divider = even_divider(high_hz) < BAND_QUAD_DIVIDER_MAX ? even_divider(high_hz) : BAND_QUAD_DIVIDER_MAX;
+    return uint64_t(low_hz) * divider >= BAND_VCO_MIN ? divider : 0;
+}
+
+constexpr Band make_band(const char* name, uint32_t low, uint32_t high, uint32_t def, Mode mode, uint8_t step_power, Drive drive)
+{
+    return Band{ name, low, high, def, mode, step_power, drive, even_divider(high), quadrature_divider(low, high) };
+}
+
+inline constexpr std::array<Band, 9> bands = {
+    make_band("160 metre", 1810000, 2000000, 1840000, Mode::LSB, 2, Drive::mA8),
+    make_band("80 metre", 3500000, 3800000, 3573000, Mode::LSB, 2, Drive::mA8),
+    make_band("40 metre", 7000000, 7200000, 7074000, Mode::LSB, 2, Drive::mA6),
+    make_band("30 metre", 10100000, 10150000, 10136000, Mode::CW, 1, Drive::mA6),
+    make_band("20 metre", 14000000, 14350000, 14074000, Mode::USB, 2, Drive::mA6),
+    make_band("17 metre", 18068000, 18168000, 18100000, Mode::USB, 2, Drive::mA4),
+    make_band("15 metre", 21000000, 21450000, 21074000, Mode::USB, 2, Drive::mA4),
+    make_band("12 metre", 24890000, 24990000, 24915000, Mode::USB, 2, Drive::mA4),
+    make_band("10 metre", 28000000, 29700000, 28074000, Mode::USB, 3, Drive::mA4)
+};
+
+constexpr bool plan_is_valid()
+{
+    for (uint32_t i = 0; i < bands.size(); i++)
+    {
+        const Band& b = bands[i];
+        if (b.low_hz >= b.high_hz || b.default_hz < b.low_hz || b.default_hz > b.high_hz)
+        {
+            return false;
+        }
+        if (uint64_t(b.low_hz) * b.ms_divider < BAND_VCO_MIN || b.ms_divider < 6 || b.ms_divider > 1800)
+        {
+            return false;
+        }
+        if (b.quad_divider && (b.quad_divider < 6 || b.quad_divider & 1 || uint64_t(b.low_hz) * b.quad_divider < BAND_VCO_MIN
+                                || uint64_t(b.high_hz) * b.quad_divider > BAND_VCO_MAX))
+        {
+            return false;
+        }
+        // Sorted, and at most one band per lookup bucket
+        if (i && bands[i - 1].high_hz / 1000000 >= b.low_hz / 1000000)
+        {
+            return false;
+        }
+        if (b.high_hz / 1000000 >= BAND_LOOKUP_MHZ)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(plan_is_valid(), "Band plan is unsorted, overlaps a lookup bucket or has no valid even divider");
+
+// Band index for each whole MHz, or -1
+inline constexpr std::array<int8_t, BAND_LOOKUP_MHZ> band_lookup = [] {
+    std::array<int8_t, BAND_LOOKUP_MHZ> table = {};
+    for (auto& t : table)
+    {
+        t = -1;
+    }
+    for (uint32_t i = 0; i < bands.size(); i++)
+    {
+        for (uint32_t mhz = bands[i].low_hz / 1000000; mhz <= bands[i].high_hz / 1000000; mhz++)
+        {
+            table[mhz] = int8_t(i);
+        }
+    }
+    return table;
+}();
+
+// Band containing hz, or -1
+constexpr int find_band(uint32_t hz)
+{
+    uint32_t mhz = hz / 1000000;
+    if (mhz >= BAND_LOOKUP_MHZ)
+    {
+        return -1;
+    }
+    int i = band_lookup[mhz];
+    return i >= 0 && hz >= bands[i].low_hz && hz <= bands[i].high_hz ? i : -1;
+}
+
+constexpr uint32_t band_up(uint32_t index)
+{
+    return (index + 1) % bands.size();
+}
+
+constexpr uint32_t band_down(uint32_t index)
+{
+    return (index + bands.size() - 1) % bands.size();
+}
+
+} // namespace vfo_band
@@ -0,0 +1,131 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if PICO_ON_DEVICE
+#include "hardware/clocks.h"
+#include "pico/stdlib.h"
+#if defined(__ARM_ARCH_8M_MAIN__)
+#include "hardware/structs/m33.h"
+#define BENCH_HAS_CYCLES 1
+#endif
+#else
+#include <chrono>
+#endif
+
+#ifndef BENCH_HAS_CYCLES
+#define BENCH_HAS_CYCLES 0
+#endif
+
+#ifndef VFO_RAM_HOT
+#define VFO_RAM_HOT 0
+#endif
+
+namespace vfo_bench
+{
+
+namespace
+{
+
+int filter_count = 0;
+char** filters = nullptr;
+
+const char* platform()
+{
+#if PICO_ON_DEVICE
+    return PICO_BOARD;
+#else
+    return "host";
+#endif
+}
+
+} // namespace
+
+void init(int argc, char** argv)
+{
+    if (argc > 1)
+    {
+        filter_count = argc - 1;
+        filters = argv + 1;
+    }
+
+#if PICO_ON_DEVICE
+    // Results go over USB; wait for the host to open the port so none are lost
+    stdio_init_all();
+    while (!stdio_usb_connected())
+    {
+        sleep_ms(10);
+    }
+#if BENCH_HAS_CYCLES
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_cyccnt = 0;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+#endif
+    printf("# clk_sys %lu Hz\n", (unsigned long)clock_get_hz(clk_sys));
+#endif
+}
+
+Counter read_counter()
+{
+#if PICO_ON_DEVICE
+    uint32_t cycles = 0;
+#if BENCH_HAS_CYCLES
+    cycles = m33_hw->dwt_cyccnt;
+#endif
+    return { time_us_64() * 1000, cycles };
+#else
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return { uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()), 0 };
+#endif
+}
+
+bool selected(const char* name)
+{
+    if (filter_count == 0)
+    {
+        return true;
+    }
+    for (int i = 0; i < filter_count; i++)
+    {
+        if (strncmp(name, filters[i], strlen(filters[i])) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void report(const char* name, uint64_t iterations, const Counter& start, const Counter& end)
+{
+    double ns_per_op = double(end.ns - start.ns) / iterations;
+    printf("{\"name\":\"%s\",\"platform\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f", name, platform(),
+        (unsigned long long)iterations, ns_per_op);
+    if (BENCH_HAS_CYCLES)
+    {
+        // A pass is far shorter than the 32 bit counter's wrap (28 s at 150 MHz)
+        printf(",\"cycles_per_op\":%.1f", double(end.cycles - start.cycles) / iterations);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+void report_samples(const char* name, uint32_t* cycles, uint32_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    std::sort(cycles, cycles + count);
+    uint32_t p50 = cycles[count / 2];
+    uint32_t p99 = cycles[std::min(count - 1, count * 99 / 100)];
+    printf("{\"name\":\"%s\",\"platform\":\"%s\",\"samples\":%lu,\"ram_hot\":%d,", name, platform(),
+        (unsigned long)count, VFO_RAM_HOT);
+    printf("\"min_cycles\":%lu,\"p50_cycles\":%lu,\"p99_cycles\":%lu,\"max_cycles\":%lu,\"jitter_cycles\":%lu}\n",
+        (unsigned long)cycles[0], (unsigned long)p50, (unsigned long)p99, (unsigned long)cycles[count - 1],
+        (unsigned long)(cycles[count - 1] - cycles[0]));
+    fflush(stdout);
+}
+
+} // namespace vfo_bench
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+
+// Microbenchmarks. Each case runs its body in a loop, growing the iteration
+// count until one timed pass takes at least BENCH_MIN_TIME_US, and prints that
+// pass as one JSON object per line:
+//
+//   {"name":"fillRect","platform":"host","iterations":65536,"ns_per_op":41.2}
+//
+// On the RP2350 the M33 DWT cycle counter adds "cycles_per_op". A body that
+// handles a block of items passes their number, and op is then one item (one
+// sample of a DSP stage, say).
+//
+// Cases that care about the spread rather than the mean (interrupt latency)
+// time each sample themselves and report the distribution in cycles:
+//
+//   {"name":"irq_entry/cold","platform":"pico2","samples":1000,"ram_hot":1,
+//    "min_cycles":21,"p50_cycles":23,"p99_cycles":25,"max_cycles":31,"jitter_cycles":10}
+//
+// Any other line the harness prints starts with '#'.
+namespace vfo_bench
+{
+
+#define BENCH_MIN_TIME_US 200000
+#define BENCH_MAX_ITERATIONS (1u << 24)
+
+struct Counter
+{
+    uint64_t ns;
+    uint32_t cycles; // Core clock cycles, wraps; 0 where there is no cycle counter
+};
+
+// Start the counters (and USB stdio on the device). On the host the arguments
+// are name prefixes; only the matching cases run.
+void init(int argc, char** argv);
+
+Counter read_counter();
+bool selected(const char* name);
+void report(const char* name, uint64_t iterations, const Counter& start, const Counter& end);
+
+// Sorts cycles in place
+void report_samples(const char* name, uint32_t* cycles, uint32_t count);
+
+// Makes the compiler assume value is used, without generating any code for it
+template <typename T>
+inline void keep(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+void run(const char* name, F&& body, uint32_t items = 1)
+{
+    if (!selected(name))
+    {
+        return;
+    }
+
+    // Warm up the caches (and the XIP cache on the device)
+    body();
+
+    uint32_t iterations = 1;
+    for (;;)
+    {
+        Counter start = read_counter();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            body();
+        }
+        Counter end = read_counter();
+
+        uint64_t ns = end.ns - start.ns;
+        if (ns >= BENCH_MIN_TIME_US * 1000ull || iterations >= BENCH_MAX_ITERATIONS)
+        {
+            report(name, uint64_t(iterations) * items, start, end);
+            return;
+        }
+
+        // Aim a little past the minimum, growing by 2x to 10x per pass
+        uint64_t scale = ns ? BENCH_MIN_TIME_US * 1200ull / ns + 1 : 10;
+        scale = scale < 2 ? 2 : scale > 10 ? 10 : scale;
+        uint64_t next = iterations * scale;
+        iterations = next > BENCH_MAX_ITERATIONS ? BENCH_MAX_ITERATIONS : uint32_t(next);
+    }
+}
+
+} // namespace vfo_bench
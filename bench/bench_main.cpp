@@ -0,0 +1,493 @@
+// Benchmark cases: the synthesizer maths and register writes, display
+// rendering and transfer, the DSP stages, the demodulator, the band-scope, the
+// encoder decoder, the dial's update and readout and the audio block fill and, on the device, interrupt
+// latency. On the device the Si5351 and the display must be on the bus, as in
+// the firmware.
+#include "bench.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "audio.h"
+#include "demod.h"
+#include "dsp.h"
+#include "fft.h"
+#include "frequency.h"
+#include "hal.h"
+#include "input_events.h"
+#include "placement.h"
+#include "rotary_decoder.h"
+#include "spectrum.h"
+#include "synth.h"
+
+#include "pico-ssd1306/shapeRenderer/ShapeRenderer.h"
+#include "pico-ssd1306/ssd1306.h"
+#include "pico-ssd1306/textRenderer/TextRenderer.h"
+
+#include "BMSPA_font.h"
+#include "acme_5_outlines_font.h"
+#include "bubblesstandard_font.h"
+#include "crackers_font.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/irq.h"
+#include "hardware/structs/m33.h"
+#include "hardware/structs/nvic.h"
+#include "hardware/sync.h"
+#include "hardware/xip_cache.h"
+#endif
+
+extern "C" {
+#include "si5351/si5351.h"
+
+// Internal to si5351.c
+uint64_t pll_calc(enum si5351_pll, uint64_t, struct Si5351RegSet*, int32_t, uint8_t);
+uint64_t multisynth_calc(uint64_t, uint64_t, struct Si5351RegSet*);
+}
+
+using namespace pico_ssd1306;
+using vfo_bench::keep;
+using vfo_bench::run;
+
+#define BENCH_I2C_HZ 48000 // As the firmware runs the bus
+#define BENCH_DISPLAY_ADDRESS 0x3C
+#define BENCH_SI5351_ADDRESS 0x60
+
+namespace
+{
+
+// Walks a range in fixed steps, so repeated calls never see the same input
+struct Sweep
+{
+    uint64_t low, high, step, value;
+
+    uint64_t next()
+    {
+        value = value + step >= high ? low : value + step;
+        return value;
+    }
+};
+
+void bench_synth()
+{
+    // 40 m, 1 kHz apart; frequencies are in 1/SI5351_FREQ_MULT Hz
+    Sweep vfo = { 7000000 * SI5351_FREQ_MULT, 7300000 * SI5351_FREQ_MULT, 1000 * SI5351_FREQ_MULT, 7000000 * SI5351_FREQ_MULT };
+    Sweep vco = { 600000000 * SI5351_FREQ_MULT, 900000000 * SI5351_FREQ_MULT, 12345 * SI5351_FREQ_MULT, 600000000 * SI5351_FREQ_MULT };
+
+    run("pll_calc", [&] {
+        Si5351RegSet reg;
+        keep(pll_calc(SI5351_PLLA, vco.next(), &reg, 140000, 0));
+        keep(reg);
+    });
+
+    // With no PLL frequency given it picks one, as si5351_set_freq does
+    run("multisynth_calc", [&] {
+        Si5351RegSet reg;
+        keep(multisynth_calc(vfo.next(), 0, &reg));
+        keep(reg);
+    });
+
+    run("si5351_set_freq", [&] { keep(si5351_set_freq(vfo.next(), SI5351_CLK0)); });
+}
+
+// A sweep point as prepared up front, and as written per step: the written
+// case's ns_per_op is the fastest a sweep can step (1e9 / ns points per second)
+void bench_sweep()
+{
+    Sweep hz = { SYNTH_SWEEP_MIN_HZ, SYNTH_SWEEP_MAX_HZ, 12345, SYNTH_SWEEP_MIN_HZ };
+    uint8_t point[SYNTH_POINT_LEN];
+
+    run("sweep_pack_point", [&] {
+        vfo_synth::pack_sweep_point(uint32_t(hz.next()), point);
+        keep(point);
+    });
+
+    vfo_synth::pack_sweep_point(10000000, point);
+    run("sweep_write_point", [&] { vfo_synth::write_sweep_point(point); });
+}
+
+// The fonts in the top directory are laid out for another SSD1306 driver:
+// height, width, spacing, first and last character, then a byte per column.
+// At 8 pixels high a column is a byte in drawText's layout too, so only the
+// header changes; the spacing is dropped, drawText has none.
+#define BENCH_FONT_GLYPHS (126 - 32 + 1)
+
+void to_text_renderer(const uint8_t* font, unsigned char* out)
+{
+    out[0] = font[1];
+    out[1] = font[0];
+    memcpy(out + 2, font + 5, size_t(font[4] - font[3] + 1) * font[1]);
+}
+
+void bench_display(SSD1306& display)
+{
+    static unsigned char bmspa[2 + BENCH_FONT_GLYPHS * 8];
+    static unsigned char acme[2 + BENCH_FONT_GLYPHS * 6];
+    static unsigned char bubbles[2 + BENCH_FONT_GLYPHS * 7];
+    static unsigned char crackers[2 + BENCH_FONT_GLYPHS * 6];
+    to_text_renderer(BMSPA_font, bmspa);
+    to_text_renderer(acme_font, acme);
+    to_text_renderer(bubblesstandard_font, bubbles);
+    to_text_renderer(crackers_font, crackers);
+
+    static const struct
+    {
+        const char* name;
+        const unsigned char* font;
+    } fonts[] = {
+        { "drawText/font_5x8", font_5x8 },
+        { "drawText/font_8x8", font_8x8 },
+        { "drawText/font_12x16", font_12x16 },
+        { "drawText/font_16x32", font_16x32 },
+        { "drawText/BMSPA", bmspa },
+        { "drawText/acme_5_outlines", acme },
+        { "drawText/bubblesstandard", bubbles },
+        { "drawText/crackers", crackers },
+    };
+
+    // A frequency readout, as wide as the largest font fits
+    for (const auto& f : fonts)
+    {
+        run(f.name, [&] {
+            drawText(&display, f.font, "7074000", 0, 0);
+            keep(*display.getBuffer());
+        });
+    }
+
+    run("fillRect", [&] {
+        fillRect(&display, 0, 0, 127, 63, WriteMode::INVERT);
+        keep(*display.getBuffer());
+    });
+
+    run("sendBuffer", [&] { display.sendBuffer(); });
+}
+
+// Each stage over one output buffer, reported per sample. The block is
+// reloaded every call, so the limiter sees the same peaks each time; the copy
+// is timed too, and "dsp/copy" shows what it costs.
+void bench_dsp()
+{
+    static int16_t source[SAMPLES_PER_BUFFER];
+    static int16_t block[SAMPLES_PER_BUFFER];
+
+    // Two tones near full scale, so the limiter works throughout
+    uint32_t noise = 1;
+    for (uint32_t i = 0; i < SAMPLES_PER_BUFFER; i++)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        int32_t tones = int32_t(16000 * sinf(i * 0.07f) + 15000 * sinf(i * 0.31f));
+        source[i] = vfo_dsp::sat16(tones + int32_t(noise >> 22) - 512);
+    }
+
+    auto stage = [&](const char* name, auto& s) {
+        run(name, [&] {
+            memcpy(block, source, sizeof(block));
+            keep(s.process(block, SAMPLES_PER_BUFFER));
+            keep(block[0]);
+        }, SAMPLES_PER_BUFFER);
+    };
+
+    run("dsp/copy", [&] {
+        memcpy(block, source, sizeof(block));
+        keep(block[0]);
+    }, SAMPLES_PER_BUFFER);
+
+    vfo_dsp::Biquad lowpass(vfo_dsp::biquad_lowpass(AUDIO_SAMPLE_RATE, 3000, 0.707));
+    stage("dsp/biquad", lowpass);
+
+    // The demodulator's decimator, per input sample
+    vfo_dsp::DecimatingFir<32, 2> decimator(vfo_dsp::fir_lowpass<32>(AUDIO_SAMPLE_RATE * 2, 4000));
+    stage("dsp/fir32_decimate2", decimator);
+    vfo_dsp::DecimatingFir<32, 1> fir(vfo_dsp::fir_lowpass<32>(AUDIO_SAMPLE_RATE, 4000));
+    stage("dsp/fir32", fir);
+
+    vfo_dsp::Gain gain(vfo_dsp::Gain::unity * 3 / 2);
+    stage("dsp/gain", gain);
+
+    // Held down throughout by the peaks, then the same input left alone
+    vfo_dsp::Limiter limiter(vfo_dsp::q15(0.5));
+    stage("dsp/limiter/limiting", limiter);
+    vfo_dsp::Limiter idle_limiter(vfo_dsp::q15(0.99));
+    stage("dsp/limiter/idle", idle_limiter);
+}
+
+void bench_demod()
+{
+    static int16_t source[SAMPLES_PER_BUFFER * 2];
+    static int16_t block[SAMPLES_PER_BUFFER * 2];
+    static vfo_demod::SsbDemodulator demod(AUDIO_SAMPLE_RATE * DEMOD_DECIMATION);
+
+    // A capture block of I/Q: one tone on each sideband, at half scale between them
+    for (uint32_t i = 0; i < SAMPLES_PER_BUFFER; i++)
+    {
+        source[i * 2] = int16_t(8000 * cosf(i * 0.05f) + 8000 * cosf(i * 0.13f));
+        source[i * 2 + 1] = int16_t(8000 * sinf(i * 0.05f) - 8000 * sinf(i * 0.13f));
+    }
+
+    // Per input frame; a block has SAMPLES_PER_BUFFER of them to do in 2.9 ms
+    run("demod/ssb", [&] {
+        memcpy(block, source, sizeof(block));
+        keep(demod.process(block, SAMPLES_PER_BUFFER));
+        keep(block[0]);
+    }, SAMPLES_PER_BUFFER);
+}
+
+// One transform per op, at each size the scope could use: the cost against N log N
+template <uint32_t N>
+void bench_fft(const char* name, const int16_t* iq)
+{
+    static int16_t re[N];
+    static int16_t im[N];
+    run(name, [&] {
+        for (uint32_t n = 0; n < N; n++)
+        {
+            re[n] = iq[(n * 2) % (SAMPLES_PER_BUFFER * 2)];
+            im[n] = iq[(n * 2 + 1) % (SAMPLES_PER_BUFFER * 2)];
+        }
+        vfo_dsp::Fft<N>::forward(re, im);
+        keep(re[0]);
+    });
+}
+
+// The band-scope's stages on one I/Q block, into a frame buffer of our own
+void bench_scope()
+{
+    static int16_t iq[SAMPLES_PER_BUFFER * 2];
+    static uint8_t levels[SCOPE_WIDTH];
+    static uint8_t fb[SCOPE_WIDTH * 8];
+    static vfo_scope::Waterfall waterfall;
+
+    uint32_t noise = 1;
+    for (uint32_t i = 0; i < SAMPLES_PER_BUFFER; i++)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        iq[i * 2] = int16_t(12000 * cosf(i * 0.4f) + int32_t(noise >> 22) - 512);
+        iq[i * 2 + 1] = int16_t(12000 * sinf(i * 0.4f) + int32_t(noise >> 23) - 256);
+    }
+
+    bench_fft<64>("scope/fft/64", iq);
+    bench_fft<128>("scope/fft/128", iq);
+    bench_fft<256>("scope/fft/256", iq);
+    bench_fft<512>("scope/fft/512", iq);
+    bench_fft<1024>("scope/fft/1024", iq);
+
+    // Window, transform and fold into columns, as drawn every frame
+    run("scope/levels", [&] {
+        vfo_scope::compute_levels(iq, levels);
+        keep(levels[0]);
+    });
+    run("scope/render/strip", [&] {
+        vfo_scope::render_spectrum(fb, 7, 1, levels);
+        keep(fb[0]);
+    });
+    run("scope/render/full", [&] {
+        vfo_scope::render_spectrum(fb, 0, 8, levels);
+        keep(fb[0]);
+    });
+    run("scope/render/waterfall", [&] {
+        keep(waterfall.push_row(fb, levels));
+    });
+}
+
+// Decode cost per edge, as the GPIO IRQ pays it: detents both ways, every
+// edge bouncing once, read as gpio_get_all() gives them with A on GPIO 4 and B on 3
+void bench_rotary()
+{
+    static const uint8_t cw[] = { 3, 1, 3, 1, 0, 1, 0, 2, 0, 2, 3, 2, 3 };
+    static uint32_t pins[64];
+    uint32_t n = 0;
+    for (uint32_t turn = 0; n + sizeof(cw) <= 64; turn++)
+    {
+        for (uint32_t i = 0; i < sizeof(cw); i++)
+        {
+            uint8_t code = turn & 1 ? cw[sizeof(cw) - 1 - i] : cw[i];
+            pins[n++] = uint32_t(code & 1) << 4 | uint32_t(code >> 1) << 3;
+        }
+    }
+
+    vfo_input::RotaryDecoder full(4, 3);
+    vfo_input::RotaryDecoder half(4, 3, true);
+    run("rotary/full", [&] {
+        int32_t steps = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            steps += full.process(pins[i]);
+        }
+        keep(steps);
+    }, n);
+    run("rotary/half", [&] {
+        int32_t steps = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            steps += half.process(pins[i]);
+        }
+        keep(steps);
+    }, n);
+}
+
+// One retune of the dial as the main loop does it, and its readout, against
+// the double-precision step and std::string readout they replaced; a detent
+// at a time over the 40 m band, so the carries and the clamp both come up
+void bench_frequency()
+{
+    vfo_ui::Frequency frequency(7000000);
+    uint32_t power = 0;
+    char text[16];
+    run("frequency/step", [&] {
+        frequency.step(vfo_ui::pow10[power], power & 1 ? -3 : 7, 7000000, 7200000);
+        power = power == 5 ? 0 : power + 1;
+        keep(frequency);
+    });
+    run("frequency/format", [&] {
+        keep(frequency.format(text, sizeof(text)));
+        keep(text);
+    });
+    run("frequency/step+format", [&] {
+        frequency.step(vfo_ui::pow10[power], power & 1 ? -3 : 7, 7000000, 7200000);
+        power = power == 5 ? 0 : power + 1;
+        keep(frequency.format(text, sizeof(text)));
+        keep(text);
+    });
+
+    uint32_t hz = 7000000;
+    uint32_t digit = 6;
+    run("frequency/step+format/double+string", [&] {
+        double next = hz + (digit & 1 ? -3 : 7) * pow(10, 6 - digit);
+        hz = next < 7000000 ? 7000000 : next > 7200000 ? 7200000 : uint32_t(next);
+        digit = digit == 1 ? 6 : digit - 1;
+        std::string readout = std::to_string(hz) + "Mhz";
+        keep(readout.data());
+    });
+}
+
+void bench_audio()
+{
+    static int16_t block[SAMPLES_PER_BUFFER];
+
+    // One output buffer as the main loop fills it: sidetone, keyer, gain and limiter
+    run("audio_block_fill", [&] {
+        vfo_audio::render_sidetone(block, SAMPLES_PER_BUFFER);
+        vfo_audio::finish_block(block, SAMPLES_PER_BUFFER);
+        keep(block[0]);
+    });
+}
+
+#if PICO_ON_DEVICE
+#define BENCH_IRQ_SAMPLES 1000
+
+// A stand-in for the encoder interrupt: the same decode and queue push, on a
+// spare IRQ pended from software so every sample starts at a known cycle.
+// Marked like the firmware's handlers, so building with VFO_RAM_HOT on and off
+// shows what the placement does to the entry latency and the handler time.
+vfo_input::RotaryDecoder irq_decoder(0, 1);
+vfo_input::InputQueue irq_events;
+uint32_t irq_step = 0;
+volatile uint32_t irq_entered = 0;
+volatile uint32_t irq_done = 0;
+
+void HOT_FUNC(bench_irq)()
+{
+    irq_entered = m33_hw->dwt_cyccnt;
+
+    // One clockwise detent every four edges: 11 -> 01 -> 00 -> 10 -> 11
+    static const uint8_t codes[4] HOT_DATA("bench_irq_codes") = { 1, 0, 2, 3 };
+    if (int8_t step = irq_decoder.process(codes[irq_step++ & 3]))
+    {
+        irq_events.push({ irq_entered, vfo_input::InputEventType::Rotate, 0, step });
+    }
+
+    irq_done = m33_hw->dwt_cyccnt;
+}
+
+// Always in SRAM, so only the handler's placement differs between builds.
+// Cold empties the XIP cache first, as a display frame or a flash program can.
+void __not_in_flash_func(sample_irq)(uint irq, bool cold, uint32_t* entry, uint32_t* handler)
+{
+    for (uint32_t i = 0; i < BENCH_IRQ_SAMPLES; i++)
+    {
+        if (cold)
+        {
+            xip_cache_invalidate_all();
+        }
+        uint32_t start = m33_hw->dwt_cyccnt;
+        nvic_hw->ispr[irq / 32] = 1u << (irq % 32);
+        __dsb();
+        __isb();
+        entry[i] = irq_entered - start;
+        handler[i] = irq_done - start;
+
+        vfo_input::InputEvent event;
+        while (irq_events.pop(event))
+        {
+        }
+    }
+}
+
+void bench_irq_latency()
+{
+    static uint32_t entry[BENCH_IRQ_SAMPLES];
+    static uint32_t handler[BENCH_IRQ_SAMPLES];
+
+    uint irq = user_irq_claim_unused(true);
+    irq_set_exclusive_handler(irq, bench_irq);
+    irq_set_enabled(irq, true);
+
+    for (bool cold : { false, true })
+    {
+        if (!vfo_bench::selected(cold ? "irq_entry/cold" : "irq_entry/warm"))
+        {
+            continue;
+        }
+        sample_irq(irq, cold, entry, handler);
+        vfo_bench::report_samples(cold ? "irq_entry/cold" : "irq_entry/warm", entry, BENCH_IRQ_SAMPLES);
+        vfo_bench::report_samples(cold ? "irq_handler/cold" : "irq_handler/warm", handler, BENCH_IRQ_SAMPLES);
+    }
+
+    irq_set_enabled(irq, false);
+    irq_remove_handler(irq, bench_irq);
+    user_irq_unclaim(irq);
+}
+#endif
+
+void run_all()
+{
+    hal_i2c_init(0, BENCH_I2C_HZ, 0, 1);
+    si5351_init(BENCH_SI5351_ADDRESS, SI5351_CRYSTAL_LOAD_8PF, 25000000, 140000);
+    SSD1306 display(0, BENCH_DISPLAY_ADDRESS, Size::W128xH64);
+    vfo_audio::start_audio();
+
+    bench_synth();
+    bench_sweep();
+    bench_display(display);
+    bench_dsp();
+    bench_demod();
+    bench_scope();
+    bench_rotary();
+    bench_frequency();
+    bench_audio();
+#if PICO_ON_DEVICE
+    bench_irq_latency();
+#endif
+
+    printf("# done\n");
+}
+
+} // namespace
+
+#if PICO_ON_DEVICE
+int main()
+{
+    vfo_bench::init(0, nullptr);
+    run_all();
+    return 0;
+}
+#else
+int main(int argc, char** argv)
+{
+    vfo_bench::init(argc, argv);
+    run_all();
+    return 0;
+}
+#endif
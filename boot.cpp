@@ -0,0 +1,47 @@
+#include "boot.h"
+
+#include <atomic>
+#include <cstdio>
+
+#include "pico/stdio.h"
+
+namespace vfo_boot
+{
+
+namespace
+{
+
+struct Stage
+{
+    const char* name;
+    uint32_t time_us;
+};
+
+Stage stages[BOOT_MAX_STAGES];
+
+// Both cores mark stages
+std::atomic<uint32_t> stage_count = 0;
+
+} // namespace
+
+void stage_done(const char* name)
+{
+    uint32_t slot = stage_count.fetch_add(1, std::memory_order_relaxed);
+    if (slot < BOOT_MAX_STAGES)
+    {
+        stages[slot] = { name, hal_time_us() };
+    }
+}
+
+void report()
+{
+    char line[48];
+    uint32_t count = stage_count.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count && i < BOOT_MAX_STAGES; i++)
+    {
+        int len = snprintf(line, sizeof(line), "#B %lu %s", (unsigned long)stages[i].time_us, stages[i].name);
+        stdio_put_string(line, len, true, false);
+    }
+}
+
+} // namespace vfo_boot
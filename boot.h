@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+
+#include "hal.h"
+
+// Bring-up timing. Each stage of start-up is marked as it finishes, in
+// microseconds since reset, so the boot ROM's share is counted too. The
+// stages are reported with the trace dump (CAT TD;), as "#B <time_us> <stage>"
+// lines, since USB is not up yet when they happen.
+namespace vfo_boot
+{
+
+#define BOOT_MAX_STAGES 16
+
+// name must outlive the report, a string literal
+void stage_done(const char* name);
+
+// Poll ready() until it returns true or timeout_us passes; false on timeout.
+// For devices that are slow out of power-on reset, in place of a fixed delay.
+template <typename Ready>
+bool poll_ready(Ready ready, uint32_t timeout_us)
+{
+    uint32_t start = hal_time_us();
+    while (!ready())
+    {
+        if (hal_time_us() - start > timeout_us)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write the stages over USB stdio, one line each. Blocks until written.
+void report();
+
+} // namespace vfo_boot
@@ -0,0 +1,151 @@
+#include "buttons.h"
+
+#include "event_loop.h"
+#include "hal.h"
+#include "placement.h"
+
+namespace vfo_input
+{
+
+namespace
+{
+
+struct Button
+{
+    uint8_t gpio;
+    uint8_t integrator;
+    bool down;
+    bool long_sent;
+    bool click_pending;
+    uint16_t held_ticks; // Ticks since the debounced press
+    uint16_t gap_ticks; // Ticks since the release of a pending click
+};
+
+Button buttons[BUTTON_MAX];
+uint32_t button_count = 0;
+
+InputQueue* events = nullptr;
+uint16_t long_ticks = 0;
+uint16_t double_ticks = 0;
+hal_timer_t sample_timer;
+
+bool emitted = false;
+
+void HOT_FUNC(emit)(uint32_t source, InputEventType type, uint32_t now)
+{
+    events->push({ now, type, uint8_t(source), 0 });
+    emitted = true;
+}
+
+bool HOT_FUNC(sample_buttons)(hal_timer_t*)
+{
+    uint32_t pins = hal_gpio_get_all();
+    uint32_t now = hal_time_us();
+
+    for (uint32_t i = 0; i < button_count; i++)
+    {
+        Button& b = buttons[i];
+
+        // Integrator debounce, active low
+        bool raw = (pins & (1u << b.gpio)) == 0;
+        if (raw && b.integrator < BUTTON_INTEGRATOR_MAX)
+        {
+            b.integrator++;
+        }
+        else if (!raw && b.integrator > 0)
+        {
+            b.integrator--;
+        }
+
+        bool down = b.down;
+        if (b.integrator == BUTTON_INTEGRATOR_MAX)
+        {
+            down = true;
+        }
+        else if (b.integrator == 0)
+        {
+            down = false;
+        }
+
+        if (down != b.down)
+        {
+            b.down = down;
+            if (down)
+            {
+                emit(i, InputEventType::Press, now);
+                b.held_ticks = 0;
+                b.long_sent = false;
+            }
+            else
+            {
+                emit(i, InputEventType::Release, now);
+
+                // After a long press the release ends the gesture
+                if (b.long_sent)
+                {
+                    b.long_sent = false;
+                }
+                else if (b.click_pending)
+                {
+                    emit(i, InputEventType::DoubleClick, now);
+                    b.click_pending = false;
+                }
+                else
+                {
+                    b.click_pending = true;
+                    b.gap_ticks = 0;
+                }
+            }
+        }
+        else if (down && !b.long_sent && ++b.held_ticks >= long_ticks)
+        {
+            // A click followed by a long hold is a click, then a long press
+            if (b.click_pending)
+            {
+                emit(i, InputEventType::Click, now);
+                b.click_pending = false;
+            }
+            emit(i, InputEventType::LongPress, now);
+            b.long_sent = true;
+        }
+        else if (!down && b.click_pending && ++b.gap_ticks >= double_ticks)
+        {
+            emit(i, InputEventType::Click, now);
+            b.click_pending = false;
+        }
+    }
+
+    // Only wake the main loop when there is something to handle
+    if (emitted)
+    {
+        emitted = false;
+        vfo_loop::post_wake(vfo_loop::WAKE_INPUT);
+    }
+    return true;
+}
+
+} // namespace
+
+int add_button(uint32_t gpio)
+{
+    if (button_count == BUTTON_MAX)
+    {
+        return -1;
+    }
+
+    hal_gpio_input(gpio, true);
+
+    buttons[button_count] = { uint8_t(gpio), 0, false, false, false, 0, 0 };
+    return int(button_count++);
+}
+
+bool start_buttons(InputQueue& queue, ButtonTiming timing)
+{
+    events = &queue;
+    long_ticks = timing.long_press_ms / BUTTON_SAMPLE_MS;
+    double_ticks = timing.double_click_ms / BUTTON_SAMPLE_MS;
+
+    return hal_timer_every_ms(BUTTON_SAMPLE_MS, sample_buttons, nullptr, &sample_timer);
+}
+
+} // namespace vfo_input
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+#include "input_events.h"
+
+// Push buttons sampled from one repeating timer.
+// Each button has an integrator that counts up while the pin reads pressed and
+// down while it reads released; the debounced state only flips at the ends of
+// the range, so contact bounce never reaches the event queue.
+namespace vfo_input
+{
+
+#define BUTTON_MAX 4
+#define BUTTON_SAMPLE_MS 5
+#define BUTTON_INTEGRATOR_MAX 4 // Samples of agreement needed to change state
+
+struct ButtonTiming
+{
+    uint16_t long_press_ms = 600;
+    uint16_t double_click_ms = 300;
+};
+
+// Register an active-low button with an internal pull up. Returns its event
+// source number, or -1 if all BUTTON_MAX slots are used. Call before start_buttons().
+int add_button(uint32_t gpio);
+
+// Start sampling; events go to queue as Press/Release plus LongPress, Click or DoubleClick
+bool start_buttons(InputQueue& queue, ButtonTiming timing = {});
+
+} // namespace vfo_input
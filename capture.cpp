@@ -0,0 +1,160 @@
+#include "capture.h"
+#include "audio.h"
+#include "event_loop.h"
+
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "placement.h"
+#include "pico/stdlib.h"
+
+// ADC inputs for I and Q
+#define CAPTURE_PIN_I 26
+#define CAPTURE_PIN_Q 27
+
+namespace vfo_capture
+{
+
+namespace
+{
+
+audio_buffer_pool_t* pool = nullptr;
+
+// Two DMA channels chained to each other; while one fills its buffer the
+// other is re-pointed at a fresh one from the pool.
+int dma_chan[2] = { -1, -1 };
+audio_buffer_t* dma_target[2] = {};
+
+// Written into when the consumer has not returned any buffers
+audio_buffer_t* scratch = nullptr;
+
+volatile uint32_t blocks = 0;
+volatile uint32_t overruns = 0;
+
+audio_buffer_t* next_target()
+{
+    audio_buffer_t* buffer = get_free_audio_buffer(pool, false);
+    if (!buffer)
+    {
+        overruns = overruns + 1;
+        return scratch;
+    }
+    return buffer;
+}
+
+void HOT_FUNC(dma_handler)()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (!dma_channel_get_irq1_status(dma_chan[i]))
+        {
+            continue;
+        }
+        dma_channel_acknowledge_irq1(dma_chan[i]);
+
+        audio_buffer_t* done = dma_target[i];
+        if (done != scratch)
+        {
+            done->sample_count = done->max_sample_count;
+            done->user_data = time_us_32();
+            queue_full_audio_buffer(pool, done);
+            vfo_loop::post_wake(vfo_loop::WAKE_CAPTURE);
+        }
+        blocks = blocks + 1;
+
+        // The other channel is running now; re-arm this one without triggering it
+        dma_target[i] = next_target();
+        dma_channel_set_write_addr(dma_chan[i], dma_target[i]->buffer->bytes, false);
+    }
+}
+
+} // namespace
+
+bool start_capture(uint32_t sample_rate)
+{
+    static audio_format_t format = {
+        .sample_freq = sample_rate,
+        .format = AUDIO_BUFFER_FORMAT_PCM_U16,
+        .channel_count = CAPTURE_CHANNELS,
+    };
+
+    static audio_buffer_format_t buffer_format = {
+        .format = &format,
+        .sample_stride = 2 * CAPTURE_CHANNELS
+    };
+
+    pool = audio_new_producer_pool(&buffer_format, CAPTURE_BUFFER_COUNT + 1, SAMPLES_PER_BUFFER);
+    if (!pool)
+    {
+        return false;
+    }
+    scratch = get_free_audio_buffer(pool, false);
+
+    adc_init();
+    adc_gpio_init(CAPTURE_PIN_I);
+    adc_gpio_init(CAPTURE_PIN_Q);
+    adc_select_input(0);
+    adc_set_round_robin(0b11);
+
+    // FIFO on, DREQ at one sample, no error bit, full 12 bits
+    adc_fifo_setup(true, true, 1, false, false);
+
+    // The ADC clock is 48MHz and each conversion takes 96 cycles minimum
+    adc_set_clkdiv(48000000.0f / (sample_rate * CAPTURE_CHANNELS) - 1);
+
+    uint32_t transfers = SAMPLES_PER_BUFFER * CAPTURE_CHANNELS;
+    for (int i = 0; i < 2; i++)
+    {
+        dma_chan[i] = dma_claim_unused_channel(true);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        dma_channel_config c = dma_channel_get_default_config(dma_chan[i]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, true);
+        channel_config_set_dreq(&c, DREQ_ADC);
+        channel_config_set_chain_to(&c, dma_chan[i ^ 1]);
+
+        dma_target[i] = next_target();
+        dma_channel_configure(dma_chan[i], &c, dma_target[i]->buffer->bytes, &adc_hw->fifo, transfers, false);
+        dma_channel_set_irq1_enabled(dma_chan[i], true);
+    }
+
+    // DMA_IRQ_0 belongs to the I2S output
+    irq_add_shared_handler(DMA_IRQ_1, dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    dma_channel_start(dma_chan[0]);
+    adc_run(true);
+    return true;
+}
+
+void stop_capture()
+{
+    adc_run(false);
+    for (int i = 0; i < 2; i++)
+    {
+        dma_channel_set_irq1_enabled(dma_chan[i], false);
+        dma_channel_abort(dma_chan[i]);
+    }
+    adc_fifo_drain();
+}
+
+audio_buffer_t* take_capture_block()
+{
+    return pool ? get_full_audio_buffer(pool, false) : nullptr;
+}
+
+void release_capture_block(audio_buffer_t* buffer)
+{
+    queue_free_audio_buffer(pool, buffer);
+}
+
+CaptureStats get_capture_stats()
+{
+    return CaptureStats{ blocks, overruns };
+}
+
+} // namespace vfo_capture
@@ -0,0 +1,47 @@
+#pragma once
+#include <pico/audio.h>
+
+// Receive capture: two ADC channels (I/Q, or audio on channel 0) sampled in
+// round-robin and written by DMA straight into audio_buffer_pool buffers.
+// Each full buffer holds SAMPLES_PER_BUFFER interleaved frames of unsigned
+// 12 bit samples, with the completion time (time_us_32) in user_data.
+namespace vfo_capture
+{
+
+#define CAPTURE_CHANNELS 2
+#define CAPTURE_BUFFER_COUNT 4
+
+struct CaptureStats
+{
+    uint32_t blocks;
+    uint32_t overruns; // Blocks dropped because the consumer had not freed a buffer
+};
+
+bool start_capture(uint32_t sample_rate);
+void stop_capture();
+
+// Consumer side; returns nullptr when no block is ready
+audio_buffer_t* take_capture_block();
+void release_capture_block(audio_buffer_t* buffer);
+
+// Convert a block in place from offset 12 bit ADC codes to signed full-scale int16
+inline int16_t* capture_to_signed(audio_buffer_t* buffer)
+{
+    uint16_t* in = (uint16_t*)buffer->buffer->bytes;
+    int16_t* out = (int16_t*)in;
+    uint32_t count = buffer->sample_count * CAPTURE_CHANNELS;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = int16_t((int32_t(in[i]) - 2048) << 4);
+    }
+    return out;
+}
+
+CaptureStats get_capture_stats();
+
+#if !PICO_ON_DEVICE
+// Host stand-in: replay a 16 bit PCM WAV file as the ADC
+bool open_capture_wav(const char* path, bool loop);
+#endif
+
+} // namespace vfo_capture
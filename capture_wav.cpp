@@ -0,0 +1,199 @@
+// Host stand-in for capture.cpp: replays a WAV file as if it were the ADC.
+// Stereo files map left/right to I/Q; mono files feed channel 0 and leave Q at mid-scale.
+#include "capture.h"
+#include "audio.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace vfo_capture
+{
+
+namespace
+{
+
+FILE* wav = nullptr;
+bool wav_loop = false;
+long wav_data_start = 0;
+uint32_t wav_channels = 0;
+uint32_t wav_rate = 0;
+uint64_t frames_read = 0;
+
+uint16_t block_bytes[CAPTURE_BUFFER_COUNT][SAMPLES_PER_BUFFER * CAPTURE_CHANNELS];
+mem_buffer_t block_mem[CAPTURE_BUFFER_COUNT];
+audio_buffer_t blocks[CAPTURE_BUFFER_COUNT];
+bool block_busy[CAPTURE_BUFFER_COUNT];
+
+uint32_t block_count = 0;
+uint32_t overruns = 0;
+
+uint32_t read_u32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+uint16_t read_u16(const uint8_t* p)
+{
+    return uint16_t(p[0] | (p[1] << 8));
+}
+
+bool read_frame(int16_t* frame)
+{
+    if (fread(frame, sizeof(int16_t), wav_channels, wav) == wav_channels)
+    {
+        return true;
+    }
+    if (!wav_loop)
+    {
+        return false;
+    }
+    fseek(wav, wav_data_start, SEEK_SET);
+    return fread(frame, sizeof(int16_t), wav_channels, wav) == wav_channels;
+}
+
+} // namespace
+
+bool open_capture_wav(const char* path, bool loop)
+{
+    if (wav)
+    {
+        fclose(wav);
+    }
+    wav = fopen(path, "rb");
+    if (!wav)
+    {
+        return false;
+    }
+
+    uint8_t header[12];
+    if (fread(header, 1, 12, wav) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+    {
+        fclose(wav);
+        wav = nullptr;
+        return false;
+    }
+
+    // Walk the chunks for fmt and data
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, wav) == 8)
+    {
+        uint32_t size = read_u32(chunk + 4);
+        if (!memcmp(chunk, "fmt ", 4))
+        {
+            uint8_t fmt[16];
+            if (size < 16 || fread(fmt, 1, 16, wav) != 16)
+            {
+                break;
+            }
+            if (read_u16(fmt) != 1 || read_u16(fmt + 14) != 16)
+            {
+                // 16 bit PCM only
+                break;
+            }
+            wav_channels = read_u16(fmt + 2);
+            wav_rate = read_u32(fmt + 4);
+            fseek(wav, size - 16 + (size & 1), SEEK_CUR);
+        }
+        else if (!memcmp(chunk, "data", 4))
+        {
+            if (wav_channels < 1 || wav_channels > 2)
+            {
+                break;
+            }
+            wav_data_start = ftell(wav);
+            wav_loop = loop;
+            frames_read = 0;
+            return true;
+        }
+        else
+        {
+            fseek(wav, size + (size & 1), SEEK_CUR);
+        }
+    }
+
+    fclose(wav);
+    wav = nullptr;
+    return false;
+}
+
+bool start_capture(uint32_t sample_rate)
+{
+    for (uint32_t i = 0; i < CAPTURE_BUFFER_COUNT; i++)
+    {
+        block_mem[i].size = sizeof(block_bytes[i]);
+        block_mem[i].bytes = (uint8_t*)block_bytes[i];
+        blocks[i] = {};
+        blocks[i].buffer = &block_mem[i];
+        blocks[i].max_sample_count = SAMPLES_PER_BUFFER;
+        block_busy[i] = false;
+    }
+    if (wav && wav_rate != sample_rate)
+    {
+        printf("capture: file is %u Hz, replaying at %u Hz\n", wav_rate, sample_rate);
+        wav_rate = sample_rate;
+    }
+    return wav != nullptr;
+}
+
+void stop_capture()
+{
+    if (wav)
+    {
+        fclose(wav);
+        wav = nullptr;
+    }
+}
+
+// Blocks are produced on demand, so the consumer sets the pace
+audio_buffer_t* take_capture_block()
+{
+    if (!wav)
+    {
+        return nullptr;
+    }
+
+    uint32_t slot = 0;
+    while (slot < CAPTURE_BUFFER_COUNT && block_busy[slot])
+    {
+        slot++;
+    }
+    if (slot == CAPTURE_BUFFER_COUNT)
+    {
+        overruns++;
+        return nullptr;
+    }
+
+    uint16_t* out = block_bytes[slot];
+    uint32_t frames = 0;
+    int16_t frame[2];
+    while (frames < SAMPLES_PER_BUFFER && read_frame(frame))
+    {
+        // Back to offset 12 bit ADC codes
+        out[frames * 2] = uint16_t((frame[0] >> 4) + 2048);
+        out[frames * 2 + 1] = wav_channels == 2 ? uint16_t((frame[1] >> 4) + 2048) : 2048;
+        frames++;
+    }
+    if (frames == 0)
+    {
+        return nullptr;
+    }
+
+    frames_read += frames;
+    block_count++;
+    block_busy[slot] = true;
+    blocks[slot].sample_count = frames;
+    blocks[slot].user_data = uint32_t(frames_read * 1000000ull / wav_rate);
+    return &blocks[slot];
+}
+
+void release_capture_block(audio_buffer_t* buffer)
+{
+    block_busy[buffer - blocks] = false;
+}
+
+CaptureStats get_capture_stats()
+{
+    return CaptureStats{ block_count, overruns };
+}
+
+} // namespace vfo_capture
@@ -0,0 +1,339 @@
+#include "cat.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "event_loop.h"
+#include "pico/stdio.h"
+#include "pico/stdlib.h"
+
+namespace vfo_cat
+{
+
+namespace
+{
+
+std::atomic<bool> rx_ready = false;
+
+void chars_available(void*)
+{
+    rx_ready.store(true, std::memory_order_relaxed);
+    vfo_loop::post_wake(vfo_loop::WAKE_CAT);
+}
+
+// Zero-padded decimal, most significant digit first
+void put_digits(char* dest, uint32_t value, uint32_t width)
+{
+    for (uint32_t i = width; i-- > 0;)
+    {
+        dest[i] = char('0' + value % 10);
+        value /= 10;
+    }
+}
+
+bool parse_digits(const char* src, uint32_t count, uint32_t& value)
+{
+    value = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (src[i] < '0' || src[i] > '9')
+        {
+            return false;
+        }
+        value = value * 10 + uint32_t(src[i] - '0');
+    }
+    return count > 0;
+}
+
+char mode_digit(vfo_band::Mode mode)
+{
+    switch (mode)
+    {
+    case vfo_band::Mode::LSB:
+        return '1';
+    case vfo_band::Mode::CW:
+        return '3';
+    default:
+        return '2';
+    }
+}
+
+} // namespace
+
+uint32_t CatParser::feed(char c)
+{
+    if (c == '\r' || c == '\n' || c == ' ')
+    {
+        return 0;
+    }
+    if (c != ';')
+    {
+        // Keep reading to the terminator after an overlong command, then reject it
+        if (length < CAT_MAX_COMMAND - 1)
+        {
+            command[length++] = c >= 'a' && c <= 'z' ? char(c - 'a' + 'A') : c;
+        }
+        else
+        {
+            overflow = true;
+        }
+        return 0;
+    }
+
+    uint32_t n = overflow || length < 2 ? reply_text("?;") : dispatch();
+    length = 0;
+    overflow = false;
+    return n;
+}
+
+uint32_t CatParser::dispatch()
+{
+    const char* args = command + 2;
+    uint32_t arg_len = length - 2;
+    uint32_t value;
+
+    switch (command[0] << 8 | command[1])
+    {
+    case 'F' << 8 | 'A':
+    case 'F' << 8 | 'B':
+    {
+        bool a = command[1] == 'A';
+        if (arg_len == 0)
+        {
+            return reply_frequency(a ? "FA" : "FB", a ? vfo_a_hz : vfo_b_hz);
+        }
+        if (arg_len != 11 || !parse_digits(args, arg_len, value))
+        {
+            break;
+        }
+        if (a)
+        {
+            // Answer the next FA; from the new value; the radio loop puts back the
+            // frequency it is on if it refuses this one (outside the band plan)
+            vfo_a_hz = value;
+            pending.set_frequency = true;
+            pending.frequency_hz = value;
+        }
+        else
+        {
+            vfo_b_hz = value;
+        }
+        return 0;
+    }
+    case 'I' << 8 | 'F':
+        if (arg_len)
+        {
+            break;
+        }
+        // Frequency, step, RIT, memory and tone fields; only the mode is not zero
+        memcpy(out, "IF", 2);
+        put_digits(out + 2, vfo_a_hz, 11);
+        memcpy(out + 13, "     +000000000000000000;", 25);
+        out[29] = mode_digit(mode);
+        out[38] = '\0';
+        return 38;
+    case 'M' << 8 | 'D':
+        if (arg_len == 0)
+        {
+            out[0] = 'M';
+            out[1] = 'D';
+            out[2] = mode_digit(mode);
+            out[3] = ';';
+            out[4] = '\0';
+            return 4;
+        }
+        if (arg_len != 1 || !parse_digits(args, 1, value))
+        {
+            break;
+        }
+        switch (value)
+        {
+        case 1:
+            mode = vfo_band::Mode::LSB;
+            break;
+        case 2:
+            mode = vfo_band::Mode::USB;
+            break;
+        case 3:
+        case 7:
+            mode = vfo_band::Mode::CW;
+            break;
+        default:
+            return reply_text("?;");
+        }
+        pending.set_mode = true;
+        pending.mode = mode;
+        return 0;
+    case 'I' << 8 | 'D':
+        if (arg_len)
+        {
+            break;
+        }
+        memcpy(out, "ID", 2);
+        put_digits(out + 2, CAT_RADIO_ID, 3);
+        out[5] = ';';
+        out[6] = '\0';
+        return 6;
+    // Accepted so that logging programs can connect; the answers never change
+    case 'A' << 8 | 'I':
+        return arg_len ? 0 : reply_text("AI0;");
+    case 'P' << 8 | 'S':
+        return arg_len ? 0 : reply_text("PS1;");
+    case 'F' << 8 | 'R':
+        return arg_len ? 0 : reply_text("FR0;");
+    case 'F' << 8 | 'T':
+        return arg_len ? 0 : reply_text("FT0;");
+    case 'K' << 8 | 'S':
+        if (arg_len == 0)
+        {
+            memcpy(out, "KS", 2);
+            put_digits(out + 2, keyer_wpm, 3);
+            out[5] = ';';
+            out[6] = '\0';
+            return 6;
+        }
+        if (arg_len != 3 || !parse_digits(args, arg_len, value) || value < KEYER_MIN_WPM || value > KEYER_MAX_WPM)
+        {
+            break;
+        }
+        keyer_wpm = value;
+        pending.set_keyer = true;
+        pending.keyer_wpm = keyer_wpm;
+        pending.keyer_mode = keyer_mode;
+        return 0;
+    // Not Kenwood: keyer mode, 0 straight key, 1 iambic A, 2 iambic B
+    case 'Z' << 8 | 'K':
+        if (arg_len == 0)
+        {
+            out[0] = 'Z';
+            out[1] = 'K';
+            out[2] = char('0' + uint32_t(keyer_mode));
+            out[3] = ';';
+            out[4] = '\0';
+            return 4;
+        }
+        if (arg_len != 1 || !parse_digits(args, 1, value) || value > uint32_t(vfo_audio::KeyerMode::IambicB))
+        {
+            break;
+        }
+        keyer_mode = vfo_audio::KeyerMode(value);
+        pending.set_keyer = true;
+        pending.keyer_wpm = keyer_wpm;
+        pending.keyer_mode = keyer_mode;
+        return 0;
+    // Not Kenwood: dump the latency trace, which is too long to answer from here
+    case 'T' << 8 | 'D':
+        if (arg_len)
+        {
+            break;
+        }
+        pending.dump_trace = true;
+        return 0;
+    // Not Kenwood either: the curve follows on the port once the sweep is done
+    case 'Z' << 8 | 'A':
+        if (arg_len)
+        {
+            break;
+        }
+        pending.analyze = true;
+        return 0;
+    default:
+        break;
+    }
+    return reply_text("?;");
+}
+
+uint32_t CatParser::reply_frequency(const char* code, uint32_t hz)
+{
+    out[0] = code[0];
+    out[1] = code[1];
+    put_digits(out + 2, hz, 11);
+    out[13] = ';';
+    out[14] = '\0';
+    return 14;
+}
+
+uint32_t CatParser::reply_text(const char* text)
+{
+    uint32_t n = uint32_t(strlen(text));
+    memcpy(out, text, n + 1);
+    return n;
+}
+
+void CatParser::update_rig(uint32_t hz, vfo_band::Mode rig_mode)
+{
+    vfo_a_hz = hz;
+    mode = rig_mode;
+    if (vfo_b_hz == 0)
+    {
+        vfo_b_hz = hz;
+    }
+}
+
+void CatParser::update_keyer(uint32_t wpm, vfo_audio::KeyerMode new_mode)
+{
+    keyer_wpm = wpm;
+    keyer_mode = new_mode;
+}
+
+bool CatParser::take_request(CatRequest& request)
+{
+    if (!pending.set_frequency && !pending.set_mode && !pending.dump_trace && !pending.analyze
+        && !pending.set_keyer)
+    {
+        return false;
+    }
+    request = pending;
+    pending = {};
+    return true;
+}
+
+void start_cat()
+{
+    stdio_set_chars_available_callback(chars_available, nullptr);
+}
+
+void poll_cat(CatParser& parser)
+{
+    if (!rx_ready.exchange(false, std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    // Replies are gathered so one USB write answers a whole burst of polls
+    char tx[CAT_MAX_REPLY * 4];
+    uint32_t tx_len = 0;
+
+    for (uint32_t i = 0; i < CAT_BYTES_PER_POLL; i++)
+    {
+        int c = getchar_timeout_us(0);
+        if (c == PICO_ERROR_TIMEOUT)
+        {
+            break;
+        }
+        if (uint32_t n = parser.feed(char(c)))
+        {
+            if (tx_len + n > sizeof(tx))
+            {
+                stdio_put_string(tx, int(tx_len), false, false);
+                tx_len = 0;
+            }
+            memcpy(tx + tx_len, parser.reply(), n);
+            tx_len += n;
+        }
+
+        // More may be waiting; come back on the next pass rather than hold up the loop
+        if (i == CAT_BYTES_PER_POLL - 1)
+        {
+            rx_ready.store(true, std::memory_order_relaxed);
+            vfo_loop::post_wake(vfo_loop::WAKE_CAT);
+        }
+    }
+
+    if (tx_len)
+    {
+        stdio_put_string(tx, int(tx_len), false, false);
+    }
+}
+
+} // namespace vfo_cat
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+
+#include "band_plan.h"
+#include "keyer.h"
+
+// Kenwood-style CAT control (TS-480 command subset) over USB CDC.
+// Bytes are parsed as they arrive, so a command split across USB packets costs
+// nothing extra. Queries are answered at once from cached rig state; set
+// commands update the cache and leave a request for the main loop to apply.
+namespace vfo_cat
+{
+
+#define CAT_MAX_COMMAND 24 // Longest command accepted, including the terminator
+#define CAT_MAX_REPLY 40 // Longest reply (IF) plus the terminator
+#define CAT_BYTES_PER_POLL 64 // Bytes parsed per main loop pass before yielding
+#define CAT_RADIO_ID 20 // Reported by ID; hamlib treats this as a TS-480
+
+struct CatRequest
+{
+    bool set_frequency;
+    bool set_mode;
+    bool dump_trace; // TD; write the latency trace (trace.h), link and boot timings to the port
+    bool analyze; // ZA; sweep the band with the antenna analyzer (analyzer.h)
+    bool set_keyer; // KS (speed) or ZK (mode)
+    uint32_t frequency_hz;
+    vfo_band::Mode mode;
+    uint32_t keyer_wpm;
+    vfo_audio::KeyerMode keyer_mode;
+};
+
+class CatParser
+{
+public:
+    // Consume one byte. Returns the length of the reply once a command is
+    // complete, 0 when there is nothing to send; the reply is in reply().
+    uint32_t feed(char c);
+    const char* reply() const
+    {
+        return out;
+    }
+
+    // Cached rig state, refreshed by the main loop after it tunes
+    void update_rig(uint32_t hz, vfo_band::Mode rig_mode);
+    void update_keyer(uint32_t wpm, vfo_audio::KeyerMode mode);
+
+    // Changes asked for since the last call; returns false if there are none
+    bool take_request(CatRequest& request);
+
+private:
+    uint32_t dispatch();
+    uint32_t reply_frequency(const char* code, uint32_t hz);
+    uint32_t reply_text(const char* text);
+
+    char command[CAT_MAX_COMMAND];
+    uint32_t length = 0;
+    bool overflow = false;
+    char out[CAT_MAX_REPLY];
+
+    uint32_t vfo_a_hz = 0;
+    uint32_t vfo_b_hz = 0;
+    vfo_band::Mode mode = vfo_band::Mode::USB;
+    uint32_t keyer_wpm = 0;
+    vfo_audio::KeyerMode keyer_mode = vfo_audio::KeyerMode::IambicB;
+
+    CatRequest pending = {};
+};
+
+// Watch the USB CDC port; arriving bytes post WAKE_CAT
+void start_cat();
+
+// Parse what has arrived and send the replies; never waits for input
+void poll_cat(CatParser& parser);
+
+} // namespace vfo_cat
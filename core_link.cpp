@@ -0,0 +1,51 @@
+#include "core_link.h"
+
+#include "event_loop.h"
+#include "hal.h"
+
+namespace vfo_link
+{
+
+Mailbox<TuneRequest> tune_requests;
+Mailbox<RadioState> radio_state;
+
+namespace
+{
+
+// Written by the radio loop only
+std::atomic<uint32_t> apply_last_us = 0;
+std::atomic<uint32_t> apply_max_us = 0;
+
+} // namespace
+
+void wake_radio()
+{
+#if VFO_DUAL_CORE
+    // Core 1 sleeps in wait_for_wake() between passes
+    vfo_loop::post_wake(vfo_loop::WAKE_TUNE);
+#endif
+}
+
+void note_applied(const TuneRequest& request)
+{
+    uint32_t elapsed = hal_time_us() - request.time_us;
+    apply_last_us.store(elapsed, std::memory_order_relaxed);
+    if (elapsed > apply_max_us.load(std::memory_order_relaxed))
+    {
+        apply_max_us.store(elapsed, std::memory_order_relaxed);
+    }
+}
+
+LinkStats get_link_stats()
+{
+    return LinkStats{
+        tune_requests.published(),
+        tune_requests.coalesced(),
+        radio_state.published(),
+        radio_state.coalesced(),
+        apply_last_us.load(std::memory_order_relaxed),
+        apply_max_us.load(std::memory_order_relaxed),
+    };
+}
+
+} // namespace vfo_link
@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#include "band_plan.h"
+
+// Messages between the user interface (main loop, core 0) and the radio loop
+// (radio.h, core 1 with VFO_DUAL_CORE). Each direction is a mailbox holding the
+// latest message only: a reader always gets the newest complete one, and
+// messages written faster than they are read are coalesced, never queued.
+// Receivers are woken by SEV; a mailbox needs no other signal.
+namespace vfo_link
+{
+
+// Lock-free single-writer/single-reader latest-value mailbox (a triple buffer).
+// The writer fills a slot of its own and swaps it with the shared middle slot;
+// the reader swaps its slot with the middle one when that holds a fresh message.
+// Neither side waits, and neither touches a slot the other one owns.
+template <typename T>
+class Mailbox
+{
+public:
+    // Writer
+    void publish(const T& message)
+    {
+        slots[back] = message;
+        uint32_t old = middle.exchange(back | fresh, std::memory_order_acq_rel);
+        back = old & index_mask;
+
+        writes.store(writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (old & fresh)
+        {
+            overwritten.store(overwritten.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    // Reader; returns false if nothing was published since the last take
+    bool take(T& message)
+    {
+        if (!(middle.load(std::memory_order_relaxed) & fresh))
+        {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+        message = slots[front];
+        return true;
+    }
+
+    uint32_t published() const
+    {
+        return writes.load(std::memory_order_relaxed);
+    }
+
+    // Messages replaced before the reader took them
+    uint32_t coalesced() const
+    {
+        return overwritten.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint32_t index_mask = 3;
+    static constexpr uint32_t fresh = 4;
+
+    T slots[3] = {};
+    std::atomic<uint32_t> middle = 1;
+    uint32_t back = 0; // Writer's slot
+    uint32_t front = 2; // Reader's slot
+
+    std::atomic<uint32_t> writes = 0;
+    std::atomic<uint32_t> overwritten = 0;
+};
+
+// Core 0 to core 1: where the user has tuned
+struct TuneRequest
+{
+    uint32_t seq; // Numbers the requests, so the state can say which it has applied
+    uint32_t time_us; // When the input behind it was seen
+    uint32_t hz;
+    uint8_t band;
+};
+
+// Core 1 to core 0: what the radio is doing, for the display and the settings
+struct RadioState
+{
+    uint32_t request_seq; // Last TuneRequest applied
+    uint32_t hz;
+    uint8_t band;
+    vfo_band::Mode mode;
+    bool audio_ok;
+};
+
+struct LinkStats
+{
+    uint32_t requests;
+    uint32_t requests_coalesced;
+    uint32_t states;
+    uint32_t states_coalesced;
+    uint32_t apply_last_us; // Input seen to the synthesizer written, last request
+    uint32_t apply_max_us;
+};
+
+extern Mailbox<TuneRequest> tune_requests;
+extern Mailbox<RadioState> radio_state;
+
+// After publishing a request; nothing to do when the radio loop runs on this core
+void wake_radio();
+
+// Radio loop, once a request has reached the synthesizer
+void note_applied(const TuneRequest& request);
+
+LinkStats get_link_stats();
+
+} // namespace vfo_link
@@ -0,0 +1,209 @@
+#include "demod.h"
+#include "audio.h"
+#include "capture.h"
+#include "event_loop.h"
+
+#include "pico/stdlib.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vfo_demod
+{
+
+namespace
+{
+
+constexpr auto hilbert = hilbert_taps<DEMOD_HILBERT_TAPS>();
+
+} // namespace
+
+SsbDemodulator::SsbDemodulator(uint32_t input_rate)
+    : i_decimator(vfo_dsp::fir_lowpass<DEMOD_DECIMATION_TAPS>(input_rate, 4000))
+    , q_decimator(vfo_dsp::fir_lowpass<DEMOD_DECIMATION_TAPS>(input_rate, 4000))
+{
+}
+
+uint32_t SsbDemodulator::process(int16_t* iq, uint32_t frames)
+{
+    // USB keeps I - H(Q), LSB keeps I + H(Q)
+    const bool lsb = sideband.load(std::memory_order_relaxed) == Sideband::LSB;
+
+    frames = std::min(frames, uint32_t(DEMOD_MAX_FRAMES));
+    for (uint32_t n = 0; n < frames; n++)
+    {
+        i_block[n] = iq[n * 2];
+        q_block[n] = iq[n * 2 + 1];
+    }
+    uint32_t count = i_decimator.process(i_block.data(), frames);
+    q_decimator.process(q_block.data(), frames);
+
+    for (uint32_t n = 0; n < count; n++)
+    {
+        pos = pos ? pos - 1 : DEMOD_HILBERT_TAPS - 1;
+        i_line[pos] = i_line[pos + DEMOD_HILBERT_TAPS] = i_block[n];
+        q_line[pos] = q_line[pos + DEMOD_HILBERT_TAPS] = q_block[n];
+
+        const int16_t* q = &q_line[pos + mid];
+        int32_t hq = 0;
+        for (uint32_t j = 0; j < hilbert.size(); j++)
+        {
+            uint32_t m = 2 * j + 1;
+            hq += hilbert[j] * (q[m] - q[-int32_t(m)]);
+        }
+        hq >>= 15;
+
+        int32_t i = i_line[pos + mid];
+        iq[n] = vfo_dsp::sat16((lsb ? i + hq : i - hq) >> 1);
+    }
+
+    return count;
+}
+
+namespace
+{
+
+SsbDemodulator demod(AUDIO_SAMPLE_RATE * DEMOD_DECIMATION);
+
+volatile uint32_t blocks = 0;
+volatile uint32_t last_us = 0;
+volatile uint32_t max_us = 0;
+
+// Output buffer currently being filled
+audio_buffer_t* out_buffer = nullptr;
+uint32_t out_fill = 0;
+int16_t sidetone[SAMPLES_PER_BUFFER];
+
+// Audio from the last capture block still waiting for an output buffer
+int16_t pending[DEMOD_MAX_FRAMES];
+uint32_t pending_at = 0;
+uint32_t pending_count = 0;
+volatile uint32_t output_stalls = 0;
+
+// Single slot handed to core 0 for the band-scope
+int16_t scope_frames[SAMPLES_PER_BUFFER * CAPTURE_CHANNELS];
+std::atomic<bool> scope_ready = false;
+
+// Moves pending audio into output buffers for as long as the I2S side has one
+// free; true once none is left. Never waits: a buffer coming back posts
+// WAKE_AUDIO, which brings the caller back here.
+bool flush_audio()
+{
+    audio_buffer_pool* pool = vfo_audio::get_audio_pool();
+    while (pending_count)
+    {
+        if (!out_buffer)
+        {
+            out_buffer = hal_audio_take(pool, false);
+            if (!out_buffer)
+            {
+                return false;
+            }
+            out_fill = 0;
+        }
+
+        int16_t* samples = (int16_t*)out_buffer->buffer->bytes;
+        uint32_t n = std::min(pending_count, out_buffer->max_sample_count - out_fill);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            samples[out_fill + i] = pending[pending_at + i];
+        }
+        out_fill += n;
+        pending_at += n;
+        pending_count -= n;
+
+        if (out_fill == out_buffer->max_sample_count)
+        {
+            // Mix in the keyer sidetone before the shared output stages
+            vfo_audio::render_sidetone(sidetone, out_fill);
+            for (uint32_t i = 0; i < out_fill; i++)
+            {
+                samples[i] = vfo_dsp::sat16(samples[i] + sidetone[i]);
+            }
+            vfo_audio::finish_block(samples, out_fill);
+
+            out_buffer->sample_count = out_fill;
+            hal_audio_give(pool, out_buffer);
+            out_buffer = nullptr;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void start_demod()
+{
+    vfo_audio::set_external_source(true);
+
+    // Capture is started here so its DMA interrupt is serviced by this core
+    vfo_capture::start_capture(AUDIO_SAMPLE_RATE * DEMOD_DECIMATION);
+}
+
+bool service_demod()
+{
+    // The next block waits in capture until the last one's audio is out
+    if (pending_count)
+    {
+        uint32_t before = pending_count;
+        if (!flush_audio())
+        {
+            output_stalls = output_stalls + 1;
+            return pending_count != before;
+        }
+    }
+
+    audio_buffer_t* block = vfo_capture::take_capture_block();
+    if (!block)
+    {
+        return false;
+    }
+
+    uint32_t start = time_us_32();
+    int16_t* iq = vfo_capture::capture_to_signed(block);
+    if (!scope_ready.load(std::memory_order_acquire) && block->sample_count == SAMPLES_PER_BUFFER)
+    {
+        memcpy(scope_frames, iq, sizeof(scope_frames));
+        scope_ready.store(true, std::memory_order_release);
+        vfo_loop::post_wake(vfo_loop::WAKE_SCOPE);
+    }
+    uint32_t count = demod.process(iq, block->sample_count);
+    uint32_t elapsed = time_us_32() - start;
+
+    memcpy(pending, iq, count * sizeof(int16_t));
+    pending_at = 0;
+    pending_count = count;
+    vfo_capture::release_capture_block(block);
+    flush_audio();
+
+    last_us = elapsed;
+    if (elapsed > max_us)
+    {
+        max_us = elapsed;
+    }
+    blocks = blocks + 1;
+    return true;
+}
+
+void set_sideband(Sideband sideband)
+{
+    demod.set_sideband(sideband);
+}
+
+const int16_t* peek_scope_frames()
+{
+    return scope_ready.load(std::memory_order_acquire) ? scope_frames : nullptr;
+}
+
+void release_scope_frames()
+{
+    scope_ready.store(false, std::memory_order_release);
+}
+
+DemodStats get_demod_stats()
+{
+    uint32_t budget = (SAMPLES_PER_BUFFER * 1000000ull) / (AUDIO_SAMPLE_RATE * DEMOD_DECIMATION);
+    return DemodStats{ blocks, last_us, max_us, budget, output_stalls };
+}
+
+} // namespace vfo_demod
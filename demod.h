@@ -0,0 +1,101 @@
+#pragma once
+#include "dsp.h"
+
+#include <atomic>
+
+// Phasing-method SSB demodulator.
+// I and Q are low-passed and decimated to the audio rate first, so the Hilbert FIR
+// gets its full length at the lower rate. I is then delayed to the centre of the
+// Hilbert FIR run over Q, and their sum or difference cancels the unwanted sideband.
+namespace vfo_demod
+{
+
+#define DEMOD_HILBERT_TAPS 127
+#define DEMOD_DECIMATION 2
+#define DEMOD_DECIMATION_TAPS 32
+#define DEMOD_MAX_FRAMES 256
+
+enum class Sideband : uint8_t
+{
+    USB,
+    LSB
+};
+
+// Odd-offset taps of a Hamming-windowed Hilbert transformer; even offsets are zero
+// and the response is antisymmetric, so only h[1], h[3], ... h[N/2] are stored.
+template <uint32_t Taps>
+constexpr std::array<int16_t, (Taps + 1) / 4> hilbert_taps()
+{
+    static_assert(Taps % 4 == 3, "Hilbert length must be 4n + 3 so the outermost taps are odd");
+    constexpr uint32_t mid = (Taps - 1) / 2;
+    std::array<int16_t, (Taps + 1) / 4> taps = {};
+    for (uint32_t j = 0; j < taps.size(); j++)
+    {
+        uint32_t m = 2 * j + 1;
+        double window = 0.54 - 0.46 * vfo_dsp::detail::cos(2 * vfo_dsp::detail::pi * (mid + m) / (Taps - 1));
+        taps[j] = vfo_dsp::q15(2.0 / (vfo_dsp::detail::pi * m) * window);
+    }
+    return taps;
+}
+
+class SsbDemodulator
+{
+public:
+    SsbDemodulator(uint32_t input_rate);
+
+    void set_sideband(Sideband s)
+    {
+        sideband = s;
+    }
+    Sideband get_sideband() const
+    {
+        return sideband;
+    }
+
+    // iq holds up to DEMOD_MAX_FRAMES interleaved signed I/Q frames; audio is
+    // written back over the front of the same buffer. Returns the number of audio samples.
+    uint32_t process(int16_t* iq, uint32_t frames);
+
+private:
+    static constexpr uint32_t mid = (DEMOD_HILBERT_TAPS - 1) / 2;
+
+    std::atomic<Sideband> sideband = Sideband::USB;
+
+    // De-interleaved, then decimated in place
+    std::array<int16_t, DEMOD_MAX_FRAMES> i_block = {};
+    std::array<int16_t, DEMOD_MAX_FRAMES> q_block = {};
+    vfo_dsp::DecimatingFir<DEMOD_DECIMATION_TAPS, DEMOD_DECIMATION> i_decimator;
+    vfo_dsp::DecimatingFir<DEMOD_DECIMATION_TAPS, DEMOD_DECIMATION> q_decimator;
+
+    // Mirrored delay lines at the audio rate, newest sample at [pos]
+    std::array<int16_t, DEMOD_HILBERT_TAPS * 2> i_line = {};
+    std::array<int16_t, DEMOD_HILBERT_TAPS * 2> q_line = {};
+    uint32_t pos = 0;
+};
+
+struct DemodStats
+{
+    uint32_t blocks;
+    uint32_t last_us; // Processing time of the last capture block
+    uint32_t max_us;
+    uint32_t budget_us; // Real-time length of one capture block
+    uint32_t output_stalls; // Passes that found no free output buffer for the last block's audio
+};
+
+// Start capture; the demodulator then owns the audio output pool. Call on the
+// core that will call service_demod(), the radio core (radio.h).
+void start_demod();
+
+// Demodulate one capture block if there is one; false if there was nothing to
+// do. Never waits: a block's audio that finds no free output buffer is held,
+// and the next block left in capture, until WAKE_AUDIO brings the caller back.
+bool service_demod();
+void set_sideband(Sideband sideband);
+DemodStats get_demod_stats();
+
+// Latest raw I/Q block for the band-scope (SAMPLES_PER_BUFFER signed frames),
+// or nullptr; release it once drawn so core 1 can publish the next one.
+const int16_t* peek_scope_frames();
+void release_scope_frames();
+
+} // namespace vfo_demod
@@ -0,0 +1,388 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#endif
+
+// Allocation-free fixed-point DSP stages for the audio path.
+// Every stage works in place on a block of int16 samples:
+//     uint32_t process(int16_t* samples, uint32_t count)
+// and returns the number of samples it left in the block (decimators shrink it).
+// Coefficients are designed in double precision at compile time and quantised to Q15/Q30.
+namespace vfo_dsp
+{
+
+namespace detail
+{
+
+constexpr double pi = 3.14159265358979323846;
+
+constexpr double cos(double x)
+{
+    // Reduce to [-pi, pi] then sum the Taylor series
+    while (x > pi)
+    {
+        x -= 2 * pi;
+    }
+    while (x < -pi)
+    {
+        x += 2 * pi;
+    }
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 20; n++)
+    {
+        term *= -x * x / ((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double sin(double x)
+{
+    return cos(x - pi / 2);
+}
+
+} // namespace detail
+
+constexpr int32_t to_fixed(double v, int frac_bits)
+{
+    double scaled = v * double(1ll << frac_bits);
+    scaled += scaled < 0 ? -0.5 : 0.5;
+    if (scaled > 2147483647.0)
+    {
+        return INT32_MAX;
+    }
+    if (scaled < -2147483648.0)
+    {
+        return INT32_MIN;
+    }
+    return int32_t(scaled);
+}
+
+constexpr int16_t q15(double v)
+{
+    int32_t q = to_fixed(v, 15);
+    return int16_t(q > INT16_MAX ? INT16_MAX : (q < INT16_MIN ? INT16_MIN : q));
+}
+
+constexpr int32_t q30(double v)
+{
+    return to_fixed(v, 30);
+}
+
+// Saturate to int16, using SSAT on cores with the DSP extension
+inline int16_t sat16(int32_t v)
+{
+#if defined(__ARM_FEATURE_DSP)
+    return int16_t(__ssat(v, 16));
+#else
+    return int16_t(v > INT16_MAX ? INT16_MAX : (v < INT16_MIN ? INT16_MIN : v));
+#endif
+}
+
+// Dual 16x16 multiply-accumulate of packed sample/tap pairs (SMLAD)
+inline int32_t mac16x2(int32_t acc, uint32_t x, uint32_t y)
+{
+#if defined(__ARM_FEATURE_DSP)
+    return __smlad(x, y, acc);
+#else
+    return acc + int16_t(x) * int16_t(y) + int16_t(x >> 16) * int16_t(y >> 16);
+#endif
+}
+
+//
+// Biquad IIR, direct form I, Q2.30 coefficients with a 64 bit accumulator (SMLAL).
+// The bits dropped from each output are added back into the next accumulator
+// (first-order error feedback); otherwise the poles amplify the truncation, by
+// hundreds of LSB at DC for a low high-pass corner.
+//
+struct BiquadCoeffs
+{
+    int32_t b0, b1, b2, a1, a2;
+};
+
+namespace detail
+{
+
+constexpr BiquadCoeffs normalise(double b0, double b1, double b2, double a0, double a1, double a2)
+{
+    return BiquadCoeffs{ q30(b0 / a0), q30(b1 / a0), q30(b2 / a0), q30(a1 / a0), q30(a2 / a0) };
+}
+
+} // namespace detail
+
+// RBJ audio EQ cookbook designs
+constexpr BiquadCoeffs biquad_lowpass(double fs, double f0, double q)
+{
+    double w0 = 2 * detail::pi * f0 / fs;
+    double c = detail::cos(w0);
+    double alpha = detail::sin(w0) / (2 * q);
+    return detail::normalise((1 - c) / 2, 1 - c, (1 - c) / 2, 1 + alpha, -2 * c, 1 - alpha);
+}
+
+constexpr BiquadCoeffs biquad_highpass(double fs, double f0, double q)
+{
+    double w0 = 2 * detail::pi * f0 / fs;
+    double c = detail::cos(w0);
+    double alpha = detail::sin(w0) / (2 * q);
+    return detail::normalise((1 + c) / 2, -(1 + c), (1 + c) / 2, 1 + alpha, -2 * c, 1 - alpha);
+}
+
+// Constant 0dB peak gain
+constexpr BiquadCoeffs biquad_bandpass(double fs, double f0, double q)
+{
+    double w0 = 2 * detail::pi * f0 / fs;
+    double c = detail::cos(w0);
+    double alpha = detail::sin(w0) / (2 * q);
+    return detail::normalise(alpha, 0, -alpha, 1 + alpha, -2 * c, 1 - alpha);
+}
+
+class Biquad
+{
+public:
+    constexpr Biquad(const BiquadCoeffs& coeffs)
+        : c(coeffs)
+    {
+    }
+
+    uint32_t process(int16_t* samples, uint32_t count)
+    {
+        int32_t x1 = s[0], x2 = s[1], y1 = s[2], y2 = s[3], error = s[4];
+        for (uint32_t i = 0; i < count; i++)
+        {
+            int32_t x0 = samples[i];
+            int64_t acc = error;
+            acc += int64_t(c.b0) * x0;
+            acc += int64_t(c.b1) * x1;
+            acc += int64_t(c.b2) * x2;
+            acc -= int64_t(c.a1) * y1;
+            acc -= int64_t(c.a2) * y2;
+            int32_t y0 = sat16(int32_t(acc >> 30));
+            error = int32_t(acc & ((1 << 30) - 1));
+            x2 = x1;
+            x1 = x0;
+            y2 = y1;
+            y1 = y0;
+            samples[i] = int16_t(y0);
+        }
+        s = { x1, x2, y1, y2, error };
+        return count;
+    }
+
+    void reset()
+    {
+        s = {};
+    }
+
+private:
+    BiquadCoeffs c;
+    std::array<int32_t, 5> s = {};
+};
+
+//
+// Decimating FIR, Q15 taps. The delay line is mirrored so the dot product is
+// always over one contiguous window and can be walked two taps at a time (SMLAD).
+//
+template <uint32_t Taps>
+using FirTaps = std::array<int16_t, Taps>;
+
+// Windowed-sinc (Hamming) low pass
+template <uint32_t Taps>
+constexpr FirTaps<Taps> fir_lowpass(double fs, double fc)
+{
+    std::array<double, Taps> h = {};
+    double sum = 0;
+    double mid = (Taps - 1) / 2.0;
+    for (uint32_t n = 0; n < Taps; n++)
+    {
+        double t = n - mid;
+        double sinc = t == 0 ? 2 * fc / fs : detail::sin(2 * detail::pi * fc / fs * t) / (detail::pi * t);
+        double window = 0.54 - 0.46 * detail::cos(2 * detail::pi * n / (Taps - 1));
+        h[n] = sinc * window;
+        sum += h[n];
+    }
+
+    // Unity gain at DC
+    FirTaps<Taps> taps = {};
+    for (uint32_t n = 0; n < Taps; n++)
+    {
+        taps[n] = q15(h[n] / sum);
+    }
+    return taps;
+}
+
+template <uint32_t Taps, uint32_t Factor = 1>
+class DecimatingFir
+{
+    static_assert(Taps % 2 == 0, "Tap count must be even for the dual MAC");
+    static_assert(Factor >= 1, "Decimation factor must be at least 1");
+
+public:
+    constexpr DecimatingFir(const FirTaps<Taps>& taps)
+        : h(taps)
+    {
+    }
+
+    uint32_t process(int16_t* samples, uint32_t count)
+    {
+        uint32_t out = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pos = pos ? pos - 1 : Taps - 1;
+            line[pos] = samples[i];
+            line[pos + Taps] = samples[i];
+
+            if (++phase < Factor)
+            {
+                continue;
+            }
+            phase = 0;
+
+            // line[pos] is the newest sample, h[0] the newest tap
+            const int16_t* x = &line[pos];
+            int32_t acc = 0;
+            for (uint32_t n = 0; n < Taps; n += 2)
+            {
+                uint32_t xx, hh;
+                memcpy(&xx, x + n, sizeof(xx));
+                memcpy(&hh, &h[n], sizeof(hh));
+                acc = mac16x2(acc, xx, hh);
+            }
+            samples[out++] = sat16(acc >> 15);
+        }
+        return out;
+    }
+
+    void reset()
+    {
+        line = {};
+        pos = 0;
+        phase = 0;
+    }
+
+private:
+    FirTaps<Taps> h;
+    std::array<int16_t, Taps * 2> line = {};
+    uint32_t pos = 0;
+    uint32_t phase = 0;
+};
+
+//
+// Gain, Q4.12 so that up to 8x of make-up gain is available
+//
+class Gain
+{
+public:
+    static constexpr int32_t unity = 1 << 12;
+
+    constexpr Gain(int32_t gain_q12 = unity)
+        : gain(gain_q12)
+    {
+    }
+
+    void set_gain(int32_t gain_q12)
+    {
+        gain = gain_q12;
+    }
+
+    uint32_t process(int16_t* samples, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            samples[i] = sat16((samples[i] * gain) >> 12);
+        }
+        return count;
+    }
+
+private:
+    int32_t gain;
+};
+
+//
+// Peak limiter; instant attack, exponential release. The gain is threshold /
+// envelope in Q15, worked out with a 32 bit divide only when the envelope's
+// whole-sample level changes, so each limited sample costs one multiply.
+//
+class Limiter
+{
+public:
+    // threshold is above zero; release_shift sets the release time constant to
+    // 2^release_shift samples
+    constexpr Limiter(int16_t threshold, uint32_t release_shift = 10)
+        : threshold(threshold)
+        , release(release_shift)
+    {
+    }
+
+    uint32_t process(int16_t* samples, uint32_t count)
+    {
+        const int32_t limit = int32_t(threshold) << 15;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            int32_t x = samples[i];
+            // Released first, so the envelope is never under the sample it scales
+            int32_t level = (x < 0 ? -x : x) << 15;
+            envelope -= envelope >> release;
+            if (level > envelope)
+            {
+                envelope = level;
+            }
+
+            if (envelope > limit)
+            {
+                // Above the limit the level is at least threshold, so the gain is at most 1.0
+                uint32_t envelope_level = uint32_t(envelope) >> 15;
+                if (envelope_level != gain_level)
+                {
+                    gain_level = envelope_level;
+                    gain = int32_t((uint32_t(threshold) << 15) / envelope_level);
+                }
+                x = (x * gain) >> 15;
+            }
+            samples[i] = int16_t(x);
+        }
+        return count;
+    }
+
+private:
+    int16_t threshold;
+    uint32_t release;
+    int32_t envelope = 0;
+    uint32_t gain_level = 0; // Envelope level, in samples, that gain was worked out for
+    int32_t gain = 1 << 15;
+};
+
+//
+// A fixed chain of stages, run in order over the same block
+//
+template <typename... Stages>
+class Pipeline
+{
+public:
+    constexpr Pipeline(Stages... s)
+        : stages(s...)
+    {
+    }
+
+    uint32_t process(int16_t* samples, uint32_t count)
+    {
+        std::apply([&](auto&... stage) { ((count = stage.process(samples, count)), ...); }, stages);
+        return count;
+    }
+
+    template <size_t I>
+    auto& stage()
+    {
+        return std::get<I>(stages);
+    }
+
+private:
+    std::tuple<Stages...> stages;
+};
+
+} // namespace vfo_dsp
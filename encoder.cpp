@@ -0,0 +1,44 @@
+#include "encoder.h"
+
+#include "event_loop.h"
+#include "hal.h"
+#include "placement.h"
+#include "rotary_decoder.h"
+#include "trace.h"
+
+namespace vfo_input
+{
+
+namespace
+{
+
+RotaryDecoder decoder(0, 1);
+InputQueue* events = nullptr;
+
+void HOT_FUNC(encoder_callback)(uint gpio, uint32_t)
+{
+    if (decoder.uses_pin(gpio))
+    {
+        if (int8_t step = decoder.process(hal_gpio_get_all()))
+        {
+            TRACE(TRACE_ENCODER, step);
+            events->push({ hal_time_us(), InputEventType::Rotate, 0, step });
+            vfo_loop::post_wake(vfo_loop::WAKE_INPUT);
+        }
+    }
+}
+
+} // namespace
+
+void start_encoder(uint8_t pin_a, uint8_t pin_b, InputQueue& queue)
+{
+    decoder = RotaryDecoder(pin_a, pin_b);
+    events = &queue;
+
+    hal_gpio_input(pin_a, true);
+    hal_gpio_input(pin_b, true);
+    hal_gpio_on_edges(pin_a, &encoder_callback);
+    hal_gpio_on_edges(pin_b, &encoder_callback);
+}
+
+} // namespace vfo_input
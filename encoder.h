@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+#include "input_events.h"
+
+// Tuning encoder decoded in the GPIO edge interrupt with RotaryDecoder. Each
+// detent pushes a Rotate event (value +1 or -1) and wakes the main loop.
+namespace vfo_input
+{
+
+// pin_a/pin_b as for RotaryDecoder: A = DT and B = CLK gives +1 clockwise.
+// Claims the GPIO edge callback, which is shared by all pins.
+void start_encoder(uint8_t pin_a, uint8_t pin_b, InputQueue& queue);
+
+} // namespace vfo_input
@@ -0,0 +1,97 @@
+#include "event_loop.h"
+
+#include <atomic>
+
+#include "hal_audio.h"
+#include "hardware/sync.h"
+#include "placement.h"
+#include "pico/stdlib.h"
+
+namespace vfo_loop
+{
+
+namespace
+{
+
+std::atomic<uint32_t> pending = 0;
+
+// Each written only by its own loop
+LoopStats stats[LOOP_COUNT] = {};
+uint32_t active_since[LOOP_COUNT] = {};
+
+constexpr uint32_t loop_sources[LOOP_COUNT] = { MAIN_SOURCES, RADIO_SOURCES };
+
+void HOT_FUNC(audio_dma_irq)()
+{
+    // The output has acknowledged the DMA; this only notes that a buffer came back
+    post_wake(WAKE_AUDIO);
+}
+
+} // namespace
+
+void HOT_FUNC(post_wake)(uint32_t sources)
+{
+    pending.fetch_or(sources, std::memory_order_release);
+
+    // Sets the event register, so a WFE about to be entered returns straight away
+    __sev();
+}
+
+uint32_t wait_for_wake(Loop loop, absolute_time_t deadline)
+{
+    LoopStats& st = stats[loop];
+    const uint32_t mask = loop_sources[loop];
+
+    uint32_t sleep_start = time_us_32();
+    if (active_since[loop] != 0)
+    {
+        st.active_us += sleep_start - active_since[loop];
+    }
+
+    // Clears only this loop's bits; the other loop's stay posted for it
+    uint32_t sources;
+    while ((sources = pending.fetch_and(~mask, std::memory_order_acquire) & mask) == 0)
+    {
+        if (best_effort_wfe_or_timeout(deadline))
+        {
+            // Catch a post that raced with the deadline
+            sources = pending.fetch_and(~mask, std::memory_order_acquire) & mask;
+            break;
+        }
+        if ((pending.load(std::memory_order_relaxed) & mask) == 0)
+        {
+            st.spurious++;
+        }
+    }
+
+    if (sources)
+    {
+        st.wakes++;
+    }
+    else
+    {
+        st.timeouts++;
+    }
+
+    active_since[loop] = time_us_32();
+    st.idle_us += active_since[loop] - sleep_start;
+    return sources;
+}
+
+void enable_audio_wake()
+{
+    hal_audio_on_buffer_done(audio_dma_irq);
+}
+
+LoopStats get_loop_stats(Loop loop)
+{
+    return stats[loop];
+}
+
+uint32_t get_active_permille(Loop loop)
+{
+    uint64_t total = stats[loop].active_us + stats[loop].idle_us;
+    return total ? uint32_t(stats[loop].active_us * 1000 / total) : 0;
+}
+
+} // namespace vfo_loop
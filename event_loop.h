@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+
+#include "pico/time.h"
+
+// Loop wake-ups. Interrupt handlers (and the other core) post wake sources as
+// bits; a loop sleeps in WFE until one of its own is posted or its deadline
+// passes, and clears only its own, so the other core's stay posted for it.
+namespace vfo_loop
+{
+
+#ifndef VFO_DUAL_CORE
+#define VFO_DUAL_CORE 0
+#endif
+
+enum WakeSource : uint32_t
+{
+    WAKE_INPUT = 1 << 0, // Encoder or button event queued
+    WAKE_AUDIO = 1 << 1, // An output buffer was returned to the free list
+    WAKE_SCOPE = 1 << 2, // Core 1 published band-scope frames
+    WAKE_CAT = 1 << 3, // Bytes arrived on the USB CAT port
+    WAKE_RADIO = 1 << 4, // The radio loop (radio.h) published its state
+    WAKE_SWEEP = 1 << 5, // Sweep timer tick, for the radio loop (sweep.h)
+    WAKE_TUNE = 1 << 6, // Core 0 published a tune request (core_link.h)
+    WAKE_CAPTURE = 1 << 7, // The ADC capture filled a block (capture.h)
+};
+
+// The loops that wait here: the user interface in main(), and the radio loop
+// (radio.h), which has core 1 to itself with VFO_DUAL_CORE and is otherwise
+// run by the main loop, which then waits for its sources too
+enum Loop : uint32_t
+{
+    LOOP_MAIN,
+    LOOP_RADIO,
+    LOOP_COUNT
+};
+
+constexpr uint32_t RADIO_SOURCES = WAKE_AUDIO | WAKE_CAT | WAKE_SWEEP | WAKE_TUNE | WAKE_CAPTURE;
+constexpr uint32_t MAIN_SOURCES = WAKE_INPUT | WAKE_SCOPE | WAKE_RADIO | (VFO_DUAL_CORE ? 0 : RADIO_SOURCES);
+
+struct LoopStats
+{
+    uint32_t wakes; // Returns from wait_for_wake() with sources posted
+    uint32_t timeouts; // Returns at the deadline with nothing posted
+    uint32_t spurious; // WFE wake-ups with nothing posted, slept again
+    uint64_t active_us; // Time spent between waits
+    uint64_t idle_us; // Time spent inside wait_for_wake()
+};
+
+// Safe from any IRQ or core
+void post_wake(uint32_t sources);
+
+// Sleep until one of the loop's sources is posted or deadline; returns and
+// clears those (0 on timeout). Each loop calls it from one core only.
+uint32_t wait_for_wake(Loop loop, absolute_time_t deadline);
+
+// Post WAKE_AUDIO whenever the I2S DMA completes a buffer
+void enable_audio_wake();
+
+LoopStats get_loop_stats(Loop loop);
+
+// Share of the loop's time spent awake, 0-1000
+uint32_t get_active_permille(Loop loop);
+
+} // namespace vfo_loop
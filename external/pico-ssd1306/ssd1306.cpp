@@ -1,9 +1,9 @@
 #include "ssd1306.h"
 
 namespace pico_ssd1306 {
-    SSD1306::SSD1306(i2c_inst *i2CInst, uint16_t Address, Size size) {
+    SSD1306::SSD1306(uint i2cPort, uint16_t Address, Size size) {
         // Set class instanced variables
-        this->i2CInst = i2CInst;
+        this->i2cPort = i2cPort;
         this->address = Address;
         this->size = size;
 
@@ -18,8 +18,9 @@ namespace pico_ssd1306 {
         // display is not inverted by default
         this->inverted = false;
 
-        // this is a list of setup commands for the display
+        // this is a list of setup commands for the display, after the 0x00 byte saying they are all commands
         uint8_t setup[] = {
+                0x00,
                 SSD1306_DISPLAY_OFF,
                 SSD1306_LOWCOLUMN,
                 SSD1306_HIGHCOLUMN,
@@ -54,20 +55,16 @@ namespace pico_ssd1306 {
                 SSD1306_CHARGEPUMP,
                 0x14,
 
-                SSD1306_DISPLAYALL_ON_RESUME,
-                SSD1306_DISPLAY_ON
+                SSD1306_DISPLAYALL_ON_RESUME
         };
 
-        // send each one of the setup commands
-        for (uint8_t &command: setup) {
-            this->cmd(command);
-        }
+        // send the setup commands in one transfer
+        hal_i2c_write(this->i2cPort, this->address, setup, sizeof(setup), false);
 
-        // clear the buffer and send it to the display
-        // if not done display shows garbage data
+        // display ram holds garbage after power-on, so the display stays off until
+        // sendBuffer has overwritten all of it, instead of sending a blank frame now
         this->clear();
-        this->sendBuffer();
-
+        this->dark = true;
     }
 
     void SSD1306::setPixel(int16_t x, int16_t y, WriteMode mode) {
@@ -102,23 +99,42 @@ namespace pico_ssd1306 {
     }
 
     void SSD1306::sendBuffer() {
-        this->cmd(SSD1306_PAGEADDR); //Set page address from min to max
-        this->cmd(0x00);
-        this->cmd(0x07);
-        this->cmd(SSD1306_COLUMNADDR); //Set column address from min to max
+        this->sendPages(0, 7);
+        if (this->dark) {
+            this->cmd(SSD1306_DISPLAY_ON);
+            this->dark = false;
+        }
+    }
+
+    void SSD1306::sendPages(uint8_t first_page, uint8_t last_page) {
+        if (first_page > last_page || last_page > 7) return;
+
+        this->cmd(SSD1306_PAGEADDR);
+        this->cmd(first_page);
+        this->cmd(last_page);
+        this->cmd(SSD1306_COLUMNADDR);
         this->cmd(0x00);
         this->cmd(127);
 
-        // create a temporary buffer of size of buffer plus 1 byte for startline command aka 0x40
-        unsigned char data[FRAMEBUFFER_SIZE + 1];
+        // one transfer per page, each with the startline byte aka 0x40 in front; the display
+        // carries on from where the last one stopped. Whoever else is on the bus (the
+        // synthesizer, on the other core) waits for one page at most, not a whole frame
+        unsigned char data[128 + 1];
 
         data[0] = SSD1306_STARTLINE;
+        for (uint8_t page = first_page; page <= last_page; page++) {
+            memcpy(data + 1, frameBuffer.get() + page * 128, 128);
+            hal_i2c_write(this->i2cPort, this->address, data, sizeof(data), false);
+        }
+        TRACE(TRACE_DISPLAY_SENT, last_page - first_page + 1);
+    }
 
-        // copy framebuffer to temporary buffer
-        memcpy(data + 1, frameBuffer.get(), FRAMEBUFFER_SIZE);
+    void SSD1306::setStartLine(uint8_t line) {
+        this->cmd(SSD1306_STARTLINE | (line & 0x3F));
+    }
 
-        // send data to device
-        i2c_write_blocking(this->i2CInst, this->address, data, FRAMEBUFFER_SIZE + 1, false);
+    unsigned char *SSD1306::getBuffer() {
+        return this->frameBuffer.get();
     }
 
     void SSD1306::clear() {
@@ -163,7 +179,7 @@ namespace pico_ssd1306 {
     void SSD1306::cmd(unsigned char command) {
         // 0x00 is a byte indicating to ssd1306 that a command is being sent
         uint8_t data[2] = {0x00, command};
-        i2c_write_blocking(this->i2CInst, this->address, data, 2, false);
+        hal_i2c_write(this->i2cPort, this->address, data, 2, false);
     }
 
 
@@ -2,7 +2,8 @@
 #define SSD1306_SSD1306_H
 
 #include <string.h>
-#include "hardware/i2c.h"
+#include "hal.h"
+#include "trace.h"
 #include "frameBuffer/FrameBuffer.h"
 
 namespace pico_ssd1306 {
@@ -61,7 +62,7 @@ namespace pico_ssd1306 {
     /// \brief SSD1306 class represents i2c connection to display
     class SSD1306 {
     private:
-        i2c_inst *i2CInst;
+        uint i2cPort;
         uint16_t address;
         Size size;
 
@@ -71,16 +72,20 @@ namespace pico_ssd1306 {
 
         bool inverted;
 
+        // display still off, waiting for the first full frame
+        bool dark;
+
         /// \brief Sends single 8bit command to ssd1306 controller
         /// \param command - byte to be sent to controller
         void cmd(unsigned char command);
 
     public:
-        /// \brief SSD1306 constructor initialized display and sets all required registers for operation
-        /// \param i2CInst - i2c instance. Either i2c0 or i2c1
+        /// \brief SSD1306 constructor initialized display and sets all required registers for operation.
+        /// The display stays off until the first sendBuffer
+        /// \param i2cPort - i2c controller number. Either 0 or 1
         /// \param Address - display i2c address. usually for 128x32 0x3C and for 128x64 0x3D
         /// \param size - display size. Acceptable values W128xH32 or W128xH64
-        SSD1306(i2c_inst *i2CInst, uint16_t Address, Size size);
+        SSD1306(uint i2cPort, uint16_t Address, Size size);
 
         /// \brief Set pixel operates frame buffer
         /// x is the x position of pixel you want to change. values 0 - 127
@@ -90,9 +95,21 @@ namespace pico_ssd1306 {
         /// \param mode - mode describes setting behavior. See WriteMode doc for more information
         void setPixel(int16_t x, int16_t y, WriteMode mode = WriteMode::ADD);
 
-        /// \brief Sends frame buffer to display so that it updated
+        /// \brief Sends frame buffer to display so that it updated; the first call also turns the display on
         void sendBuffer();
 
+        /// \brief Sends only a range of 8 pixel high pages of the frame buffer
+        /// \param first_page - first page to send. values 0 - 7
+        /// \param last_page - last page to send, inclusive. values 0 - 7
+        void sendPages(uint8_t first_page, uint8_t last_page);
+
+        /// \brief Sets the display RAM row shown at the top of the screen, scrolling the whole display vertically
+        /// \param line - start line. values 0 - 63
+        void setStartLine(uint8_t line);
+
+        /// \brief Returns a pointer to the frame buffer, laid out as 8 pages of 128 column bytes
+        unsigned char *getBuffer();
+
         /// \brief Adds bitmap image to frame buffer
         /// \param anchorX - sets start point of where to put the image on the screen
         /// \param anchorY - sets start point of where to put the image on the screen
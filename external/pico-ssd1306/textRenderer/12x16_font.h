@@ -1,9 +1,12 @@
 #ifndef SSD1306_12X16_FONT_H
 #define SSD1306_12X16_FONT_H
 
+// The frequency readout font; drawn on every tune, so kept in SRAM with VFO_RAM_HOT
+#include "placement.h"
+
 #ifndef SSD1306_ASCII_FULL
 
-const unsigned char font_12x16[] = {
+const unsigned char font_12x16[] HOT_DATA("font_12x16") = {
     0x0C, 0x10, // font width, height
 
     0x0,
@@ -2382,7 +2385,7 @@ const unsigned char font_12x16[] = {
     0x0};
 
 #else
-const unsigned char font_12x16[] = {
+const unsigned char font_12x16[] HOT_DATA("font_12x16") = {
     0x0C,
     0x10, // font width, height
 
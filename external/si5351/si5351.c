@@ -25,6 +25,7 @@
  */
 
 #include "si5351.h"
+#include "placement.h"
 #include <stdint.h>
 
 struct Si5351Status dev_status = {0, 0, 0, 0, 0};
@@ -91,41 +92,44 @@ bool si5351_init(uint8_t i2c_addr, uint8_t xtal_load_c, uint32_t xo_freq, int32_
 	//gpio_pull_up(I2C0_SDA);
 	//gpio_pull_up(I2C0_SCL);
 
-	// Check for a device on the bus, bail out if it is not there
-	uint8_t reg_val = 0;
-
-	if(reg_val == 0) {
-		// Wait for SYS_INIT flag to be clear, indicating that device is ready
+	// Check for a device on the bus and wait for the SYS_INIT flag to clear,
+	// indicating that it is ready; bail out if neither happens in time
+	uint32_t start = hal_time_us();
+	while (true)
+	{
+		uint8_t reg = SI5351_DEVICE_STATUS;
 		uint8_t status_reg = 0;
-		do
-		{
-			status_reg = si5351_read(SI5351_DEVICE_STATUS);
-		} while (status_reg >> 7 == 1);
-
-		// Set crystal load capacitance
-		si5351_write(SI5351_CRYSTAL_LOAD, (xtal_load_c & SI5351_CRYSTAL_LOAD_MASK) | 0b00010010);
-
-		// Set up the XO reference frequency
-		if (xo_freq != 0)
+		if (hal_i2c_write(0, i2c_bus_addr, &reg, 1, true) == 1 &&
+			hal_i2c_read(0, i2c_bus_addr, &status_reg, 1, false) == 1 &&
+			!(status_reg & SI5351_STATUS_SYS_INIT))
 		{
-			set_ref_freq(xo_freq, SI5351_PLL_INPUT_XO);
+			break;
 		}
-		else
+		if (hal_time_us() - start > SI5351_READY_TIMEOUT_US)
 		{
-			set_ref_freq(SI5351_XTAL_FREQ, SI5351_PLL_INPUT_XO);
+			return false;
 		}
+	}
 
-		// Set the frequency calibration for the XO
-		set_correction(corr, SI5351_PLL_INPUT_XO);
-
-		si5351_reset();
+	// Set crystal load capacitance
+	si5351_write(SI5351_CRYSTAL_LOAD, (xtal_load_c & SI5351_CRYSTAL_LOAD_MASK) | 0b00010010);
 
-		return true;
+	// Set up the XO reference frequency
+	if (xo_freq != 0)
+	{
+		set_ref_freq(xo_freq, SI5351_PLL_INPUT_XO);
 	}
 	else
 	{
-		return false;
+		set_ref_freq(SI5351_XTAL_FREQ, SI5351_PLL_INPUT_XO);
 	}
+
+	// Set the frequency calibration for the XO
+	set_correction(corr, SI5351_PLL_INPUT_XO);
+
+	si5351_reset();
+
+	return true;
 }
 
 /*
@@ -135,65 +139,45 @@ bool si5351_init(uint8_t i2c_addr, uint8_t xtal_load_c, uint32_t xo_freq, int32_
  *
  */
 void si5351_reset(void) {
-	// Initialize the CLK outputs according to flowchart in datasheet
+	// Initialize the CLK outputs according to flowchart in datasheet.
+	// Registers that sit next to each other go in one burst, and the
+	// values are known, so nothing is read back: at boot every transfer
+	// on the slow bus delays the first RF out.
+	uint8_t ctrl[8];
+	uint8_t i;
+
 	// First, turn them off
-	si5351_write(16, 0x80);
-	si5351_write(17, 0x80);
-	si5351_write(18, 0x80);
-	si5351_write(19, 0x80);
-	si5351_write(20, 0x80);
-	si5351_write(21, 0x80);
-	si5351_write(22, 0x80);
-	si5351_write(23, 0x80);
-
-	// Turn the clocks back on...
-	si5351_write(16, 0x0c);
-	si5351_write(17, 0x0c);
-	si5351_write(18, 0x0c);
-	si5351_write(19, 0x0c);
-	si5351_write(20, 0x0c);
-	si5351_write(21, 0x0c);
-	si5351_write(22, 0x0c);
-	si5351_write(23, 0x0c);
+	for(i = 0; i < 8; i++)
+	{
+		ctrl[i] = 0x80;
+	}
+	si5351_write_bulk(SI5351_CLK0_CTRL, 8, ctrl);
+	si5351_write(SI5351_OUTPUT_ENABLE_CTRL, 0xff);
 
 	// Set PLLA and PLLB to 800 MHz for automatic tuning
 	set_pll(SI5351_PLL_FIXED, SI5351_PLLA);
 	set_pll(SI5351_PLL_FIXED, SI5351_PLLB);
 
-	// Make PLL to CLK assignments for automatic tuning
-	pll_assignment[0] = SI5351_PLLA;
-	pll_assignment[1] = SI5351_PLLA;
-	pll_assignment[2] = SI5351_PLLA;
-	pll_assignment[3] = SI5351_PLLA;
-	pll_assignment[4] = SI5351_PLLA;
-	pll_assignment[5] = SI5351_PLLA;
-	pll_assignment[6] = SI5351_PLLB;
-	pll_assignment[7] = SI5351_PLLB;
-
-	set_ms_source(SI5351_CLK0, SI5351_PLLA);
-	set_ms_source(SI5351_CLK1, SI5351_PLLA);
-	set_ms_source(SI5351_CLK2, SI5351_PLLA);
-	set_ms_source(SI5351_CLK3, SI5351_PLLA);
-	set_ms_source(SI5351_CLK4, SI5351_PLLA);
-	set_ms_source(SI5351_CLK5, SI5351_PLLA);
-	set_ms_source(SI5351_CLK6, SI5351_PLLB);
-	set_ms_source(SI5351_CLK7, SI5351_PLLB);
+	// Turn the clocks back on, with the PLL to CLK assignments for automatic
+	// tuning: CLK0-5 on PLLA, CLK6 and CLK7 on PLLB
+	for(i = 0; i < 8; i++)
+	{
+		pll_assignment[i] = i < 6 ? SI5351_PLLA : SI5351_PLLB;
+		ctrl[i] = 0x0c | (pll_assignment[i] == SI5351_PLLB ? SI5351_CLK_PLL_SELECT : 0);
+	}
+	si5351_write_bulk(SI5351_CLK0_CTRL, 8, ctrl);
 
 	// Reset the VCXO param
-	si5351_write(SI5351_VXCO_PARAMETERS_LOW, 0);
-	si5351_write(SI5351_VXCO_PARAMETERS_MID, 0);
-	si5351_write(SI5351_VXCO_PARAMETERS_HIGH, 0);
+	uint8_t vcxo[3] = { 0, 0, 0 };
+	si5351_write_bulk(SI5351_VXCO_PARAMETERS_LOW, 3, vcxo);
 
 	// Then reset the PLLs
-	pll_reset(SI5351_PLLA);
-	pll_reset(SI5351_PLLB);
+	si5351_write(SI5351_PLL_RESET, SI5351_PLL_RESET_A | SI5351_PLL_RESET_B);
 
-	// Set initial frequencies
-	uint8_t i;
+	// Set initial frequencies; the outputs stay disabled
 	for(i = 0; i < 8; i++)
 	{
 		clk_freq[i] = 0;
-		si5351_output_enable((enum si5351_clock)i, 0);
 		clk_first_set[i] = false;
 	}
 }
@@ -1330,7 +1314,7 @@ void set_ref_freq(uint32_t ref_freq, enum si5351_pll_input ref_osc)
 /* Private functions */
 /*********************/
 
-uint64_t pll_calc(enum si5351_pll pll, uint64_t freq, struct Si5351RegSet *reg, int32_t correction, uint8_t vcxo)
+uint64_t HOT_FUNC(pll_calc)(enum si5351_pll pll, uint64_t freq, struct Si5351RegSet *reg, int32_t correction, uint8_t vcxo)
 {
 	uint64_t ref_freq;
 	if(pll == SI5351_PLLA)
@@ -1789,7 +1773,7 @@ uint8_t select_r_div_ms67(uint64_t *freq)
 
 // Rebuild functions for Raspberry Pi Pico
 
-uint8_t si5351_write_bulk(uint8_t regAddr, uint8_t length, uint8_t *data) {
+uint8_t HOT_FUNC(si5351_write_bulk)(uint8_t regAddr, uint8_t length, uint8_t *data) {
   int num_bytes_read = 0;
   uint8_t msg[length + 1];
 
@@ -1800,7 +1784,8 @@ uint8_t si5351_write_bulk(uint8_t regAddr, uint8_t length, uint8_t *data) {
   }
 
   // Write data to register(s) over I2C
-  i2c_write_blocking(i2c0, i2c_bus_addr, msg, (length + 1), false);
+  hal_i2c_write(0, i2c_bus_addr, msg, (length + 1), false);
+  TRACE(TRACE_SI5351_WRITE, regAddr << 8 | length);
 
   return num_bytes_read;
 }
@@ -1814,8 +1799,8 @@ uint8_t si5351_write(uint8_t regAddr, uint8_t data) {
 uint8_t si5351_read(uint8_t regAddr) {
   uint8_t buf;
 
-  i2c_write_blocking(i2c0, i2c_bus_addr, &regAddr, 1, true);
-  i2c_read_blocking(i2c0, i2c_bus_addr, &buf, 1, false);
+  hal_i2c_write(0, i2c_bus_addr, &regAddr, 1, true);
+  hal_i2c_read(0, i2c_bus_addr, &buf, 1, false);
 
   return buf;
 }
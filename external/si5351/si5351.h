@@ -36,10 +36,8 @@
 
 #include <stdio.h>
 #include <math.h>
-#include "pico/stdlib.h"
-#include "hardware/i2c.h"
-#include "hardware/timer.h"
-#include "hardware/clocks.h"
+#include "hal.h"
+#include "trace.h"
 
 /* Define definitions */
 
@@ -79,6 +77,8 @@
 #define SI5351_VCXO_PULL_MAX            240
 #define SI5351_VCXO_MARGIN              103
 
+#define SI5351_READY_TIMEOUT_US         20000   // Power-on to SYS_INIT clear, with margin
+
 #define SI5351_DEVICE_STATUS            0
 #define SI5351_INTERRUPT_STATUS         1
 #define SI5351_INTERRUPT_MASK           2
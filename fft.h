@@ -0,0 +1,137 @@
+#pragma once
+#include "dsp.h"
+
+#include <utility>
+
+// Fixed-point complex FFT and log magnitude helpers.
+namespace vfo_dsp
+{
+
+namespace detail
+{
+
+// ln(x) for x > 0 via ln(x) = 2 atanh((x - 1) / (x + 1))
+constexpr double ln(double x)
+{
+    double z = (x - 1) / (x + 1);
+    double z2 = z * z;
+    double term = z;
+    double sum = 0;
+    for (int k = 0; k < 40; k++)
+    {
+        sum += term / (2 * k + 1);
+        term *= z2;
+    }
+    return 2 * sum;
+}
+
+constexpr std::array<uint8_t, 64> make_log2_table()
+{
+    std::array<uint8_t, 64> table = {};
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        table[i] = uint8_t(256 * ln(1 + i / 64.0) / ln(2.0) + 0.5);
+    }
+    return table;
+}
+
+inline constexpr auto log2_table = make_log2_table();
+
+} // namespace detail
+
+// log2(x) in Q8, from the leading bit position plus a 6 bit mantissa lookup
+inline uint32_t log2_q8(uint32_t x)
+{
+    if (x == 0)
+    {
+        return 0;
+    }
+    uint32_t msb = 31 - __builtin_clz(x);
+    uint32_t mantissa = msb >= 6 ? (x >> (msb - 6)) & 63 : (x << (6 - msb)) & 63;
+    return (msb << 8) + detail::log2_table[mantissa];
+}
+
+// Radix-2 decimation-in-time FFT on separate int16 real/imaginary arrays.
+// Each stage halves its output, so the result is scaled by 1/N and cannot overflow.
+template <uint32_t N>
+class Fft
+{
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "FFT size must be a power of two");
+
+public:
+    static constexpr uint32_t size = N;
+
+    // Hann window, Q15
+    static constexpr std::array<int16_t, N> window = [] {
+        std::array<int16_t, N> w = {};
+        for (uint32_t n = 0; n < N; n++)
+        {
+            w[n] = q15(0.5 - 0.5 * detail::cos(2 * detail::pi * n / N));
+        }
+        return w;
+    }();
+
+    static void forward(int16_t* re, int16_t* im)
+    {
+        // Bit-reversed reordering
+        for (uint32_t i = 1, j = 0; i < N; i++)
+        {
+            uint32_t bit = N >> 1;
+            for (; j & bit; bit >>= 1)
+            {
+                j ^= bit;
+            }
+            j ^= bit;
+            if (i < j)
+            {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+
+        for (uint32_t len = 2; len <= N; len <<= 1)
+        {
+            uint32_t half = len >> 1;
+            uint32_t step = N / len;
+            for (uint32_t i = 0; i < N; i += len)
+            {
+                for (uint32_t j = 0; j < half; j++)
+                {
+                    int32_t wr = twiddle_cos[j * step];
+                    int32_t wi = -twiddle_sin[j * step];
+                    uint32_t a = i + j;
+                    uint32_t b = a + half;
+                    int32_t tr = (re[b] * wr - im[b] * wi) >> 15;
+                    int32_t ti = (re[b] * wi + im[b] * wr) >> 15;
+                    int32_t ar = re[a];
+                    int32_t ai = im[a];
+                    re[a] = int16_t((ar + tr) >> 1);
+                    im[a] = int16_t((ai + ti) >> 1);
+                    re[b] = int16_t((ar - tr) >> 1);
+                    im[b] = int16_t((ai - ti) >> 1);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr std::array<int16_t, N / 2> twiddle_cos = [] {
+        std::array<int16_t, N / 2> t = {};
+        for (uint32_t k = 0; k < N / 2; k++)
+        {
+            t[k] = q15(detail::cos(2 * detail::pi * k / N));
+        }
+        return t;
+    }();
+
+    static constexpr std::array<int16_t, N / 2> twiddle_sin = [] {
+        std::array<int16_t, N / 2> t = {};
+        for (uint32_t k = 0; k < N / 2; k++)
+        {
+            t[k] = q15(detail::sin(2 * detail::pi * k / N));
+        }
+        return t;
+    }();
+};
+
+} // namespace vfo_dsp
@@ -0,0 +1,103 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Dial frequency in whole Hz, stepped one decimal digit at a time and formatted
+// into a caller's buffer; integer only, no heap.
+namespace vfo_ui
+{
+
+#define FREQUENCY_MAX_DIGITS 10
+
+inline constexpr std::array<uint32_t, FREQUENCY_MAX_DIGITS> pow10 = [] {
+    std::array<uint32_t, FREQUENCY_MAX_DIGITS> table = {};
+    uint32_t value = 1;
+    for (uint32_t i = 0; i < FREQUENCY_MAX_DIGITS; i++)
+    {
+        table[i] = value;
+        value *= 10;
+    }
+    return table;
+}();
+
+class Frequency
+{
+public:
+    constexpr explicit Frequency(uint32_t hz = 0)
+        : value(hz)
+    {
+    }
+
+    constexpr uint32_t hz() const
+    {
+        return value;
+    }
+
+    // Add count * step_hz, carrying into the higher digits, then clamp to [low, high].
+    // With snap the result is rounded to a multiple of step_hz.
+    constexpr void step(uint32_t step_hz, int32_t count, uint32_t low, uint32_t high, bool snap = false)
+    {
+        int64_t next = int64_t(value) + int64_t(step_hz) * count;
+        if (snap && step_hz > 1)
+        {
+            next = ((next + step_hz / 2) / step_hz) * step_hz;
+        }
+        value = next < int64_t(low) ? low : next > int64_t(high) ? high : uint32_t(next);
+    }
+
+    constexpr uint32_t digits() const
+    {
+        uint32_t n = 1;
+        while (n < FREQUENCY_MAX_DIGITS && value >= pow10[n])
+        {
+            n++;
+        }
+        return n;
+    }
+
+    // Character index of the digit worth 10^power in the format() output
+    constexpr uint32_t digit_column(uint32_t power) const
+    {
+        uint32_t n = digits();
+        if (power >= n)
+        {
+            return 0;
+        }
+        return (n - 1 - power) + ((n - 1) / 3 - power / 3);
+    }
+
+    // Write the digits grouped in threes ("7.074.000") and a terminator.
+    // Returns the length, or 0 (and an empty string) if size is too small.
+    constexpr uint32_t format(char* out, uint32_t size, char separator = '.') const
+    {
+        uint32_t n = digits();
+        uint32_t length = n + (n - 1) / 3;
+        if (length + 1 > size)
+        {
+            if (size)
+            {
+                out[0] = 0;
+            }
+            return 0;
+        }
+
+        uint32_t v = value;
+        uint32_t pos = length;
+        out[pos] = 0;
+        for (uint32_t power = 0; power < n; power++)
+        {
+            if (power && power % 3 == 0)
+            {
+                out[--pos] = separator;
+            }
+            out[--pos] = char('0' + v % 10);
+            v /= 10;
+        }
+        return length;
+    }
+
+private:
+    uint32_t value;
+};
+
+} // namespace vfo_ui
@@ -0,0 +1,144 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pico/time.h"
+
+// Hardware access for the drivers: I2C, GPIO and time.
+// On the device every call is an always-inline wrapper over the Pico SDK, so
+// it compiles to the same code as calling the SDK directly. Other builds link
+// their own definitions; the host simulator's are in host/.
+// C linkage, so the C drivers (si5351.c) use it too.
+
+#if PICO_ON_DEVICE
+#define HAL_API static inline __attribute__((always_inline))
+#else
+#define HAL_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// I2C; port is the controller number. Returns the bytes transferred or a PICO_ERROR code.
+void hal_i2c_init(uint port, uint baudrate, uint sda, uint scl);
+HAL_API int hal_i2c_write(uint port, uint8_t address, const uint8_t* src, size_t len, bool nostop);
+HAL_API int hal_i2c_read(uint port, uint8_t address, uint8_t* dst, size_t len, bool nostop);
+
+// With VFO_DUAL_CORE both cores use the bus; each transfer then holds the port
+// for its whole length, and the time spent waiting for the other core is counted
+typedef struct hal_i2c_stats
+{
+    uint32_t transfers;
+    uint32_t waits; // Transfers that found the port busy
+    uint32_t max_wait_us;
+} hal_i2c_stats_t;
+
+hal_i2c_stats_t hal_i2c_get_stats(uint port);
+
+// GPIO
+typedef void (*hal_gpio_callback_t)(uint gpio, uint32_t events);
+
+HAL_API void hal_gpio_input(uint gpio, bool pull_up);
+HAL_API void hal_gpio_output(uint gpio, bool level);
+HAL_API bool hal_gpio_get(uint gpio);
+HAL_API uint32_t hal_gpio_get_all(void);
+HAL_API void hal_gpio_put(uint gpio, bool level);
+
+// Interrupt on both edges of gpio. There is one callback for all pins, the last one set wins.
+void hal_gpio_on_edges(uint gpio, hal_gpio_callback_t callback);
+
+// Time
+typedef repeating_timer_t hal_timer_t;
+typedef bool (*hal_timer_callback_t)(hal_timer_t* timer);
+
+HAL_API uint32_t hal_time_us(void);
+HAL_API uint64_t hal_time_us_64(void);
+HAL_API void hal_sleep_ms(uint32_t ms);
+
+// Call back every period_ms, measured between starts; return false from the callback to stop
+bool hal_timer_every_ms(uint32_t period_ms, hal_timer_callback_t callback, void* user_data, hal_timer_t* timer);
+bool hal_timer_every_us(uint32_t period_us, hal_timer_callback_t callback, void* user_data, hal_timer_t* timer);
+
+// Stop a timer from outside its callback; no call back starts after this returns
+void hal_timer_cancel(hal_timer_t* timer);
+
+#if PICO_ON_DEVICE
+
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/timer.h"
+
+#if VFO_DUAL_CORE
+void hal_i2c_lock(uint port);
+void hal_i2c_unlock(uint port);
+#else
+#define hal_i2c_lock(port) ((void)0)
+#define hal_i2c_unlock(port) ((void)0)
+#endif
+
+HAL_API int hal_i2c_write(uint port, uint8_t address, const uint8_t* src, size_t len, bool nostop)
+{
+    hal_i2c_lock(port);
+    int result = i2c_write_blocking(i2c_get_instance(port), address, src, len, nostop);
+    hal_i2c_unlock(port);
+    return result;
+}
+
+HAL_API int hal_i2c_read(uint port, uint8_t address, uint8_t* dst, size_t len, bool nostop)
+{
+    hal_i2c_lock(port);
+    int result = i2c_read_blocking(i2c_get_instance(port), address, dst, len, nostop);
+    hal_i2c_unlock(port);
+    return result;
+}
+
+HAL_API void hal_gpio_input(uint gpio, bool pull_up)
+{
+    gpio_init(gpio);
+    gpio_set_pulls(gpio, pull_up, false);
+}
+
+HAL_API void hal_gpio_output(uint gpio, bool level)
+{
+    gpio_init(gpio);
+    gpio_put(gpio, level);
+    gpio_set_dir(gpio, GPIO_OUT);
+}
+
+HAL_API bool hal_gpio_get(uint gpio)
+{
+    return gpio_get(gpio);
+}
+
+HAL_API uint32_t hal_gpio_get_all(void)
+{
+    return gpio_get_all();
+}
+
+HAL_API void hal_gpio_put(uint gpio, bool level)
+{
+    gpio_put(gpio, level);
+}
+
+HAL_API uint32_t hal_time_us(void)
+{
+    return time_us_32();
+}
+
+HAL_API uint64_t hal_time_us_64(void)
+{
+    return time_us_64();
+}
+
+HAL_API void hal_sleep_ms(uint32_t ms)
+{
+    sleep_ms(ms);
+}
+
+#endif // PICO_ON_DEVICE
+
+#ifdef __cplusplus
+}
+#endif
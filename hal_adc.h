@@ -0,0 +1,23 @@
+#pragma once
+#include "hal.h"
+
+// ADC bursts through the HAL, for measurements rather than streaming (the
+// receive capture, capture.h, drives the ADC itself). Inputs 0-3 are GPIO
+// 26-29. A burst converts the enabled inputs in round-robin at the ADC's full
+// rate, 500 ksps shared between them, and DMA writes the results.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Set up the inputs in channel_mask (bit n for input n) and claim a DMA
+// channel; false if none is free
+bool hal_adc_start(uint32_t channel_mask);
+
+// Fill dst with count unsigned 12 bit results, interleaved from the lowest
+// enabled input up; returns when the last one is written
+void hal_adc_read(uint16_t* dst, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+#include "hal.h"
+#include "pico/audio.h"
+
+// Audio output through the HAL. Buffers are the pico-extras producer pool
+// types on every backend; on the device the pool is played by I2S over DMA.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct hal_audio_config
+{
+    uint32_t sample_rate;
+    uint32_t buffer_count;
+    uint32_t buffer_samples; // Mono 16 bit
+    uint8_t pin_data;
+    uint8_t pin_bclk; // LRCLK is the next pin
+    uint8_t pio_sm;
+    uint8_t dma_channel;
+} hal_audio_config_t;
+
+// Returns the producer pool, or NULL if the output could not be set up
+audio_buffer_pool_t* hal_audio_start(const hal_audio_config_t* config);
+
+// Call handler (in IRQ context) whenever the output has finished with a buffer
+void hal_audio_on_buffer_done(void (*handler)(void));
+
+HAL_API audio_buffer_t* hal_audio_take(audio_buffer_pool_t* pool, bool block);
+HAL_API void hal_audio_give(audio_buffer_pool_t* pool, audio_buffer_t* buffer);
+
+#if PICO_ON_DEVICE
+
+HAL_API audio_buffer_t* hal_audio_take(audio_buffer_pool_t* pool, bool block)
+{
+    return take_audio_buffer(pool, block);
+}
+
+HAL_API void hal_audio_give(audio_buffer_pool_t* pool, audio_buffer_t* buffer)
+{
+    give_audio_buffer(pool, buffer);
+}
+
+#endif // PICO_ON_DEVICE
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,176 @@
+// Pico SDK backend of the HAL: the set-up calls. The per-transfer calls are
+// inline in hal.h and hal_audio.h.
+#include "hal.h"
+#include "hal_adc.h"
+#include "hal_audio.h"
+
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "pico/audio_i2s.h"
+#include "pico/mutex.h"
+#include "pico/stdlib.h"
+
+namespace
+{
+
+hal_i2c_stats_t i2c_stats[NUM_I2CS];
+#if VFO_DUAL_CORE
+mutex_t i2c_mutex[NUM_I2CS];
+#endif
+
+int adc_dma = -1;
+uint adc_first_input = 0;
+
+} // namespace
+
+void hal_i2c_init(uint port, uint baudrate, uint sda, uint scl)
+{
+#if VFO_DUAL_CORE
+    mutex_init(&i2c_mutex[port]);
+#endif
+    i2c_init(i2c_get_instance(port), baudrate);
+
+    // No external pull ups on the bus
+    gpio_set_function(sda, GPIO_FUNC_I2C);
+    gpio_set_function(scl, GPIO_FUNC_I2C);
+    gpio_pull_up(sda);
+    gpio_pull_up(scl);
+}
+
+#if VFO_DUAL_CORE
+void hal_i2c_lock(uint port)
+{
+    if (!mutex_try_enter(&i2c_mutex[port], nullptr))
+    {
+        uint32_t start = time_us_32();
+        mutex_enter_blocking(&i2c_mutex[port]);
+        uint32_t waited = time_us_32() - start;
+
+        // Updated only by the holder
+        i2c_stats[port].waits++;
+        if (waited > i2c_stats[port].max_wait_us)
+        {
+            i2c_stats[port].max_wait_us = waited;
+        }
+    }
+    i2c_stats[port].transfers++;
+}
+
+void hal_i2c_unlock(uint port)
+{
+    mutex_exit(&i2c_mutex[port]);
+}
+#endif
+
+hal_i2c_stats_t hal_i2c_get_stats(uint port)
+{
+    return i2c_stats[port];
+}
+
+void hal_gpio_on_edges(uint gpio, hal_gpio_callback_t callback)
+{
+    gpio_set_irq_enabled_with_callback(gpio, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, callback);
+}
+
+bool hal_timer_every_ms(uint32_t period_ms, hal_timer_callback_t callback, void* user_data, hal_timer_t* timer)
+{
+    // Negative period: measured between starts, not from the end of the callback
+    return add_repeating_timer_ms(-int32_t(period_ms), callback, user_data, timer);
+}
+
+bool hal_timer_every_us(uint32_t period_us, hal_timer_callback_t callback, void* user_data, hal_timer_t* timer)
+{
+    return add_repeating_timer_us(-int64_t(period_us), callback, user_data, timer);
+}
+
+void hal_timer_cancel(hal_timer_t* timer)
+{
+    cancel_repeating_timer(timer);
+}
+
+bool hal_adc_start(uint32_t channel_mask)
+{
+    if (adc_dma < 0)
+    {
+        adc_dma = dma_claim_unused_channel(false);
+        if (adc_dma < 0)
+        {
+            return false;
+        }
+    }
+
+    adc_init();
+    for (uint input = 0; channel_mask >> input; input++)
+    {
+        if (channel_mask & (1u << input))
+        {
+            adc_gpio_init(ADC_BASE_PIN + input);
+        }
+    }
+    adc_first_input = __builtin_ctz(channel_mask);
+    adc_set_round_robin(channel_mask);
+
+    // Every result to the FIFO with a DREQ, full width with no error bit; free-running at 500 ksps
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv(0);
+    return true;
+}
+
+void hal_adc_read(uint16_t* dst, size_t count)
+{
+    // Start the round-robin from the first input, with nothing left in the FIFO
+    adc_select_input(adc_first_input);
+    adc_fifo_drain();
+
+    dma_channel_config config = dma_channel_get_default_config(adc_dma);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_dreq(&config, DREQ_ADC);
+    dma_channel_configure(adc_dma, &config, dst, &adc_hw->fifo, count, true);
+
+    adc_run(true);
+    dma_channel_wait_for_finish_blocking(adc_dma);
+    adc_run(false);
+    adc_fifo_drain();
+}
+
+audio_buffer_pool_t* hal_audio_start(const hal_audio_config_t* config)
+{
+    static audio_format_t audio_format = {
+        .sample_freq = config->sample_rate,
+        .format = AUDIO_BUFFER_FORMAT_PCM_S16,
+        .channel_count = 1,
+    };
+
+    static audio_buffer_format_t producer_format = {
+        .format = &audio_format,
+        .sample_stride = 2
+    };
+
+    audio_buffer_pool_t* producer_pool = audio_new_producer_pool(&producer_format, config->buffer_count, config->buffer_samples);
+
+    audio_i2s_config_t i2s_config = {
+        .data_pin = config->pin_data,
+        .clock_pin_base = config->pin_bclk,
+        .dma_channel = config->dma_channel,
+        .pio_sm = config->pio_sm,
+    };
+
+    if (!audio_i2s_setup(&audio_format, &i2s_config) || !audio_i2s_connect(producer_pool))
+    {
+        return nullptr;
+    }
+
+    audio_i2s_set_enabled(true);
+    return producer_pool;
+}
+
+void hal_audio_on_buffer_done(void (*handler)(void))
+{
+    // Runs after the I2S handler on the same DMA IRQ (PICO_AUDIO_I2S_DMA_IRQ defaults to 0),
+    // which has already acknowledged the channel
+    irq_add_shared_handler(DMA_IRQ_0, handler, PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
@@ -0,0 +1,229 @@
+// The band plan (band_plan.h) and the register images synth.cpp prepares from
+// it, against the Si5351 driver working the same settings out on the fly.
+//
+//   band_check [steps]             frequencies per band, 50 by default
+//
+// For every band, across it from edge to edge: the registers a band change
+// leaves (PLLA, PLLB, multisynth 0 and the CLK0 control byte) must be byte for
+// byte what the driver writes for that frequency on PLLA with the band's
+// divider, and so must the PLLA registers after a retune inside the band.
+// Both must put CLK0 on the same frequency in the simulator's model. Then the
+// lookup: find_band() for every kHz from 1 to 30 MHz against a search of the
+// table, and band_up()/band_down() round the table and back.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "sim.h"
+
+#include "band_plan.h"
+#include "synth.h"
+
+extern "C" {
+#include "si5351/si5351.h"
+}
+
+static_assert(!VFO_QUADRATURE, "band_check compares CLK0 alone; quad_check covers VFO_QUADRATURE");
+
+namespace vfo_sim
+{
+void finish(int code)
+{
+    exit(code);
+}
+} // namespace vfo_sim
+
+namespace
+{
+
+#define CHECK_I2C_HZ 48000 // As the firmware runs the bus
+#define CHECK_FIRST_REGISTER SYNTH_BURST_FIRST
+#define CHECK_REGISTERS SYNTH_BURST_LEN
+#define CHECK_LOOKUP_MAX_HZ 30000000
+
+uint32_t failures = 0;
+
+void fail(const char* fmt, uint32_t a, uint32_t b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "band_check: ");
+        fprintf(stderr, fmt, a, b);
+        fputc('\n', stderr);
+    }
+}
+
+struct Registers
+{
+    uint8_t burst[CHECK_REGISTERS];
+    uint8_t control;
+    double clk0_hz;
+};
+
+Registers read_back()
+{
+    Registers r;
+    for (uint32_t i = 0; i < CHECK_REGISTERS; i++)
+    {
+        r.burst[i] = si5351_read(uint8_t(CHECK_FIRST_REGISTER + i));
+    }
+    r.control = si5351_read(SI5351_CLK0_CTRL);
+    r.clk0_hz = vfo_sim::clk0_hz();
+    return r;
+}
+
+// The driver's own way to CLK0 at hz: PLLA at hz times the band's divider,
+// the multisynth worked out from the two, then integer mode and the drive
+void driver_tune(const vfo_band::Band& band, uint32_t hz)
+{
+    uint64_t pll = uint64_t(hz) * band.ms_divider * SI5351_FREQ_MULT;
+    set_pll(SI5351_PLL_FIXED, SI5351_PLLB);
+    set_ms_source(SI5351_CLK0, SI5351_PLLA);
+    set_freq_manual(uint64_t(hz) * SI5351_FREQ_MULT, pll, SI5351_CLK0);
+    set_int(SI5351_CLK0, 1);
+    si5351_drive_strength(SI5351_CLK0, si5351_drive(band.drive));
+    si5351_set_clock_pwr(SI5351_CLK0, 1);
+    pll_reset(SI5351_PLLA);
+}
+
+// Returns the number of registers that differ
+uint32_t compare(const char* what, uint32_t hz, const Registers& plan, const Registers& driver)
+{
+    uint32_t differ = 0;
+    for (uint32_t i = 0; i < CHECK_REGISTERS; i++)
+    {
+        if (plan.burst[i] != driver.burst[i])
+        {
+            if (!differ)
+            {
+                fprintf(stderr, "band_check: %s at %u Hz: register %u is 0x%02x, the driver writes 0x%02x\n", what, hz,
+                    CHECK_FIRST_REGISTER + i, plan.burst[i], driver.burst[i]);
+            }
+            differ++;
+        }
+    }
+    if (plan.control != driver.control)
+    {
+        fprintf(stderr, "band_check: %s at %u Hz: CLK0 control 0x%02x, the driver's 0x%02x\n", what, hz, plan.control,
+            driver.control);
+        differ++;
+    }
+    if (plan.clk0_hz != driver.clk0_hz)
+    {
+        fail("CLK0 differs from the driver's at %u Hz", hz);
+    }
+    if (differ)
+    {
+        fail("%u Hz: %u registers differ", hz, differ);
+    }
+    return differ;
+}
+
+void run_band(uint32_t index, uint32_t steps)
+{
+    const vfo_band::Band& band = vfo_band::bands[index];
+    uint32_t checked = 0;
+    uint32_t differ = 0;
+    double worst = 0;
+    for (uint32_t i = 0; i <= steps; i++)
+    {
+        uint32_t hz = band.low_hz + uint32_t(uint64_t(band.high_hz - band.low_hz) * i / steps);
+
+        // A band change straight to hz, and a retune to it from the bottom edge
+        vfo_synth::select_band(index, hz);
+        Registers selected = read_back();
+        vfo_synth::select_band(index, band.low_hz);
+        vfo_synth::set_frequency(hz);
+        Registers retuned = read_back();
+
+        driver_tune(band, hz);
+        Registers driver = read_back();
+
+        differ += compare("band change", hz, selected, driver);
+        differ += compare("retune", hz, retuned, driver);
+        worst = std::max(worst, std::fabs(driver.clk0_hz - hz));
+        checked++;
+    }
+    printf("%-10s %8u-%8u Hz  divider %3u  %u frequencies, %u registers differ, worst error %.3f Hz\n", band.name,
+        band.low_hz, band.high_hz, band.ms_divider, checked, differ, worst);
+}
+
+void check_lookup()
+{
+    uint32_t hits = 0;
+    for (uint32_t hz = 1000000; hz <= CHECK_LOOKUP_MAX_HZ; hz += 1000)
+    {
+        int expected = -1;
+        for (uint32_t i = 0; i < vfo_band::bands.size(); i++)
+        {
+            if (hz >= vfo_band::bands[i].low_hz && hz <= vfo_band::bands[i].high_hz)
+            {
+                expected = int(i);
+            }
+        }
+        if (vfo_band::find_band(hz) != expected)
+        {
+            fail("find_band(%u) gives %u", hz, uint32_t(vfo_band::find_band(hz)));
+        }
+        hits += expected >= 0;
+    }
+    // Both edges are in, one hertz either side is out
+    for (uint32_t i = 0; i < vfo_band::bands.size(); i++)
+    {
+        const vfo_band::Band& band = vfo_band::bands[i];
+        if (vfo_band::find_band(band.low_hz) != int(i) || vfo_band::find_band(band.high_hz) != int(i)
+            || vfo_band::find_band(band.low_hz - 1) != -1 || vfo_band::find_band(band.high_hz + 1) != -1)
+        {
+            fail("band %u edges, from %u Hz", i, band.low_hz);
+        }
+    }
+
+    uint32_t index = 0;
+    for (uint32_t i = 0; i < vfo_band::bands.size(); i++)
+    {
+        uint32_t next = vfo_band::band_up(index);
+        if (vfo_band::band_down(next) != index || (next != 0 && vfo_band::bands[next].low_hz <= vfo_band::bands[index].low_hz))
+        {
+            fail("band_up from %u gives %u", index, next);
+        }
+        index = next;
+    }
+    if (index != 0)
+    {
+        fail("band_up round the table ends on %u", index);
+    }
+    printf("lookup: %u kHz steps inside bands, edges exact, up and down round the table\n", hits);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t steps = argc > 1 ? uint32_t(atoi(argv[1])) : 50;
+    if (steps == 0)
+    {
+        fprintf(stderr, "usage: band_check [steps]\n");
+        return 2;
+    }
+
+    vfo_sim::set_log_enabled(false);
+    vfo_sim::attach_devices(0);
+
+    hal_i2c_init(0, CHECK_I2C_HZ, 0, 1);
+    if (!si5351_init(SIM_SI5351_ADDRESS, SI5351_CRYSTAL_LOAD_8PF, SIM_XTAL_HZ, 0))
+    {
+        fprintf(stderr, "band_check: no Si5351\n");
+        return 1;
+    }
+    vfo_synth::init_synth();
+    si5351_output_enable(SI5351_CLK0, 1);
+
+    for (uint32_t i = 0; i < vfo_band::bands.size(); i++)
+    {
+        run_band(i, steps);
+    }
+    check_lookup();
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
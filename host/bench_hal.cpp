@@ -0,0 +1,149 @@
+// HAL backend for the host benchmarks: I2C transfers are accepted and
+// dropped, inputs read released, and time is the host's. Only the drivers'
+// own work is measured.
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "hal_audio.h"
+#include "pico/time.h"
+
+struct audio_buffer_pool
+{
+};
+
+namespace
+{
+
+uint64_t host_time_us()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+} // namespace
+
+extern "C" {
+
+void panic(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+    exit(1);
+}
+
+uint64_t time_us_64(void)
+{
+    return host_time_us();
+}
+
+void hal_i2c_init(uint, uint, uint, uint)
+{
+}
+
+int hal_i2c_write(uint, uint8_t, const uint8_t*, size_t len, bool)
+{
+    return int(len);
+}
+
+int hal_i2c_read(uint, uint8_t, uint8_t* dst, size_t len, bool)
+{
+    // Status registers read back ready
+    for (size_t i = 0; i < len; i++)
+    {
+        dst[i] = 0;
+    }
+    return int(len);
+}
+
+void hal_gpio_input(uint, bool)
+{
+}
+
+void hal_gpio_output(uint, bool)
+{
+}
+
+bool hal_gpio_get(uint)
+{
+    return true;
+}
+
+uint32_t hal_gpio_get_all(void)
+{
+    return ~0u;
+}
+
+void hal_gpio_put(uint, bool)
+{
+}
+
+void hal_gpio_on_edges(uint, hal_gpio_callback_t)
+{
+}
+
+uint32_t hal_time_us(void)
+{
+    return uint32_t(host_time_us());
+}
+
+uint64_t hal_time_us_64(void)
+{
+    return host_time_us();
+}
+
+void hal_sleep_ms(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+bool hal_timer_every_ms(uint32_t, hal_timer_callback_t, void*, hal_timer_t*)
+{
+    return false;
+}
+
+bool hal_timer_every_us(uint32_t, hal_timer_callback_t, void*, hal_timer_t*)
+{
+    return false;
+}
+
+void hal_timer_cancel(hal_timer_t*)
+{
+}
+
+audio_buffer_pool_t* hal_audio_start(const hal_audio_config_t*)
+{
+    // Nothing plays; the benchmarks fill blocks directly
+    static audio_buffer_pool_t pool;
+    return &pool;
+}
+
+void hal_audio_on_buffer_done(void (*)(void))
+{
+}
+
+audio_buffer_t* hal_audio_take(audio_buffer_pool_t*, bool)
+{
+    return nullptr;
+}
+
+void hal_audio_give(audio_buffer_pool_t*, audio_buffer_t*)
+{
+}
+
+// The event loop is linked for the demodulator's wakes but never waited on
+void __sev(void)
+{
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t)
+{
+    return true;
+}
+
+} // extern "C"
@@ -0,0 +1,298 @@
+// The button subsystem (buttons.h) on the simulator's pins and timer, fed
+// synthetic bounce traces.
+//
+//   buttons_check
+//
+// Two buttons are pressed through a script of gestures: clicks, double
+// clicks, long presses, a click then a long hold, and lone noise spikes, each
+// edge chattering for up to 8 ms first. The events queued must be exactly
+// those the gestures call for, in order and from the right button: one Press
+// and one Release per press however much it bounced, nothing from a spike,
+// Click only once the double-click window has passed. Reported are the
+// latencies from the last bounce to Press, from the press to LongPress and
+// from the release to Click.
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "sim.h"
+
+#include "buttons.h"
+
+namespace vfo_sim
+{
+void finish(int code)
+{
+    exit(code);
+}
+} // namespace vfo_sim
+
+namespace
+{
+
+#define CHECK_BUTTON_GPIO 8 // A second button beside the encoder switch
+#define CHECK_GESTURES 400
+#define CHECK_BOUNCE_US 8000 // Chatter before each edge settles
+#define CHECK_QUIET_US 500000 // Between gestures, past every window
+
+using vfo_input::InputEventType;
+
+uint32_t failures = 0;
+
+void fail(const char* what, long a, long b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "buttons_check: %s (%ld, %ld)\n", what, a, b);
+    }
+}
+
+uint32_t noise = 1;
+
+uint32_t random(uint32_t range)
+{
+    noise = noise * 1664525u + 1013904223u;
+    return (noise >> 8) % range;
+}
+
+const vfo_input::ButtonTiming timing = {};
+
+struct Expected
+{
+    InputEventType type;
+    uint8_t source;
+};
+
+struct Trace
+{
+    uint32_t gpio;
+    uint8_t source;
+    std::vector<Expected> expected;
+    uint64_t settled_us = 0; // When the last edge stopped bouncing
+    uint64_t first_press_us = 0; // When the gesture's first press did
+
+    // Chatter, then settle at level: 0 pressed, -1 released to the pull up
+    void edge(int level)
+    {
+        uint64_t t = vfo_sim::now_us();
+        uint32_t bounces = random(6);
+        for (uint32_t i = 0; i < bounces; i++)
+        {
+            t += 1 + random(CHECK_BOUNCE_US / 6);
+            vfo_sim::advance_to(t);
+            vfo_sim::drive_pin(gpio, i % 2 ? -1 - level : level);
+        }
+        vfo_sim::drive_pin(gpio, level);
+        settled_us = vfo_sim::now_us();
+        if (level == 0 && !first_press_us)
+        {
+            first_press_us = settled_us;
+        }
+    }
+
+    void hold(uint32_t us)
+    {
+        vfo_sim::advance_to(vfo_sim::now_us() + us);
+    }
+
+    void press(uint32_t held_us)
+    {
+        edge(0);
+        hold(held_us);
+        edge(-1);
+    }
+
+    void expect(InputEventType type)
+    {
+        expected.push_back({ type, source });
+    }
+};
+
+const char* name(InputEventType type)
+{
+    static const char* names[] = { "Rotate", "Press", "Release", "LongPress", "Click", "DoubleClick" };
+    return names[uint32_t(type)];
+}
+
+struct Latency
+{
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;
+    uint32_t count = 0;
+
+    void add(uint64_t us)
+    {
+        max_us = us > max_us ? uint32_t(us) : max_us;
+        total_us += us;
+        count++;
+    }
+
+    void print(const char* what) const
+    {
+        printf("%-24s %4u, mean %6.1f ms, max %6.1f ms\n", what, count, count ? total_us / 1e3 / count : 0.0,
+            max_us / 1e3);
+    }
+};
+
+} // namespace
+
+int main()
+{
+    vfo_sim::set_log_enabled(false);
+
+    vfo_input::InputQueue queue;
+    Trace traces[2] = { { SIM_ENCODER_SWITCH, 0, {} }, { CHECK_BUTTON_GPIO, 0, {} } };
+    for (Trace& t : traces)
+    {
+        int source = vfo_input::add_button(t.gpio);
+        if (source < 0)
+        {
+            fail("add_button", long(t.gpio));
+            return 1;
+        }
+        t.source = uint8_t(source);
+    }
+    if (!vfo_input::start_buttons(queue, timing))
+    {
+        fail("start_buttons", 0);
+        return 1;
+    }
+
+    const uint32_t sample_us = BUTTON_SAMPLE_MS * 1000;
+    const uint32_t debounce_us = BUTTON_INTEGRATOR_MAX * sample_us;
+    const uint32_t long_us = timing.long_press_ms * 1000;
+    const uint32_t double_us = timing.double_click_ms * 1000;
+
+    Latency press_latency, long_latency, click_latency;
+    std::vector<vfo_input::InputEvent> got;
+    uint32_t counts[6] = {};
+
+    for (uint32_t g = 0; g < CHECK_GESTURES; g++)
+    {
+        Trace& t = traces[random(2)];
+        t.expected.clear();
+        t.first_press_us = 0;
+        uint64_t pressed_us = 0, released_us = 0;
+
+        // Holds and gaps kept clear of every threshold by more than the debounce
+        uint32_t click_us = debounce_us * 2 + random(long_us / 2);
+        switch (random(5))
+        {
+        case 0: // Click
+            t.press(click_us);
+            released_us = t.settled_us;
+            t.expect(InputEventType::Press);
+            t.expect(InputEventType::Release);
+            t.expect(InputEventType::Click);
+            break;
+        case 1: // Double click
+            t.press(click_us);
+            t.hold(debounce_us * 2 + random(double_us - debounce_us * 6));
+            t.press(click_us);
+            t.expect(InputEventType::Press);
+            t.expect(InputEventType::Release);
+            t.expect(InputEventType::Press);
+            t.expect(InputEventType::Release);
+            t.expect(InputEventType::DoubleClick);
+            break;
+        case 2: // Long press
+            t.edge(0);
+            pressed_us = t.settled_us;
+            t.hold(long_us + debounce_us * 2 + random(long_us));
+            t.edge(-1);
+            t.expect(InputEventType::Press);
+            t.expect(InputEventType::LongPress);
+            t.expect(InputEventType::Release);
+            break;
+        case 3: // Click, then a long hold: a click, then a long press
+            t.press(click_us);
+            t.hold(debounce_us * 2 + random(double_us - debounce_us * 6));
+            t.edge(0);
+            pressed_us = t.settled_us;
+            t.hold(long_us + debounce_us * 2);
+            t.edge(-1);
+            t.expect(InputEventType::Press);
+            t.expect(InputEventType::Release);
+            t.expect(InputEventType::Press);
+            t.expect(InputEventType::Click);
+            t.expect(InputEventType::LongPress);
+            t.expect(InputEventType::Release);
+            break;
+        default: // Noise spikes shorter than a sample period, nothing to report
+            for (uint32_t i = 0; i < 5; i++)
+            {
+                vfo_sim::drive_pin(t.gpio, 0);
+                t.hold(1 + random(sample_us - 1));
+                vfo_sim::drive_pin(t.gpio, -1);
+                t.hold(sample_us * 2);
+            }
+            break;
+        }
+        t.hold(CHECK_QUIET_US);
+
+        vfo_input::InputEvent e;
+        got.clear();
+        while (queue.pop(e))
+        {
+            got.push_back(e);
+        }
+        bool match = got.size() == t.expected.size();
+        for (size_t i = 0; match && i < got.size(); i++)
+        {
+            match = got[i].type == t.expected[i].type && got[i].source == t.expected[i].source;
+        }
+        if (!match)
+        {
+            fprintf(stderr, "gesture %u on button %u:", g, t.source);
+            for (const vfo_input::InputEvent& x : got)
+            {
+                fprintf(stderr, " %s/%u", name(x.type), x.source);
+            }
+            fprintf(stderr, "\n");
+            fail("events for gesture", long(g), long(got.size()));
+            continue;
+        }
+
+        for (size_t i = 0; i < got.size(); i++)
+        {
+            const vfo_input::InputEvent& x = got[i];
+            counts[uint32_t(x.type)]++;
+            if (i == 0)
+            {
+                press_latency.add(x.time_us - uint32_t(t.first_press_us));
+            }
+            if (x.type == InputEventType::LongPress)
+            {
+                long_latency.add(x.time_us - uint32_t(pressed_us));
+            }
+            if (x.type == InputEventType::Click && released_us)
+            {
+                click_latency.add(x.time_us - uint32_t(released_us));
+            }
+        }
+    }
+
+    printf("%u gestures: %u presses, %u releases, %u long presses, %u clicks, %u double clicks\n", CHECK_GESTURES,
+        counts[1], counts[2], counts[3], counts[4], counts[5]);
+    press_latency.print("press after bouncing");
+    long_latency.print("long press after press");
+    click_latency.print("click after release");
+
+    // The integrator needs BUTTON_INTEGRATOR_MAX samples of agreement once the
+    // contact settles, the first of them up to a period away
+    if (press_latency.max_us > debounce_us + sample_us || !press_latency.count)
+    {
+        fail("press latency", long(press_latency.max_us));
+    }
+    if (long_latency.max_us > long_us + debounce_us + sample_us || !long_latency.count)
+    {
+        fail("long press latency", long(long_latency.max_us));
+    }
+    if (click_latency.max_us > double_us + debounce_us + sample_us || !click_latency.count)
+    {
+        fail("click latency", long(click_latency.max_us));
+    }
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
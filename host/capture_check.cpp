@@ -0,0 +1,394 @@
+// The host capture (capture_wav.cpp) replaying WAV files, and the receive path
+// behind it: capture, demodulator (demod.cpp) and audio output, on the
+// simulator's clock and output as the radio loop runs them with VFO_RX_DEMOD.
+//
+//   capture_check [dir]            scratch files go in dir, $TMPDIR or /tmp
+//
+// First the replay itself: block sizes and timestamps, the 12 bit codes and
+// their conversion back, mono files, looping, the overrun when every buffer is
+// held, and the files it must turn down. Then an I/Q recording of a tone on
+// the upper sideband is replayed through service_demod(): the audio played
+// out must be that tone, at the level the demodulator and the output chain
+// give it, with everything else well below.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "sim.h"
+
+#include "audio.h"
+#include "capture.h"
+#include "demod.h"
+#include "event_loop.h"
+
+namespace vfo_sim
+{
+void finish(int code)
+{
+    exit(code);
+}
+} // namespace vfo_sim
+
+namespace
+{
+
+#define CHECK_IQ_RATE (AUDIO_SAMPLE_RATE * DEMOD_DECIMATION)
+#define CHECK_TONE_HZ 1000.0
+#define CHECK_TONE_LEVEL 0.4 // Of full scale, on I and on Q
+#define CHECK_SETTLE_MS 50 // Filters filling and the first buffers playing, left out of the measurement
+
+uint32_t failures = 0;
+std::string dir;
+
+void fail(const char* what, double value = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "capture_check: %s (%.3f)\n", what, value);
+    }
+}
+
+void put_u16(std::vector<uint8_t>& out, uint32_t v)
+{
+    out.push_back(uint8_t(v));
+    out.push_back(uint8_t(v >> 8));
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t v)
+{
+    put_u16(out, v & 0xFFFF);
+    put_u16(out, v >> 16);
+}
+
+struct WavSpec
+{
+    uint32_t channels = 2;
+    uint32_t rate = CHECK_IQ_RATE;
+    uint32_t format = 1; // PCM
+    uint32_t bits = 16;
+    bool extra_chunk = false; // An odd-sized chunk between fmt and data, to be skipped
+};
+
+std::string write_wav(const char* name, const WavSpec& spec, const std::vector<int16_t>& samples)
+{
+    std::vector<uint8_t> out;
+    out.insert(out.end(), { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+    put_u32(out, 16);
+    put_u16(out, spec.format);
+    put_u16(out, spec.channels);
+    put_u32(out, spec.rate);
+    put_u32(out, spec.rate * spec.channels * spec.bits / 8);
+    put_u16(out, spec.channels * spec.bits / 8);
+    put_u16(out, spec.bits);
+    if (spec.extra_chunk)
+    {
+        out.insert(out.end(), { 'L', 'I', 'S', 'T', 3, 0, 0, 0, 'a', 'b', 'c', 0 });
+    }
+    out.insert(out.end(), { 'd', 'a', 't', 'a' });
+    put_u32(out, uint32_t(samples.size() * 2));
+    for (int16_t s : samples)
+    {
+        put_u16(out, uint16_t(s));
+    }
+    uint32_t riff = uint32_t(out.size() - 8);
+    memcpy(&out[4], &riff, 4);
+
+    std::string path = dir + "/" + name;
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f || fwrite(out.data(), 1, out.size(), f) != out.size())
+    {
+        fprintf(stderr, "capture_check: cannot write %s\n", path.c_str());
+        exit(2);
+    }
+    fclose(f);
+    return path;
+}
+
+// Every sample value a 16 bit file can hold, in turn
+int16_t pattern(uint32_t i)
+{
+    return int16_t(uint16_t(i * 40503u));
+}
+
+void check_replay()
+{
+    const uint32_t frames = SAMPLES_PER_BUFFER * 3 + 100;
+    std::vector<int16_t> samples(frames * 2);
+    for (uint32_t i = 0; i < samples.size(); i++)
+    {
+        samples[i] = pattern(i);
+    }
+    WavSpec spec;
+    spec.extra_chunk = true;
+    std::string path = write_wav("capture_stereo.wav", spec, samples);
+
+    if (!vfo_capture::open_capture_wav(path.c_str(), false) || !vfo_capture::start_capture(CHECK_IQ_RATE))
+    {
+        fail("stereo file not opened");
+        return;
+    }
+    uint32_t at = 0;
+    uint32_t block_count = 0;
+    while (audio_buffer_t* block = vfo_capture::take_capture_block())
+    {
+        uint32_t expected = std::min<uint32_t>(SAMPLES_PER_BUFFER, frames - at);
+        if (block->sample_count != expected)
+        {
+            fail("block size", block->sample_count);
+        }
+        uint32_t end_us = uint32_t(uint64_t(at + block->sample_count) * 1000000 / CHECK_IQ_RATE);
+        if (block->user_data != end_us)
+        {
+            fail("block timestamp", block->user_data);
+        }
+
+        // 12 bit offset codes, then back to full-scale signed with the low 4 bits gone
+        const uint16_t* codes = (const uint16_t*)block->buffer->bytes;
+        for (uint32_t i = 0; i < block->sample_count * 2; i++)
+        {
+            if (codes[i] != uint16_t((samples[at * 2 + i] >> 4) + 2048))
+            {
+                fail("ADC code", i);
+                break;
+            }
+        }
+        const int16_t* iq = vfo_capture::capture_to_signed(block);
+        for (uint32_t i = 0; i < block->sample_count * 2; i++)
+        {
+            if (iq[i] != int16_t(samples[at * 2 + i] & ~0xF))
+            {
+                fail("signed sample", i);
+                break;
+            }
+        }
+        at += block->sample_count;
+        block_count++;
+        vfo_capture::release_capture_block(block);
+    }
+    if (at != frames || block_count != 4)
+    {
+        fail("frames replayed", at);
+    }
+    printf("stereo: %u frames in %u blocks, codes, timestamps and conversion exact\n", at, block_count);
+
+    // Looping: every buffer taken and none returned, so the last take is an overrun
+    vfo_capture::open_capture_wav(path.c_str(), true);
+    vfo_capture::start_capture(CHECK_IQ_RATE);
+    vfo_capture::CaptureStats before = vfo_capture::get_capture_stats();
+    audio_buffer_t* held[CAPTURE_BUFFER_COUNT];
+    for (audio_buffer_t*& block : held)
+    {
+        block = vfo_capture::take_capture_block();
+    }
+    if (!held[CAPTURE_BUFFER_COUNT - 1] || held[CAPTURE_BUFFER_COUNT - 1]->sample_count != SAMPLES_PER_BUFFER)
+    {
+        fail("looped block short");
+    }
+    else
+    {
+        // Frame 3 * 256 + 100 is the file's first again
+        const uint16_t* codes = (const uint16_t*)held[CAPTURE_BUFFER_COUNT - 1]->buffer->bytes;
+        if (codes[200] != uint16_t((samples[0] >> 4) + 2048))
+        {
+            fail("loop did not wrap to the first frame");
+        }
+    }
+    if (vfo_capture::take_capture_block() || vfo_capture::get_capture_stats().overruns != before.overruns + 1)
+    {
+        fail("no overrun with every buffer held");
+    }
+    for (audio_buffer_t* block : held)
+    {
+        vfo_capture::release_capture_block(block);
+    }
+    printf("loop: wraps to the first frame; overrun counted with %u buffers held\n", CAPTURE_BUFFER_COUNT);
+
+    // Mono: Q at mid-scale, so zero once signed
+    WavSpec mono;
+    mono.channels = 1;
+    path = write_wav("capture_mono.wav", mono, std::vector<int16_t>(samples.begin(), samples.begin() + 300));
+    vfo_capture::open_capture_wav(path.c_str(), false);
+    vfo_capture::start_capture(CHECK_IQ_RATE);
+    audio_buffer_t* block = vfo_capture::take_capture_block();
+    const int16_t* iq = block ? vfo_capture::capture_to_signed(block) : nullptr;
+    if (!iq || iq[0] != int16_t(samples[0] & ~0xF) || iq[1] != 0 || iq[2] != int16_t(samples[1] & ~0xF) || iq[3] != 0)
+    {
+        fail("mono frames");
+    }
+    if (block)
+    {
+        vfo_capture::release_capture_block(block);
+    }
+    vfo_capture::stop_capture();
+    printf("mono: I from the file, Q zero\n");
+
+    // Not 16 bit PCM, too many channels, not a WAV, not there
+    WavSpec float_format;
+    float_format.format = 3;
+    float_format.bits = 32;
+    WavSpec bytes;
+    bytes.bits = 8;
+    WavSpec three;
+    three.channels = 3;
+    const std::string refused[] = {
+        write_wav("capture_float.wav", float_format, samples),
+        write_wav("capture_8bit.wav", bytes, samples),
+        write_wav("capture_3ch.wav", three, samples),
+        path + ".missing",
+    };
+    for (const std::string& p : refused)
+    {
+        if (vfo_capture::open_capture_wav(p.c_str(), false))
+        {
+            fail(("accepted " + p).c_str());
+        }
+    }
+    FILE* f = fopen((dir + "/capture_text.wav").c_str(), "wb");
+    fputs("not a wave file at all", f);
+    fclose(f);
+    if (vfo_capture::open_capture_wav((dir + "/capture_text.wav").c_str(), false))
+    {
+        fail("accepted a text file");
+    }
+    printf("refused: float, 8 bit, 3 channels, text, missing\n");
+}
+
+// Power of the output at hz, as the amplitude of a sine (Goertzel)
+double tone_amplitude(const std::vector<int16_t>& x, double rate, double hz)
+{
+    double coeff = 2 * std::cos(2 * M_PI * hz / rate);
+    double s1 = 0, s2 = 0;
+    for (int16_t v : x)
+    {
+        double s0 = v + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    return 2 * std::sqrt(power) / x.size();
+}
+
+std::vector<int16_t> read_output(const std::string& path, uint32_t& rate)
+{
+    std::vector<int16_t> samples;
+    FILE* f = fopen(path.c_str(), "rb");
+    uint8_t header[44];
+    if (!f || fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header + 36, "data", 4))
+    {
+        fail("output WAV unreadable");
+        return samples;
+    }
+    memcpy(&rate, header + 24, 4);
+    int16_t s;
+    while (fread(&s, 2, 1, f) == 1)
+    {
+        samples.push_back(s);
+    }
+    fclose(f);
+    return samples;
+}
+
+void check_receive()
+{
+    // One second of a USB tone: Q a quarter cycle behind I
+    const uint32_t frames = CHECK_IQ_RATE;
+    std::vector<int16_t> iq(frames * 2);
+    for (uint32_t n = 0; n < frames; n++)
+    {
+        double phase = 2 * M_PI * CHECK_TONE_HZ * n / CHECK_IQ_RATE;
+        iq[n * 2] = int16_t(std::lround(CHECK_TONE_LEVEL * 32767 * std::cos(phase)));
+        iq[n * 2 + 1] = int16_t(std::lround(CHECK_TONE_LEVEL * 32767 * std::sin(phase)));
+    }
+    std::string in_path = write_wav("capture_usb_tone.wav", WavSpec(), iq);
+    std::string out_path = dir + "/capture_audio.wav";
+
+    vfo_sim::set_log_enabled(false);
+    vfo_capture::CaptureStats before = vfo_capture::get_capture_stats();
+    if (!vfo_capture::open_capture_wav(in_path.c_str(), false) || !vfo_sim::open_wav(out_path.c_str()))
+    {
+        fail("receive files not opened");
+        return;
+    }
+    if (!vfo_audio::start_audio())
+    {
+        fail("no audio output");
+        return;
+    }
+    vfo_loop::enable_audio_wake();
+    vfo_demod::set_sideband(vfo_demod::Sideband::USB);
+    vfo_demod::start_demod();
+
+    // As the radio loop: service, and sleep until something is posted once there is nothing to do
+    uint64_t end_us = vfo_sim::now_us() + uint64_t(frames) * 1000000 / CHECK_IQ_RATE + 100000;
+    while (vfo_sim::now_us() < end_us)
+    {
+        if (!vfo_demod::service_demod())
+        {
+            vfo_loop::wait_for_wake(vfo_loop::LOOP_MAIN, from_us_since_boot(end_us));
+        }
+    }
+    vfo_sim::close_wav();
+
+    uint32_t rate = 0;
+    std::vector<int16_t> audio = read_output(out_path, rate);
+    vfo_demod::DemodStats demod = vfo_demod::get_demod_stats();
+    vfo_capture::CaptureStats capture = vfo_capture::get_capture_stats();
+
+    // The part where the tone plays: after the filters settle, up to the samples from the file
+    uint32_t skip = rate * CHECK_SETTLE_MS / 1000;
+    uint32_t tone_samples = frames / DEMOD_DECIMATION;
+    size_t first = 0;
+    while (first < audio.size() && audio[first] == 0)
+    {
+        first++;
+    }
+    if (rate != AUDIO_SAMPLE_RATE || first + tone_samples > audio.size())
+    {
+        fail("output too short", double(audio.size()));
+        return;
+    }
+    std::vector<int16_t> played(audio.begin() + first + skip, audio.begin() + first + tone_samples - skip);
+
+    // Both sidebands' halves add, (I - H(Q)) / 2 gives the tone's level back, and
+    // the output gain (audio.cpp, volume 128 of 256) halves it
+    double expected = CHECK_TONE_LEVEL * 32767 / 2;
+    double level = tone_amplitude(played, rate, CHECK_TONE_HZ);
+    double total = 0;
+    for (int16_t v : played)
+    {
+        total += double(v) * v;
+    }
+    double rest = total / played.size() - level * level / 2;
+    double purity_db = 10 * std::log10((level * level / 2) / std::max(rest, 1e-9));
+    printf("receive: %u blocks, %u overruns, %.0f Hz at %.0f (expected %.0f), %.1f dB over the rest\n",
+        demod.blocks, capture.overruns - before.overruns, CHECK_TONE_HZ, level, expected, purity_db);
+    if (std::fabs(20 * std::log10(level / expected)) > 0.5)
+    {
+        fail("tone level, dB off", 20 * std::log10(level / expected));
+    }
+    if (purity_db < 40)
+    {
+        fail("tone purity, dB", purity_db);
+    }
+    if (demod.blocks != (frames + SAMPLES_PER_BUFFER - 1) / SAMPLES_PER_BUFFER || capture.overruns != before.overruns)
+    {
+        fail("blocks demodulated", demod.blocks);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* tmp = getenv("TMPDIR");
+    dir = argc > 1 ? argv[1] : tmp ? tmp : "/tmp";
+
+    check_replay();
+    check_receive();
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,397 @@
+// CAT control (cat.h) served over a pseudo-terminal, the way a logging program
+// on the PC talks to the rig's USB CDC port.
+//
+//   cat_stress [commands]        per phase, 20000 by default
+//
+// The slave side stands in for the USB CDC stdio driver: a thread plays the
+// main loop, waking when bytes arrive, calling poll_cat() and applying the
+// requests it leaves. The master side plays the logging program, polling FA,
+// FB, IF and MD with a frequency or mode change now and then. First in
+// lockstep, one command and its reply at a time, as hamlib does, to time the
+// round trip; then pipelined, a window of commands in flight, for the rate
+// the parser sustains. Every reply must match the rig state the commands so
+// far imply, a set showing in the very next query. Reported are commands per
+// second, the round trip, and the time each poll_cat() pass takes out of the
+// loop.
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "cat.h"
+#include "event_loop.h"
+
+#include "pico/stdio.h"
+
+namespace
+{
+
+#define CHECK_COMMANDS 20000
+#define CHECK_WINDOW 32 // Commands in flight when pipelined
+#define CHECK_SET_EVERY 50 // A frequency or mode change among the polls
+
+using Clock = std::chrono::steady_clock;
+
+uint32_t failures = 0;
+
+void fail(const char* what, long a, long b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "cat_stress: %s (%ld, %ld)\n", what, a, b);
+    }
+}
+
+int master_fd = -1;
+int slave_fd = -1;
+
+// The CDC driver's receive buffer
+char rx[256];
+uint32_t rx_head = 0, rx_tail = 0;
+
+void (*chars_available)(void*) = nullptr;
+void* chars_available_param = nullptr;
+std::atomic<bool> woken = false;
+
+} // namespace
+
+// USB CDC stdio on the pty's slave side
+extern "C" {
+
+int getchar_timeout_us(uint32_t)
+{
+    if (rx_head == rx_tail)
+    {
+        pollfd p = { slave_fd, POLLIN, 0 };
+        ssize_t n = poll(&p, 1, 0) > 0 ? read(slave_fd, rx, sizeof(rx)) : 0;
+        if (n <= 0)
+        {
+            return PICO_ERROR_TIMEOUT;
+        }
+        rx_head = 0;
+        rx_tail = uint32_t(n);
+    }
+    return (unsigned char)rx[rx_head++];
+}
+
+int stdio_put_string(const char* s, int len, bool, bool)
+{
+    for (int done = 0; done < len;)
+    {
+        ssize_t n = write(slave_fd, s + done, size_t(len - done));
+        if (n < 0)
+        {
+            fail("write to the pty", long(errno));
+            return done;
+        }
+        done += int(n);
+    }
+    return len;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void*), void* param)
+{
+    chars_available = fn;
+    chars_available_param = param;
+}
+
+} // extern "C"
+
+namespace vfo_loop
+{
+void post_wake(uint32_t)
+{
+    woken.store(true, std::memory_order_relaxed);
+}
+} // namespace vfo_loop
+
+namespace
+{
+
+struct LoopStats
+{
+    uint32_t passes = 0; // poll_cat() calls that found bytes
+    uint32_t requests = 0;
+    double total_us = 0;
+    double max_us = 0;
+};
+
+// The main loop: sleep until woken, serve CAT, apply what it asked for
+void rig_loop(std::atomic<bool>& stop, LoopStats& stats)
+{
+    vfo_cat::CatParser parser;
+    uint32_t hz = 7074000;
+    vfo_band::Mode mode = vfo_band::Mode::USB;
+    parser.update_rig(hz, mode);
+    vfo_cat::start_cat();
+
+    while (!stop.load())
+    {
+        if (!woken.exchange(false))
+        {
+            // The driver's interrupt: new bytes have arrived. Bytes already
+            // in its buffer raise none, so poll_cat() has to ask to come back
+            pollfd p = { slave_fd, POLLIN, 0 };
+            if (poll(&p, 1, 10) <= 0)
+            {
+                continue;
+            }
+            chars_available(chars_available_param);
+            woken.store(false);
+        }
+
+        auto start = Clock::now();
+        vfo_cat::poll_cat(parser);
+        vfo_cat::CatRequest request;
+        if (parser.take_request(request))
+        {
+            hz = request.set_frequency ? request.frequency_hz : hz;
+            mode = request.set_mode ? request.mode : mode;
+            parser.update_rig(hz, mode);
+            stats.requests++;
+        }
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        stats.passes++;
+        stats.total_us += us;
+        stats.max_us = std::max(stats.max_us, us);
+    }
+}
+
+// The logging program's view of the rig, and the command it sends next
+struct Logger
+{
+    uint32_t hz = 7074000;
+    uint32_t vfo_b_hz = 7074000;
+    char mode = '2';
+    uint32_t sent = 0;
+    uint32_t sets = 0;
+
+    // One command; the reply it must get, or empty for a set
+    std::string next(std::string& expected)
+    {
+        char text[48];
+        sent++;
+        if (sent % CHECK_SET_EVERY == 0)
+        {
+            sets++;
+            if (sets % 3 == 0)
+            {
+                mode = "123"[sets / 3 % 3];
+                snprintf(text, sizeof(text), "MD%c;", mode);
+            }
+            else
+            {
+                hz = 7000000 + (sent * 7919) % 200000;
+                snprintf(text, sizeof(text), "FA%011u;", hz);
+            }
+            expected.clear();
+            return text;
+        }
+        switch (sent % 4)
+        {
+        case 0:
+            snprintf(text, sizeof(text), "FA%011u;", hz);
+            expected = text;
+            return "FA;";
+        case 1:
+            snprintf(text, sizeof(text), "IF%011u     +0000000000%c0000000;", hz, mode);
+            expected = text;
+            return "IF;";
+        case 2:
+            snprintf(text, sizeof(text), "MD%c;", mode);
+            expected = text;
+            return "MD;";
+        default:
+            snprintf(text, sizeof(text), "FB%011u;", vfo_b_hz);
+            expected = text;
+            return "FB;";
+        }
+    }
+};
+
+// Replies come back whole or in pieces; split them at the terminators
+struct Replies
+{
+    std::string partial;
+    std::deque<std::string> expected;
+    uint32_t received = 0;
+    uint32_t wrong = 0;
+
+    void read_some()
+    {
+        char buffer[512];
+        ssize_t n = read(master_fd, buffer, sizeof(buffer));
+        for (ssize_t i = 0; i < n; i++)
+        {
+            partial += buffer[i];
+            if (buffer[i] != ';')
+            {
+                continue;
+            }
+            received++;
+            if (expected.empty() || partial != expected.front())
+            {
+                if (!wrong++)
+                {
+                    fprintf(stderr, "reply %s, expected %s\n", partial.c_str(),
+                        expected.empty() ? "none" : expected.front().c_str());
+                }
+            }
+            if (!expected.empty())
+            {
+                expected.pop_front();
+            }
+            partial.clear();
+        }
+    }
+};
+
+void send(const std::string& command)
+{
+    if (write(master_fd, command.data(), command.size()) != ssize_t(command.size()))
+    {
+        fail("write to the pty", long(errno));
+    }
+}
+
+bool wait_readable(int timeout_ms)
+{
+    pollfd p = { master_fd, POLLIN, 0 };
+    return poll(&p, 1, timeout_ms) > 0;
+}
+
+void report(const char* name, const Replies& r, uint32_t commands, double seconds)
+{
+    printf("%-10s %6u commands, %6u replies, %u wrong: %8.0f commands/s\n", name, commands, r.received, r.wrong,
+        commands / seconds);
+    if (r.wrong || !r.expected.empty())
+    {
+        fail(name, long(r.wrong), long(r.expected.size()));
+    }
+}
+
+void lockstep(Logger& logger, uint32_t commands)
+{
+    Replies r;
+    std::vector<double> round_trips;
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < commands; i++)
+    {
+        std::string expected;
+        std::string command = logger.next(expected);
+        auto sent = Clock::now();
+        send(command);
+        if (expected.empty())
+        {
+            continue;
+        }
+        r.expected.push_back(expected);
+        while (!r.expected.empty())
+        {
+            if (!wait_readable(1000))
+            {
+                fail("no reply to command", long(i));
+                return;
+            }
+            r.read_some();
+        }
+        round_trips.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+    }
+    report("lockstep", r, commands, std::chrono::duration<double>(Clock::now() - start).count());
+
+    std::sort(round_trips.begin(), round_trips.end());
+    if (!round_trips.empty())
+    {
+        printf("           round trip p50 %6.1f us, p99 %6.1f us, max %6.1f us\n",
+            round_trips[round_trips.size() / 2], round_trips[round_trips.size() * 99 / 100], round_trips.back());
+    }
+}
+
+void pipelined(Logger& logger, uint32_t commands)
+{
+    Replies r;
+    auto start = Clock::now();
+    uint32_t i = 0;
+    while (i < commands || !r.expected.empty())
+    {
+        // Top the window up, then take whatever has come back
+        std::string batch;
+        while (i < commands && r.expected.size() < CHECK_WINDOW)
+        {
+            std::string expected;
+            batch += logger.next(expected);
+            if (!expected.empty())
+            {
+                r.expected.push_back(expected);
+            }
+            i++;
+        }
+        if (!batch.empty())
+        {
+            send(batch);
+        }
+        if (!r.expected.empty())
+        {
+            if (!wait_readable(1000))
+            {
+                fail("replies stopped at command", long(i), long(r.expected.size()));
+                return;
+            }
+            r.read_some();
+        }
+    }
+    report("pipelined", r, commands, std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t commands = argc > 1 ? uint32_t(atoi(argv[1])) : CHECK_COMMANDS;
+
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd < 0 || grantpt(master_fd) || unlockpt(master_fd))
+    {
+        perror("cat_stress: posix_openpt");
+        return 1;
+    }
+    slave_fd = open(ptsname(master_fd), O_RDWR | O_NOCTTY);
+    termios raw;
+    if (slave_fd < 0 || tcgetattr(slave_fd, &raw))
+    {
+        perror("cat_stress: pty slave");
+        return 1;
+    }
+    // A CDC port passes bytes through untouched
+    cfmakeraw(&raw);
+    tcsetattr(slave_fd, TCSANOW, &raw);
+
+    std::atomic<bool> stop = false;
+    LoopStats stats;
+    std::thread rig(rig_loop, std::ref(stop), std::ref(stats));
+
+    // The rig keeps its state from one phase to the next, and so does the logger
+    Logger logger;
+    lockstep(logger, commands);
+    pipelined(logger, commands);
+
+    stop.store(true);
+    rig.join();
+    printf("loop: %u poll_cat() passes, %u requests applied, %.2f us mean, %.2f us max\n", stats.passes,
+        stats.requests, stats.passes ? stats.total_us / stats.passes : 0.0, stats.max_us);
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+// The SSB demodulator (demod.h) on two tones, one on each sideband.
+//
+//   demod_check
+//
+// I/Q at the capture rate goes through SsbDemodulator in capture-sized blocks.
+// With USB selected the upper tone must come out at its own level and the
+// lower one be suppressed, and the other way round for LSB. The pair is moved
+// across the audio passband; reported per pair are the wanted tone's level,
+// against the decimating low-pass's response at that frequency, and the
+// opposite sideband's suppression, against a bound that is lower at the bottom
+// of the band, where the 127 tap Hilbert's response falls away.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "audio.h"
+#include "demod.h"
+
+// demod.cpp brings the rest of the receive path, and that the simulator's HAL
+namespace vfo_sim
+{
+void finish(int code)
+{
+    exit(code);
+}
+} // namespace vfo_sim
+
+namespace
+{
+
+#define CHECK_IQ_RATE (AUDIO_SAMPLE_RATE * DEMOD_DECIMATION)
+#define CHECK_FRAMES (CHECK_IQ_RATE / 2)
+#define CHECK_SETTLE_FRAMES 2048 // Decimator and Hilbert filling, left out of the measurement
+#define CHECK_LEVEL 0.35 // Of full scale, per tone
+#define CHECK_LEVEL_DB 0.2 // Against the decimator's response
+#define CHECK_SUPPRESSION_DB 50
+#define CHECK_EDGE_HZ 500 // Below it the Hilbert's gain falls short of unity, so
+#define CHECK_EDGE_LEVEL_DB 1 // half the wanted tone comes out low
+#define CHECK_EDGE_SUPPRESSION_DB 20 // and half the unwanted one is left
+
+uint32_t failures = 0;
+
+void fail(const char* what, double hz, double value)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "demod_check: %s at %.0f Hz (%.2f)\n", what, hz, value);
+    }
+}
+
+// Amplitude of the sine at hz (Goertzel)
+double tone_amplitude(const std::vector<int16_t>& x, double rate, double hz)
+{
+    double coeff = 2 * std::cos(2 * M_PI * hz / rate);
+    double s1 = 0, s2 = 0;
+    for (int16_t v : x)
+    {
+        double s0 = v + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    return 2 * std::sqrt(std::max(power, 0.0)) / x.size();
+}
+
+// Gain of the demodulator's decimating low-pass at hz
+double decimator_gain(double hz)
+{
+    vfo_dsp::FirTaps<DEMOD_DECIMATION_TAPS> taps = vfo_dsp::fir_lowpass<DEMOD_DECIMATION_TAPS>(CHECK_IQ_RATE, 4000);
+    double re = 0, im = 0;
+    for (uint32_t n = 0; n < taps.size(); n++)
+    {
+        re += taps[n] * std::cos(2 * M_PI * hz * n / CHECK_IQ_RATE);
+        im -= taps[n] * std::sin(2 * M_PI * hz * n / CHECK_IQ_RATE);
+    }
+    return std::hypot(re, im) / 32768;
+}
+
+// The upper tone with Q a quarter cycle behind I, the lower one ahead
+std::vector<int16_t> two_tones(double usb_hz, double lsb_hz)
+{
+    std::vector<int16_t> iq(CHECK_FRAMES * 2);
+    double a = CHECK_LEVEL * 32767;
+    for (uint32_t n = 0; n < CHECK_FRAMES; n++)
+    {
+        double u = 2 * M_PI * usb_hz * n / CHECK_IQ_RATE;
+        double l = 2 * M_PI * lsb_hz * n / CHECK_IQ_RATE;
+        iq[n * 2] = int16_t(std::lround(a * (std::cos(u) + std::cos(l))));
+        iq[n * 2 + 1] = int16_t(std::lround(a * (std::sin(u) - std::sin(l))));
+    }
+    return iq;
+}
+
+std::vector<int16_t> demodulate(vfo_demod::Sideband sideband, const std::vector<int16_t>& iq)
+{
+    vfo_demod::SsbDemodulator demod(CHECK_IQ_RATE);
+    demod.set_sideband(sideband);
+
+    std::vector<int16_t> audio;
+    int16_t block[SAMPLES_PER_BUFFER * 2];
+    for (uint32_t at = 0; at < CHECK_FRAMES; at += SAMPLES_PER_BUFFER)
+    {
+        uint32_t frames = std::min<uint32_t>(SAMPLES_PER_BUFFER, CHECK_FRAMES - at);
+        std::copy_n(&iq[at * 2], frames * 2, block);
+        uint32_t count = demod.process(block, frames);
+        if (at >= CHECK_SETTLE_FRAMES)
+        {
+            audio.insert(audio.end(), block, block + count);
+        }
+    }
+    return audio;
+}
+
+// Both sidebands of a pair, each selected in turn
+void check_pair(double usb_hz, double lsb_hz)
+{
+    std::vector<int16_t> iq = two_tones(usb_hz, lsb_hz);
+    for (vfo_demod::Sideband sideband : { vfo_demod::Sideband::USB, vfo_demod::Sideband::LSB })
+    {
+        bool usb = sideband == vfo_demod::Sideband::USB;
+        double wanted_hz = usb ? usb_hz : lsb_hz;
+        double unwanted_hz = usb ? lsb_hz : usb_hz;
+
+        std::vector<int16_t> audio = demodulate(sideband, iq);
+        double wanted = tone_amplitude(audio, AUDIO_SAMPLE_RATE, wanted_hz);
+        double unwanted = tone_amplitude(audio, AUDIO_SAMPLE_RATE, unwanted_hz);
+        double expected_db = 20 * std::log10(decimator_gain(wanted_hz));
+        double level_db = 20 * std::log10(wanted / (CHECK_LEVEL * 32767));
+        double suppression_db = 20 * std::log10(wanted / std::max(unwanted, 1e-3));
+        double bound_db = unwanted_hz < CHECK_EDGE_HZ ? CHECK_EDGE_SUPPRESSION_DB : CHECK_SUPPRESSION_DB;
+
+        printf("%s %4.0f Hz kept at %+5.2f dB (%+5.2f), %4.0f Hz on the other sideband %5.1f dB down\n",
+            usb ? "USB" : "LSB", wanted_hz, level_db, expected_db, unwanted_hz, suppression_db);
+        double tolerance_db = wanted_hz < CHECK_EDGE_HZ ? CHECK_EDGE_LEVEL_DB : CHECK_LEVEL_DB;
+        if (std::fabs(level_db - expected_db) > tolerance_db)
+        {
+            fail(usb ? "USB level, dB" : "LSB level, dB", wanted_hz, level_db);
+        }
+        if (suppression_db < bound_db)
+        {
+            fail(usb ? "LSB suppression, dB" : "USB suppression, dB", unwanted_hz, suppression_db);
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    // Across the SSB passband, never a tone on the same audio frequency as its pair
+    check_pair(700, 1900);
+    check_pair(1900, 700);
+    check_pair(400, 2700);
+    check_pair(2700, 400);
+    check_pair(1000, 1500);
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
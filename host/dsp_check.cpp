@@ -0,0 +1,301 @@
+// The fixed-point DSP stages (dsp.h) against the same stages in double
+// precision, on noise with two tones in it.
+//
+//   dsp_check
+//
+// The references take the same int16 input, use coefficients designed with the
+// standard library's maths, and keep everything in double. Each stage runs in
+// blocks of DSP_CHECK_BLOCK samples, so the state carried between blocks is
+// checked too. Reported per stage: the largest error in LSB and the ratio of
+// the reference's power to the error's in dB, each against a bound. The
+// compile-time designs are checked against the reference coefficients first,
+// and the limiter's output against its threshold.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "dsp.h"
+
+namespace
+{
+
+#define DSP_CHECK_RATE 44100.0
+#define DSP_CHECK_SAMPLES 16384
+#define DSP_CHECK_BLOCK 256
+
+uint32_t failures = 0;
+
+void fail(const char* what, double value)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "dsp_check: %s (%.3f)\n", what, value);
+    }
+}
+
+std::vector<int16_t> test_signal(double level)
+{
+    std::vector<int16_t> x(DSP_CHECK_SAMPLES);
+    uint32_t noise = 1;
+    for (uint32_t n = 0; n < x.size(); n++)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        double v = 0.45 * std::sin(2 * M_PI * 700 * n / DSP_CHECK_RATE)
+            + 0.3 * std::sin(2 * M_PI * 5100 * n / DSP_CHECK_RATE) + 0.15 * (double(noise >> 8) / (1 << 24) - 0.5);
+        x[n] = int16_t(std::lround(v * level * 32767));
+    }
+    return x;
+}
+
+// Runs a stage over the signal in blocks, gathering what it leaves in each
+template <typename Stage>
+std::vector<int16_t> run_fixed(Stage& stage, const std::vector<int16_t>& x)
+{
+    std::vector<int16_t> out;
+    int16_t block[DSP_CHECK_BLOCK];
+    for (size_t at = 0; at < x.size(); at += DSP_CHECK_BLOCK)
+    {
+        uint32_t count = uint32_t(std::min<size_t>(DSP_CHECK_BLOCK, x.size() - at));
+        std::copy_n(&x[at], count, block);
+        count = stage.process(block, count);
+        out.insert(out.end(), block, block + count);
+    }
+    return out;
+}
+
+void compare(const char* name, const std::vector<int16_t>& fixed, const std::vector<double>& reference,
+    double max_error_bound, double snr_bound)
+{
+    if (fixed.size() != reference.size())
+    {
+        fail(name, double(fixed.size()));
+        return;
+    }
+    double max_error = 0;
+    double signal = 0;
+    double error = 0;
+    for (size_t n = 0; n < fixed.size(); n++)
+    {
+        double e = fixed[n] - reference[n];
+        max_error = std::max(max_error, std::fabs(e));
+        signal += reference[n] * reference[n];
+        error += e * e;
+    }
+    double snr = error > 0 ? 10 * std::log10(signal / error) : INFINITY;
+    printf("%-28s max error %6.2f LSB  SNR %6.1f dB\n", name, max_error, snr);
+    if (max_error > max_error_bound)
+    {
+        fail(name, max_error);
+    }
+    if (snr < snr_bound)
+    {
+        fail(name, snr);
+    }
+}
+
+//
+// Biquads
+//
+struct Coeffs
+{
+    double b0, b1, b2, a1, a2;
+};
+
+enum class Shape
+{
+    Lowpass,
+    Highpass,
+    Bandpass
+};
+
+Coeffs design(Shape shape, double fs, double f0, double q)
+{
+    double w0 = 2 * M_PI * f0 / fs;
+    double c = std::cos(w0);
+    double alpha = std::sin(w0) / (2 * q);
+    double a0 = 1 + alpha;
+    switch (shape)
+    {
+    case Shape::Lowpass:
+        return { (1 - c) / 2 / a0, (1 - c) / a0, (1 - c) / 2 / a0, -2 * c / a0, (1 - alpha) / a0 };
+    case Shape::Highpass:
+        return { (1 + c) / 2 / a0, -(1 + c) / a0, (1 + c) / 2 / a0, -2 * c / a0, (1 - alpha) / a0 };
+    default:
+        return { alpha / a0, 0, -alpha / a0, -2 * c / a0, (1 - alpha) / a0 };
+    }
+}
+
+vfo_dsp::BiquadCoeffs design_fixed(Shape shape, double fs, double f0, double q)
+{
+    switch (shape)
+    {
+    case Shape::Lowpass:
+        return vfo_dsp::biquad_lowpass(fs, f0, q);
+    case Shape::Highpass:
+        return vfo_dsp::biquad_highpass(fs, f0, q);
+    default:
+        return vfo_dsp::biquad_bandpass(fs, f0, q);
+    }
+}
+
+std::vector<double> biquad_reference(const Coeffs& c, const std::vector<int16_t>& x)
+{
+    std::vector<double> y(x.size());
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    for (size_t n = 0; n < x.size(); n++)
+    {
+        y[n] = c.b0 * x[n] + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+        x2 = x1;
+        x1 = x[n];
+        y2 = y1;
+        y1 = y[n];
+    }
+    return y;
+}
+
+void check_biquad(const char* name, Shape shape, double f0, double q, double max_error_bound, double snr_bound)
+{
+    Coeffs c = design(shape, DSP_CHECK_RATE, f0, q);
+    vfo_dsp::BiquadCoeffs fixed = design_fixed(shape, DSP_CHECK_RATE, f0, q);
+
+    // The compile-time cos and sin against libm, to within the rounding to Q30
+    const double expected[5] = { c.b0, c.b1, c.b2, c.a1, c.a2 };
+    const int32_t got[5] = { fixed.b0, fixed.b1, fixed.b2, fixed.a1, fixed.a2 };
+    for (int i = 0; i < 5; i++)
+    {
+        double off = std::fabs(got[i] - expected[i] * (1 << 30));
+        if (off > 1)
+        {
+            fail("biquad coefficient off by more than 1 LSB of Q30", off);
+        }
+    }
+
+    std::vector<int16_t> x = test_signal(0.5);
+    vfo_dsp::Biquad biquad(fixed);
+    compare(name, run_fixed(biquad, x), biquad_reference(c, x), max_error_bound, snr_bound);
+}
+
+//
+// Decimating FIR
+//
+template <uint32_t Taps>
+std::vector<double> fir_design(double fs, double fc)
+{
+    std::vector<double> h(Taps);
+    double sum = 0;
+    double mid = (Taps - 1) / 2.0;
+    for (uint32_t n = 0; n < Taps; n++)
+    {
+        double t = n - mid;
+        double sinc = t == 0 ? 2 * fc / fs : std::sin(2 * M_PI * fc / fs * t) / (M_PI * t);
+        h[n] = sinc * (0.54 - 0.46 * std::cos(2 * M_PI * n / (Taps - 1)));
+        sum += h[n];
+    }
+    for (double& v : h)
+    {
+        v /= sum;
+    }
+    return h;
+}
+
+template <uint32_t Taps, uint32_t Factor>
+void check_fir(const char* name, double fs, double fc, double max_error_bound, double snr_bound)
+{
+    std::vector<double> h = fir_design<Taps>(fs, fc);
+    vfo_dsp::FirTaps<Taps> taps = vfo_dsp::fir_lowpass<Taps>(fs, fc);
+    for (uint32_t n = 0; n < Taps; n++)
+    {
+        double off = std::fabs(taps[n] - h[n] * 32768);
+        if (off > 0.5 + 1e-6)
+        {
+            fail("FIR tap off by more than half an LSB of Q15", off);
+        }
+    }
+
+    // Output n is the dot product ending on input sample (n + 1) * Factor - 1
+    std::vector<int16_t> x = test_signal(0.5);
+    std::vector<double> y;
+    for (size_t end = Factor - 1; end < x.size(); end += Factor)
+    {
+        double acc = 0;
+        for (uint32_t k = 0; k < Taps && k <= end; k++)
+        {
+            acc += h[k] * x[end - k];
+        }
+        y.push_back(acc);
+    }
+
+    vfo_dsp::DecimatingFir<Taps, Factor> fir(taps);
+    compare(name, run_fixed(fir, x), y, max_error_bound, snr_bound);
+}
+
+//
+// Gain and limiter
+//
+void check_gain(const char* name, double gain, double max_error_bound, double snr_bound)
+{
+    std::vector<int16_t> x = test_signal(0.4);
+    int32_t gain_q12 = int32_t(std::lround(gain * vfo_dsp::Gain::unity));
+    std::vector<double> y(x.size());
+    for (size_t n = 0; n < x.size(); n++)
+    {
+        y[n] = std::clamp(x[n] * double(gain_q12) / vfo_dsp::Gain::unity, -32768.0, 32767.0);
+    }
+    vfo_dsp::Gain stage(gain_q12);
+    compare(name, run_fixed(stage, x), y, max_error_bound, snr_bound);
+}
+
+void check_limiter(const char* name, double threshold, uint32_t release_shift, double level,
+    double max_error_bound, double snr_bound)
+{
+    std::vector<int16_t> x = test_signal(level);
+    int16_t threshold_q15 = vfo_dsp::q15(threshold);
+
+    // Instant attack, release by 2^-release_shift of the envelope per sample
+    std::vector<double> y(x.size());
+    double envelope = 0;
+    for (size_t n = 0; n < x.size(); n++)
+    {
+        envelope = std::max(std::fabs(double(x[n])), envelope * (1 - std::ldexp(1.0, -int(release_shift))));
+        y[n] = envelope > threshold_q15 ? x[n] * threshold_q15 / envelope : x[n];
+    }
+
+    vfo_dsp::Limiter limiter(threshold_q15, release_shift);
+    std::vector<int16_t> out = run_fixed(limiter, x);
+    int32_t peak = 0;
+    for (int16_t v : out)
+    {
+        peak = std::max(peak, std::abs(int32_t(v)));
+    }
+    if (peak > threshold_q15 + 1)
+    {
+        fail("limiter output over its threshold", peak);
+    }
+    compare(name, out, y, max_error_bound, snr_bound);
+}
+
+} // namespace
+
+int main()
+{
+    // The output rounding goes round the poles, further the closer they sit to
+    // the unit circle, so the low and narrow designs get looser bounds
+    check_biquad("biquad lowpass 3 kHz", Shape::Lowpass, 3000, 0.707, 2, 80);
+    check_biquad("biquad highpass 300 Hz", Shape::Highpass, 300, 0.707, 8, 73);
+    check_biquad("biquad bandpass 700 Hz Q 5", Shape::Bandpass, 700, 5, 8, 68);
+
+    // Q15 taps and an output truncated, not rounded: a -0.5 LSB offset
+    check_fir<32, 1>("fir 32 taps", DSP_CHECK_RATE, 4000, 2, 75);
+    check_fir<32, 2>("fir 32 taps, decimate 2", DSP_CHECK_RATE * 2, 4000, 2, 75);
+
+    check_gain("gain 1.5", 1.5, 1, 85);
+    check_gain("gain 3, clipping", 3, 1, 85);
+
+    check_limiter("limiter idle", 0.9, 10, 0.5, 0, INFINITY);
+    check_limiter("limiter 0.5, release 2^10", 0.5, 10, 1, 2, 80);
+    check_limiter("limiter 0.25, release 2^6", 0.25, 6, 1, 2, 75);
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
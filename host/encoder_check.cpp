@@ -0,0 +1,522 @@
+// The tuning encoder's PIO program (quadrature_encoder.pio), assembled from its
+// source and run instruction by instruction against encoder waveforms.
+//
+//   encoder_check [program.pio]
+//
+// The state machine runs at eight instructions per microsecond, as
+// quadrature_encoder_program_init() clocks it. The waveforms come from a model
+// of a mechanical encoder: detents of four edges (or two, for half-step
+// encoders), and on every edge the moving contact bounces for a while with
+// pulses from tens of nanoseconds to tens of microseconds. At each detent,
+// once the contact has settled, X must hold the exact edge count, the last
+// value in the RX FIFO must be that count, and no value may be pushed twice
+// running. Pulses on both pins inside one sample are invalid transitions and
+// must leave the count alone. The IRQ handler drains the FIFO a couple of
+// microseconds after each push.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+#define CHECK_INSTRUCTION_NS 125 // QUADRATURE_SAMPLE_HZ with 8 instructions per sample
+#define CHECK_IRQ_LATENCY_NS 2000 // Push to the handler draining the FIFO
+#define CHECK_FIFO_DEPTH 8 // RX joined
+#define CHECK_SETTLE_NS 200000 // Left still at each detent before checking
+
+uint32_t failures = 0;
+
+void fail(const char* what, long a, long b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "encoder_check: %s (%ld, %ld)\n", what, a, b);
+    }
+}
+
+enum Reg
+{
+    REG_PINS,
+    REG_X,
+    REG_Y,
+    REG_ISR,
+    REG_OSR,
+    REG_PC,
+    REG_NULL,
+    REG_NONE
+};
+
+Reg parse_reg(const std::string& name)
+{
+    static const char* names[] = { "pins", "x", "y", "isr", "osr", "pc", "null" };
+    for (uint32_t i = 0; i < REG_NONE; i++)
+    {
+        if (name == names[i])
+        {
+            return Reg(i);
+        }
+    }
+    return REG_NONE;
+}
+
+// The part of the PIO instruction set the program uses; anything else is refused
+struct Instruction
+{
+    enum Op
+    {
+        JMP,
+        JMP_X_DEC,
+        IN,
+        OUT,
+        MOV,
+        PUSH_NOBLOCK
+    } op;
+    std::string target; // JMP: label
+    Reg dest;
+    Reg source;
+    bool invert;
+    uint32_t bits;
+    uint32_t address; // JMP, once resolved
+};
+
+struct Program
+{
+    std::vector<Instruction> code;
+    uint32_t wrap_target = 0;
+    uint32_t wrap = 0;
+};
+
+bool assemble(const char* path, Program& program)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        fprintf(stderr, "encoder_check: can't open %s\n", path);
+        return false;
+    }
+    std::map<std::string, uint32_t> labels;
+    bool wrap_set = false;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.rfind("%", 0) == 0)
+        {
+            break; // The C SDK block
+        }
+        line = line.substr(0, line.find(';'));
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream words(line);
+        std::string word;
+        if (!(words >> word))
+        {
+            continue;
+        }
+        if (word.back() == ':')
+        {
+            labels[word.substr(0, word.size() - 1)] = uint32_t(program.code.size());
+            continue;
+        }
+        if (word == ".program" || word == ".origin")
+        {
+            continue;
+        }
+        if (word == ".wrap_target")
+        {
+            program.wrap_target = uint32_t(program.code.size());
+            continue;
+        }
+        if (word == ".wrap")
+        {
+            program.wrap = uint32_t(program.code.size()) - 1;
+            wrap_set = true;
+            continue;
+        }
+
+        Instruction in = {};
+        std::string a, b;
+        words >> a >> b;
+        bool supported = true;
+        if (word == "jmp")
+        {
+            in.op = b.empty() ? Instruction::JMP : Instruction::JMP_X_DEC;
+            in.target = b.empty() ? a : b;
+            supported = b.empty() || a == "x--";
+        }
+        else if (word == "in" || word == "out")
+        {
+            in.op = word == "in" ? Instruction::IN : Instruction::OUT;
+            in.source = word == "in" ? parse_reg(a) : REG_OSR;
+            in.dest = word == "out" ? parse_reg(a) : REG_ISR;
+            in.bits = uint32_t(atoi(b.c_str()));
+            supported = in.source != REG_NONE && in.dest != REG_NONE && in.dest != REG_PINS && in.dest != REG_PC;
+        }
+        else if (word == "mov" && !b.empty())
+        {
+            in.op = Instruction::MOV;
+            in.dest = parse_reg(a);
+            in.invert = b[0] == '~' || b[0] == '!';
+            in.source = parse_reg(in.invert ? b.substr(1) : b);
+            supported = in.source != REG_NONE && in.source != REG_PC && in.dest != REG_NONE && in.dest != REG_PINS;
+        }
+        else
+        {
+            in.op = Instruction::PUSH_NOBLOCK;
+            supported = word == "push" && a == "noblock";
+        }
+        if (!supported)
+        {
+            fprintf(stderr, "encoder_check: unsupported instruction %s\n", line.c_str());
+            return false;
+        }
+        program.code.push_back(in);
+    }
+
+    for (Instruction& in : program.code)
+    {
+        if (in.op == Instruction::JMP || in.op == Instruction::JMP_X_DEC)
+        {
+            auto label = labels.find(in.target);
+            if (label == labels.end())
+            {
+                fprintf(stderr, "encoder_check: no label %s\n", in.target.c_str());
+                return false;
+            }
+            in.address = label->second;
+        }
+    }
+    if (!wrap_set || program.code.size() > 32)
+    {
+        fprintf(stderr, "encoder_check: %zu instructions, wrap %s\n", program.code.size(), wrap_set ? "set" : "missing");
+        return false;
+    }
+    return true;
+}
+
+// One state machine: ISR shifting left, OSR right, no autopush, RX FIFO joined
+struct StateMachine
+{
+    const Program* program;
+    uint32_t pc = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t isr = 0;
+    uint32_t osr = 0;
+    std::deque<uint32_t> fifo;
+    uint32_t pushes = 0;
+    uint32_t dropped = 0; // Pushes onto a full FIFO
+
+    uint32_t read(Reg r, uint32_t pins) const
+    {
+        switch (r)
+        {
+        case REG_PINS:
+            return pins;
+        case REG_X:
+            return x;
+        case REG_Y:
+            return y;
+        case REG_ISR:
+            return isr;
+        case REG_OSR:
+            return osr;
+        default:
+            return 0;
+        }
+    }
+
+    void write(Reg r, uint32_t value)
+    {
+        switch (r)
+        {
+        case REG_X:
+            x = value;
+            break;
+        case REG_Y:
+            y = value;
+            break;
+        case REG_ISR:
+            isr = value;
+            break;
+        case REG_OSR:
+            osr = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void step(uint32_t pins)
+    {
+        const Instruction& in = program->code[pc];
+        uint32_t next = pc == program->wrap ? program->wrap_target : pc + 1;
+        uint32_t mask = in.bits >= 32 ? ~0u : (1u << in.bits) - 1;
+        switch (in.op)
+        {
+        case Instruction::JMP:
+            next = in.address;
+            break;
+        case Instruction::JMP_X_DEC:
+            if (x != 0)
+            {
+                next = in.address;
+            }
+            x--;
+            break;
+        case Instruction::IN:
+            isr = (isr << in.bits) | (read(in.source, pins) & mask);
+            break;
+        case Instruction::OUT:
+        {
+            uint32_t value = osr & mask;
+            osr >>= in.bits;
+            write(in.dest, value);
+            break;
+        }
+        case Instruction::MOV:
+        {
+            uint32_t value = read(in.source, pins);
+            value = in.invert ? ~value : value;
+            if (in.dest == REG_PC)
+            {
+                next = value & 31;
+            }
+            else
+            {
+                write(in.dest, value);
+            }
+            break;
+        }
+        case Instruction::PUSH_NOBLOCK:
+            if (fifo.size() < CHECK_FIFO_DEPTH)
+            {
+                fifo.push_back(isr);
+                pushes++;
+            }
+            else
+            {
+                dropped++;
+            }
+            isr = 0;
+            break;
+        }
+        pc = next;
+    }
+};
+
+// Pin levels over time: A on bit 0, B on bit 1
+struct Waveform
+{
+    struct Edge
+    {
+        uint64_t at_ns;
+        uint32_t pins;
+    };
+    std::vector<Edge> edges;
+    std::vector<std::pair<uint64_t, int32_t>> detents; // Settled from this time, at this count
+    uint32_t state = 0;
+    uint64_t now_ns = 0;
+    int32_t count = 0;
+    uint32_t noise = 12345;
+
+    uint32_t random(uint32_t range)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        return (noise >> 8) % range;
+    }
+
+    void set(uint32_t pins)
+    {
+        state = pins;
+        edges.push_back({ now_ns, pins });
+    }
+
+    // One quadrature edge forwards (increment) or back, with the moving
+    // contact bouncing for up to bounce_ns first
+    void edge(bool forward, uint64_t bounce_ns)
+    {
+        static const uint32_t gray[] = { 0, 1, 3, 2 };
+        uint32_t index = uint32_t(std::find(gray, gray + 4, state) - gray);
+        uint32_t target = gray[(index + (forward ? 1 : 3)) % 4];
+        uint32_t pin = state ^ target;
+
+        uint64_t settle = now_ns + (bounce_ns ? random(uint32_t(bounce_ns)) : 0);
+        while (now_ns < settle)
+        {
+            set(state ^ pin);
+            now_ns += 30 + random(random(2) ? 500 : 30000);
+        }
+        set(target);
+        count += forward ? 1 : -1;
+    }
+
+    // A detent's worth of edges spread over period_ns, then still
+    void turn(bool forward, uint32_t edges_per_detent, uint64_t period_ns, uint64_t bounce_ns)
+    {
+        for (uint32_t i = 0; i < edges_per_detent; i++)
+        {
+            uint64_t start = now_ns;
+            edge(forward, bounce_ns);
+            now_ns = std::max(now_ns, start + period_ns / edges_per_detent);
+        }
+    }
+
+    void rest()
+    {
+        detents.push_back({ now_ns, count });
+        now_ns += CHECK_SETTLE_NS;
+    }
+
+    // Both pins flipped between two samples, and back: two invalid transitions
+    void glitch()
+    {
+        set(state ^ 3);
+        now_ns += 1500;
+        set(state ^ 3);
+        now_ns += 5000;
+    }
+};
+
+struct Result
+{
+    uint32_t wrong_counts; // X at a detent
+    uint32_t wrong_latest; // Value the IRQ handler kept, at a detent
+    uint32_t repeats; // Pushes of an unchanged count
+    uint32_t pushes;
+    uint32_t dropped;
+};
+
+Result run(const Program& program, const Waveform& wave)
+{
+    StateMachine sm;
+    sm.program = &program;
+    sm.y = 0; // Pins at rest, as init sets it
+
+    Result r = {};
+    uint32_t pins = 0;
+    size_t next_edge = 0;
+    size_t next_detent = 0;
+    int32_t latest = 0;
+    int32_t last_pushed = 0;
+    uint64_t drain_at = UINT64_MAX;
+    uint64_t end = wave.now_ns;
+    for (uint64_t t = 0; t < end; t += CHECK_INSTRUCTION_NS)
+    {
+        while (next_edge < wave.edges.size() && wave.edges[next_edge].at_ns <= t)
+        {
+            pins = wave.edges[next_edge++].pins;
+        }
+
+        uint32_t pushes = sm.pushes;
+        sm.step(pins);
+        if (sm.pushes != pushes)
+        {
+            int32_t pushed = int32_t(sm.fifo.back());
+            r.repeats += pushed == last_pushed;
+            last_pushed = pushed;
+            drain_at = std::min(drain_at, t + CHECK_IRQ_LATENCY_NS);
+        }
+        if (t >= drain_at)
+        {
+            // As pio_irq(): only the newest count matters
+            while (!sm.fifo.empty())
+            {
+                latest = int32_t(sm.fifo.front());
+                sm.fifo.pop_front();
+            }
+            drain_at = UINT64_MAX;
+        }
+
+        if (next_detent < wave.detents.size() && t >= wave.detents[next_detent].first + CHECK_SETTLE_NS / 2)
+        {
+            int32_t expected = wave.detents[next_detent++].second;
+            if (int32_t(sm.x) != expected)
+            {
+                if (!r.wrong_counts)
+                {
+                    fail("count at a detent", int32_t(sm.x), expected);
+                }
+                r.wrong_counts++;
+            }
+            if (latest != expected)
+            {
+                if (!r.wrong_latest)
+                {
+                    fail("latest count at a detent", latest, expected);
+                }
+                r.wrong_latest++;
+            }
+        }
+    }
+    r.pushes = sm.pushes;
+    r.dropped = sm.dropped;
+    return r;
+}
+
+void report(const char* name, const Program& program, const Waveform& wave)
+{
+    Result r = run(program, wave);
+    printf("%-40s %4zu detents %6zu pin changes %6u pushes %3u dropped: %u counts wrong, %u latest wrong, %u repeats\n",
+        name, wave.detents.size(), wave.edges.size(), r.pushes, r.dropped, r.wrong_counts, r.wrong_latest, r.repeats);
+    if (r.repeats)
+    {
+        fail("pushes of an unchanged count", long(r.repeats));
+    }
+}
+
+// Turns one way, back past the start, and a few single steps either way
+Waveform back_and_forth(uint32_t edges_per_detent, uint64_t period_ns, uint64_t bounce_ns, bool glitches)
+{
+    Waveform w;
+    w.now_ns = 10000;
+    w.rest();
+    for (int32_t move : { 25, -40, 15, 1, -1, 1, -1, -1, 3 })
+    {
+        for (int32_t i = 0; i < std::abs(move); i++)
+        {
+            w.turn(move > 0, edges_per_detent, period_ns, bounce_ns);
+            if (glitches && i % 3 == 0)
+            {
+                w.glitch();
+            }
+            // Slow turns stop at each detent, spins only at the end
+            if (period_ns > 10000000 || i == std::abs(move) - 1)
+            {
+                w.rest();
+            }
+        }
+    }
+    return w;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : ENCODER_PIO_PATH;
+    Program program;
+    if (!assemble(path, program))
+    {
+        return 1;
+    }
+    printf("%s: %zu instructions, wrap %u to %u\n", path, program.code.size(), program.wrap, program.wrap_target);
+
+    // A slow detent bounces for up to a millisecond on each edge; a fast spin
+    // leaves less time between edges than that, so its contacts must be cleaner
+    report("full step, 25/s, 1 ms bounce", program, back_and_forth(4, 40000000, 1000000, false));
+    report("full step, 25/s, 1 ms bounce, glitches", program, back_and_forth(4, 40000000, 1000000, true));
+    report("half step, 50/s, 1 ms bounce", program, back_and_forth(2, 20000000, 1000000, false));
+    report("full step, 200/s, 0.5 ms bounce", program, back_and_forth(4, 5000000, 500000, false));
+    report("full step, 1000/s, 50 us bounce", program, back_and_forth(4, 1000000, 50000, false));
+    report("full step, 5000/s, 10 us bounce", program, back_and_forth(4, 200000, 10000, false));
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
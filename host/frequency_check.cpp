@@ -0,0 +1,214 @@
+// Properties of the dial frequency (frequency.h) over random values, steps and
+// limits.
+//
+//   frequency_check
+//
+// Stepping a digit must carry and borrow into the digits above it exactly as
+// decimal addition does, checked against snprintf; the result must always lie
+// inside the limits and differ from the unclamped sum only by the clamp; a step
+// there and back inside the limits must return to the start; snapping must land
+// on the grid within half a step. The readout must match snprintf's digits with
+// a separator every three from the right, digit_column() must point at the
+// digit it names, and a buffer too small must give 0 and an empty string.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "frequency.h"
+
+namespace
+{
+
+#define CHECK_TRIALS 200000
+#define CHECK_MAX_HZ 3000000000u // Leaves room above for nine steps of the top digit
+
+uint32_t failures = 0;
+
+void fail(const char* what, long long a, long long b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "frequency_check: %s (%lld, %lld)\n", what, a, b);
+    }
+}
+
+uint32_t noise = 1;
+
+uint32_t random(uint32_t range)
+{
+    noise = noise * 1664525u + 1013904223u;
+    uint32_t high = noise >> 8;
+    noise = noise * 1664525u + 1013904223u;
+    return uint32_t(((uint64_t(high) << 24) | (noise >> 8)) % range);
+}
+
+// Mostly values with runs of nines and zeros, where the carries are
+uint32_t random_hz()
+{
+    if (random(2))
+    {
+        return random(CHECK_MAX_HZ);
+    }
+    uint32_t hz = 0;
+    for (uint32_t power = 0; power < FREQUENCY_MAX_DIGITS - 1; power++)
+    {
+        uint32_t pick = random(4);
+        hz += (pick == 0 ? 9 : pick == 1 ? 0 : random(10)) * vfo_ui::pow10[power];
+    }
+    return hz;
+}
+
+// The reference readout: snprintf's digits with separators inserted
+void grouped(uint32_t hz, char* out)
+{
+    char plain[16];
+    int n = snprintf(plain, sizeof(plain), "%u", hz);
+    uint32_t pos = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (i && (n - i) % 3 == 0)
+        {
+            out[pos++] = '.';
+        }
+        out[pos++] = plain[i];
+    }
+    out[pos] = 0;
+}
+
+void check_carry()
+{
+    uint32_t carries = 0;
+    for (uint32_t trial = 0; trial < CHECK_TRIALS; trial++)
+    {
+        uint32_t hz = random_hz();
+        uint32_t power = random(FREQUENCY_MAX_DIGITS - 1);
+        int32_t count = int32_t(random(19)) - 9;
+        vfo_ui::Frequency f(hz);
+        f.step(vfo_ui::pow10[power], count, 0, UINT32_MAX);
+
+        // Decimal addition on the digit strings, one column at a time
+        char digits[16];
+        snprintf(digits, sizeof(digits), "%010u", hz);
+        int32_t carry = count;
+        for (int32_t column = FREQUENCY_MAX_DIGITS - 1 - int32_t(power); column >= 0 && carry; column--)
+        {
+            int32_t d = digits[column] - '0' + carry;
+            carry = d < 0 ? -1 : d / 10;
+            digits[column] = char('0' + (d + 10) % 10);
+        }
+        uint32_t expected = carry < 0 ? 0 : uint32_t(strtoul(digits, nullptr, 10));
+        carries += (hz / vfo_ui::pow10[power + 1]) != (f.hz() / vfo_ui::pow10[power + 1]);
+        if (f.hz() != expected)
+        {
+            fail("digit step", f.hz(), expected);
+        }
+    }
+    printf("carry: %u steps of one digit, %u carried or borrowed\n", CHECK_TRIALS, carries);
+}
+
+void check_clamp()
+{
+    uint32_t clamped = 0, snapped = 0;
+    for (uint32_t trial = 0; trial < CHECK_TRIALS; trial++)
+    {
+        uint32_t a = random_hz(), b = random_hz();
+        uint32_t low = a < b ? a : b;
+        uint32_t high = a < b ? b : a;
+        uint32_t hz = low + random(high - low + 1);
+        uint32_t step_hz = vfo_ui::pow10[random(7)] * (1 + random(5));
+        int32_t count = int32_t(random(2001)) - 1000;
+        bool snap = random(4) == 0;
+
+        vfo_ui::Frequency f(hz);
+        f.step(step_hz, count, low, high, snap);
+        int64_t exact = int64_t(hz) + int64_t(step_hz) * count;
+        if (f.hz() < low || f.hz() > high)
+        {
+            fail("outside the limits", f.hz(), exact);
+            continue;
+        }
+        if (snap)
+        {
+            int64_t grid = (exact + step_hz / 2) / step_hz * step_hz;
+            bool in = grid >= low && grid <= high;
+            snapped++;
+            if (in ? f.hz() != grid || f.hz() % step_hz : f.hz() != (grid < low ? low : high))
+            {
+                fail("snapped", f.hz(), grid);
+            }
+            continue;
+        }
+        if (exact < low || exact > high)
+        {
+            clamped++;
+            if (f.hz() != (exact < low ? low : high))
+            {
+                fail("clamped", f.hz(), exact);
+            }
+            continue;
+        }
+        if (f.hz() != exact)
+        {
+            fail("stepped", f.hz(), exact);
+        }
+
+        // Back again lands where it started
+        f.step(step_hz, -count, low, high);
+        if (f.hz() != hz)
+        {
+            fail("there and back", f.hz(), hz);
+        }
+    }
+    printf("clamp: %u steps, %u clamped, %u snapped\n", CHECK_TRIALS, clamped, snapped);
+}
+
+void check_format()
+{
+    for (uint32_t trial = 0; trial < CHECK_TRIALS; trial++)
+    {
+        uint32_t hz = trial < 100 ? trial * trial * trial : random_hz();
+        vfo_ui::Frequency f(hz);
+        char text[16], expected[16];
+        uint32_t length = f.format(text, sizeof(text));
+        grouped(hz, expected);
+        if (strcmp(text, expected) != 0 || length != strlen(expected))
+        {
+            fail("format", hz, length);
+        }
+
+        char plain[16];
+        snprintf(plain, sizeof(plain), "%u", hz);
+        if (f.digits() != strlen(plain))
+        {
+            fail("digits", hz, f.digits());
+        }
+        for (uint32_t power = 0; power < f.digits(); power++)
+        {
+            if (text[f.digit_column(power)] != char('0' + hz / vfo_ui::pow10[power] % 10))
+            {
+                fail("digit column", hz, power);
+            }
+        }
+
+        // One byte short must not write past it
+        char small[16];
+        memset(small, 'x', sizeof(small));
+        if (f.format(small, length) != 0 || small[0] != 0 || small[length] != 'x')
+        {
+            fail("short buffer", hz, length);
+        }
+    }
+    printf("format: %u readouts\n", CHECK_TRIALS);
+}
+
+} // namespace
+
+int main()
+{
+    check_carry();
+    check_clamp();
+    check_format();
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
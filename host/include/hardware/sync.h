@@ -0,0 +1,30 @@
+#pragma once
+// Host stand-in for hardware/sync.h. The simulator is single threaded, so
+// interrupts are never masked; __wfe() runs the clock to the next event.
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void __sev(void);
+void __wfe(void);
+
+static inline void __dmb(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t save_and_disable_interrupts(void)
+{
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t status)
+{
+    (void)status;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+// Host stand-in for pico-extras' pico/audio.h: the buffer and pool types.
+// The pool functions are the HAL's (hal_audio.h), defined in sim_audio.cpp.
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_BUFFER_FORMAT_PCM_S16 1
+#define AUDIO_BUFFER_FORMAT_PCM_S8 2
+#define AUDIO_BUFFER_FORMAT_PCM_U16 3
+#define AUDIO_BUFFER_FORMAT_PCM_U8 4
+
+typedef struct mem_buffer
+{
+    size_t size;
+    uint8_t* bytes;
+    uint8_t flags;
+} mem_buffer_t;
+
+typedef struct audio_format
+{
+    uint32_t sample_freq;
+    uint16_t format;
+    uint16_t channel_count;
+} audio_format_t;
+
+typedef struct audio_buffer_format
+{
+    const audio_format_t* format;
+    uint16_t sample_stride;
+} audio_buffer_format_t;
+
+typedef struct audio_buffer
+{
+    mem_buffer_t* buffer;
+    const audio_buffer_format_t* format;
+    uint32_t sample_count;
+    uint32_t max_sample_count;
+    uint32_t user_data;
+    struct audio_buffer* next;
+} audio_buffer_t;
+
+typedef struct audio_buffer_pool audio_buffer_pool_t;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+// Host stand-in for pico/flash.h; there is no other core to park
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline bool flash_safe_execute_core_init(void)
+{
+    return true;
+}
+
+static inline int flash_safe_execute(void (*func)(void*), void* param, uint32_t enter_exit_timeout_ms)
+{
+    (void)enter_exit_timeout_ms;
+    func(param);
+    return PICO_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
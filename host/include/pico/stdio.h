@@ -0,0 +1,19 @@
+#pragma once
+// Host stand-in for pico/stdio.h. printf goes to the host's stdout; the USB
+// CDC input is fed by the simulator script.
+#include <stdio.h>
+
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+int stdio_put_string(const char* s, int len, bool newline, bool cr_translation);
+void stdio_set_chars_available_callback(void (*fn)(void*), void* param);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in for pico/stdlib.h
+#include "pico/stdio.h"
+#include "pico/time.h"
+#include "pico/types.h"
+
+static inline void tight_loop_contents(void)
+{
+}
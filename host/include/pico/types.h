@@ -0,0 +1,28 @@
+#pragma once
+// Host stand-in for the Pico SDK base types
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef PICO_ON_DEVICE
+#define PICO_ON_DEVICE 0
+#endif
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC (-1)
+#define PICO_ERROR_TIMEOUT (-1)
+
+#define PICO_DEFAULT_LED_PIN 25
+#define NUM_BANK0_GPIOS 48
+
+typedef unsigned int uint;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void panic(const char* fmt, ...) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
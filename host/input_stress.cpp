@@ -0,0 +1,182 @@
+// The input event ring (input_events.h) between two threads: one pushing as
+// the GPIO and button timer IRQs do, one draining as the main loop does.
+//
+//   input_stress [seconds]       per phase, 1 by default
+//
+// First in bursts, the way a fast spin with contact bounce arrives: up to the
+// ring's capacity back to back, then a pause, with the consumer waking late now
+// and then. Every event must arrive whole (its fields are a function of its
+// sequence number) and in order, and every sequence number missing at the
+// consumer must be one the producer saw refused, and the ring counted as an
+// overflow.
+// Then flat out, the producer retrying whenever the ring is full: nothing may
+// be lost at all, and the rate through the ring is reported. Build with
+// -fsanitize=thread to have the slot accesses checked for races as well.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include "input_events.h"
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<uint32_t> failures = 0;
+
+void fail(const char* what, uint32_t a, uint32_t b = 0)
+{
+    if (failures.fetch_add(1) < 10)
+    {
+        fprintf(stderr, "input_stress: %s (%u, %u)\n", what, a, b);
+    }
+}
+
+// time_us carries the sequence number; the rest follows from it
+vfo_input::InputEvent event_for(uint32_t seq)
+{
+    return { seq, vfo_input::InputEventType(seq % 6), uint8_t(seq * 3), int16_t(seq * 7) };
+}
+
+bool whole(const vfo_input::InputEvent& e)
+{
+    vfo_input::InputEvent expected = event_for(e.time_us);
+    return e.type == expected.type && e.source == expected.source && e.value == expected.value;
+}
+
+void spin(uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        asm volatile("");
+    }
+}
+
+struct Phase
+{
+    vfo_input::InputQueue queue;
+    std::atomic<uint32_t> last_seq = 0; // Set once the producer is done
+    uint32_t refused = 0; // Producer's own count of failed pushes, retries included
+    uint32_t dropped = 0; // Events given up on after a failed push
+    uint32_t received = 0;
+    uint32_t missing = 0; // Gaps in the sequence seen by the consumer
+};
+
+void producer(Phase& p, double seconds, bool retry)
+{
+    std::minstd_rand rng(1);
+    uint32_t seq = 0;
+    auto end = Clock::now() + std::chrono::duration<double>(seconds);
+    while (Clock::now() < end)
+    {
+        // A burst, then the quiet between detents; flat out has no quiet
+        uint32_t burst = retry ? 1024 : 1 + rng() % INPUT_QUEUE_LEN;
+        for (uint32_t i = 0; i < burst; i++)
+        {
+            seq++;
+            while (!p.queue.push(event_for(seq)))
+            {
+                p.refused++;
+                if (!retry)
+                {
+                    p.dropped++;
+                    break;
+                }
+                // Full: on a single CPU only the consumer running can change that
+                std::this_thread::yield();
+            }
+        }
+        if (!retry)
+        {
+            spin(rng() % 4096);
+            // The IRQs leave the core to the main loop between detents
+            std::this_thread::yield();
+        }
+    }
+    p.last_seq.store(seq);
+}
+
+void consumer(Phase& p, bool retry)
+{
+    std::minstd_rand rng(2);
+    uint32_t seen = 0;
+    for (;;)
+    {
+        uint32_t last = p.last_seq.load();
+        vfo_input::InputEvent e;
+        bool any = false;
+        while (p.queue.pop(e))
+        {
+            any = true;
+            p.received++;
+            if (!whole(e))
+            {
+                fail("torn event", e.time_us);
+            }
+            if (e.time_us <= seen)
+            {
+                fail("event out of order", e.time_us, seen);
+            }
+            p.missing += e.time_us - seen - 1;
+            seen = e.time_us;
+        }
+        if (last && !any && p.queue.empty())
+        {
+            // Whatever is missing at the end was refused too
+            p.missing += last - seen;
+            return;
+        }
+        // The main loop does a pass of its own between drains, and sometimes a display frame
+        if (!retry)
+        {
+            spin(rng() % 64 == 0 ? 200000 : rng() % 2048);
+        }
+        else if (!any)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void run(const char* name, double seconds, bool retry)
+{
+    static Phase phases[2];
+    Phase& p = phases[retry];
+    auto start = Clock::now();
+    std::thread drain(consumer, std::ref(p), retry);
+    std::thread fill(producer, std::ref(p), seconds, retry);
+    fill.join();
+    drain.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint32_t sent = p.last_seq.load();
+    printf("%-9s %9u events, %9u received, %8u pushes refused (%8u counted by the ring), %8u dropped, %8u missing; "
+           "%6.2f M events/s\n",
+        name, sent, p.received, p.refused, p.queue.overflow_count(), p.dropped, p.missing, p.received / elapsed / 1e6);
+    if (p.queue.overflow_count() != p.refused)
+    {
+        fail("overflows miscounted", p.queue.overflow_count(), p.refused);
+    }
+    if (p.missing != p.dropped || p.received + p.dropped != sent)
+    {
+        fail("events lost without an overflow", p.missing, p.dropped);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 1;
+    run("bursts", seconds, false);
+    run("flat out", seconds, true);
+
+    uint32_t failed = failures.load();
+    printf("%s\n", failed ? "FAIL" : "ok");
+    return failed ? 1 : 0;
+}
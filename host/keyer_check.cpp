@@ -0,0 +1,278 @@
+// The CW keyer (keyer.h) on a constant tone, timed from the samples it shapes.
+//
+//   keyer_check
+//
+// Marks and spaces are measured where the envelope crosses half scale, which
+// the symmetric raised-cosine ramps put on the key transitions, so lengths
+// come out to within a sample or two. Checks PARIS at several speeds (every
+// element and gap against the dit, 50 dits in all), the iambic modes (a
+// squeeze alternates; released inside an element, mode B sends one more and
+// mode A does not; a tap of the other paddle alone is remembered by both)
+// and the straight key following the paddle.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "keyer.h"
+
+namespace
+{
+
+#define CHECK_SAMPLE_RATE 44100
+#define CHECK_BLOCK 64 // Paddles are sampled once per block, as the audio fill does
+#define CHECK_TOLERANCE 2 // Samples either side of an edge
+#define CHECK_LEVEL 32767
+
+using vfo_audio::Keyer;
+using vfo_audio::KeyerMode;
+
+uint32_t failures = 0;
+
+void fail(const char* what, const std::string& detail)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "keyer_check: %s: %s\n", what, detail.c_str());
+    }
+}
+
+// Paddle closures, in samples from the start
+struct Closure
+{
+    bool dah;
+    uint32_t from;
+    uint32_t to;
+};
+
+struct Run
+{
+    bool mark;
+    uint32_t length;
+};
+
+struct Keyed
+{
+    std::vector<Run> runs; // From the start, ending on the last mark
+    uint32_t idle_at; // End of the block in which the keyer went idle
+};
+
+// Keys the tone until the keyer is idle and splits the output into marks and spaces
+Keyed key(Keyer& keyer, const std::vector<Closure>& closures, uint32_t min_samples = 0)
+{
+    Keyed keyed = {};
+    std::vector<Run>& runs = keyed.runs;
+    int16_t block[CHECK_BLOCK];
+    uint32_t t = 0;
+    bool mark = false;
+    uint32_t edge = 0;
+    uint32_t idle_blocks = 0;
+
+    while (idle_blocks < 2 || t < min_samples)
+    {
+        bool dit = false;
+        bool dah = false;
+        for (const Closure& c : closures)
+        {
+            if (t >= c.from && t < c.to)
+            {
+                (c.dah ? dah : dit) = true;
+            }
+        }
+        keyer.set_paddles(dit, dah);
+
+        for (int16_t& s : block)
+        {
+            s = CHECK_LEVEL;
+        }
+        keyer.process(block, CHECK_BLOCK);
+        for (uint32_t i = 0; i < CHECK_BLOCK; i++, t++)
+        {
+            bool above = block[i] >= CHECK_LEVEL / 2;
+            if (above != mark)
+            {
+                if (t > edge || mark)
+                {
+                    runs.push_back({ mark, t - edge });
+                }
+                mark = above;
+                edge = t;
+            }
+        }
+        if (keyer.busy())
+        {
+            idle_blocks = 0;
+        }
+        else if (idle_blocks++ == 0)
+        {
+            keyed.idle_at = t;
+        }
+    }
+    if (mark)
+    {
+        runs.push_back({ true, t - edge });
+    }
+    return keyed;
+}
+
+bool near(uint32_t length, uint32_t expected)
+{
+    return length + CHECK_TOLERANCE >= expected && length <= expected + CHECK_TOLERANCE;
+}
+
+// Marks as dots and dashes, gaps of a character as ' '; anything off the dit grid is '?'
+std::string elements(const std::vector<Run>& runs, uint32_t dit)
+{
+    std::string out;
+    for (const Run& r : runs)
+    {
+        if (r.mark)
+        {
+            out += near(r.length, dit) ? '.' : near(r.length, dit * 3) ? '-' : '?';
+        }
+        else if (!out.empty() && !near(r.length, dit))
+        {
+            out += near(r.length, dit * 3) || near(r.length, dit * 7) ? ' ' : '?';
+        }
+    }
+    return out;
+}
+
+void check_paris(uint32_t wpm)
+{
+    Keyer keyer;
+    keyer.init(CHECK_SAMPLE_RATE);
+    keyer.set_wpm(wpm);
+    uint32_t dit = keyer.dit_samples();
+    if (dit != CHECK_SAMPLE_RATE * 6 / (wpm * 5))
+    {
+        fail("dit length", std::to_string(wpm) + " wpm gives " + std::to_string(dit));
+    }
+
+    keyer.send("PARIS ");
+    Keyed keyed = key(keyer, {});
+    std::string sent = elements(keyed.runs, dit);
+    if (sent != ".--. .- .-. .. ...")
+    {
+        fail("PARIS", std::to_string(wpm) + " wpm sent \"" + sent + "\"");
+    }
+
+    // The first run is the space before the first mark's edge, as long as the
+    // ramp takes to reach half scale, which every later edge is late by too
+    uint32_t last_mark_end = 0;
+    for (const Run& r : keyed.runs)
+    {
+        last_mark_end += r.length;
+    }
+    last_mark_end -= keyed.runs.front().length;
+    if (!near(last_mark_end, 43 * dit))
+    {
+        fail("PARIS timing", std::to_string(wpm) + " wpm took " + std::to_string(last_mark_end) + " samples to the last mark");
+    }
+    // Then the word space, the last of the 50 dits
+    if (keyed.idle_at < 50 * dit || keyed.idle_at >= 50 * dit + CHECK_BLOCK)
+    {
+        fail("PARIS word space", std::to_string(wpm) + " wpm went idle at " + std::to_string(keyed.idle_at));
+    }
+    printf("PARIS at %2u wpm: dit %5u samples, %s, last mark ends at %.3f dits, idle at %.3f\n", wpm, dit,
+        sent.c_str(), double(last_mark_end) / dit, double(keyed.idle_at) / dit);
+}
+
+std::string run_paddles(KeyerMode mode, const std::vector<Closure>& closures)
+{
+    Keyer keyer;
+    keyer.init(CHECK_SAMPLE_RATE);
+    keyer.set_wpm(20);
+    keyer.set_mode(mode);
+    return elements(key(keyer, closures).runs, keyer.dit_samples());
+}
+
+void check_iambic()
+{
+    uint32_t dit = CHECK_SAMPLE_RATE * 6 / (20 * 5);
+    struct Case
+    {
+        const char* name;
+        std::vector<Closure> closures;
+        const char* mode_a;
+        const char* mode_b;
+    };
+    const Case cases[] = {
+        // Dit, space, then released halfway through the dah
+        { "squeeze released in the 2nd element", { { false, 0, dit * 7 / 2 }, { true, 0, dit * 7 / 2 } }, ".-", ".-." },
+        // Dit dah dit dah, released in the 4th element
+        { "squeeze released in the 4th element", { { false, 0, dit * 9 }, { true, 0, dit * 9 } }, ".-.-", ".-.-." },
+        // Held across the boundary by both: alternation goes on in either mode
+        { "squeeze held to the 3rd element", { { false, 0, dit * 13 / 2 }, { true, 0, dit * 13 / 2 } }, ".-.", ".-.-" },
+        // Dah squeezed first, so the alternate of the last release is a dah
+        { "squeeze from a dah", { { true, 0, dit * 2 }, { false, dit, dit * 2 } }, "-", "-." },
+        // Dit paddle released, then the dah paddle tapped alone inside the dit
+        { "tap of the other paddle", { { false, 0, dit / 2 }, { true, dit * 6 / 10, dit * 8 / 10 } }, ".-", ".-" },
+        { "dits held", { { false, 0, dit * 5 } }, "...", "..." },
+    };
+
+    for (const Case& c : cases)
+    {
+        std::string a = run_paddles(KeyerMode::IambicA, c.closures);
+        std::string b = run_paddles(KeyerMode::IambicB, c.closures);
+        if (a != c.mode_a)
+        {
+            fail(c.name, "mode A sent \"" + a + "\", not \"" + c.mode_a + "\"");
+        }
+        if (b != c.mode_b)
+        {
+            fail(c.name, "mode B sent \"" + b + "\", not \"" + c.mode_b + "\"");
+        }
+        printf("%-38s A \"%s\"  B \"%s\"\n", c.name, a.c_str(), b.c_str());
+    }
+}
+
+// The key follows the dit paddle; closures land on the block boundaries where it is read
+void check_straight()
+{
+    Keyer keyer;
+    keyer.init(CHECK_SAMPLE_RATE);
+    keyer.set_mode(KeyerMode::Straight);
+    const uint32_t lengths[] = { 10 * CHECK_BLOCK, 37 * CHECK_BLOCK, 200 * CHECK_BLOCK };
+    std::vector<Closure> closures;
+    uint32_t t = 0;
+    for (uint32_t length : lengths)
+    {
+        closures.push_back({ false, t, t + length });
+        t += length * 2;
+    }
+    uint32_t marks = 0;
+    for (const Run& r : key(keyer, closures, t).runs)
+    {
+        if (!r.mark)
+        {
+            continue;
+        }
+        if (marks >= 3 || !near(r.length, lengths[marks]))
+        {
+            fail("straight key", "mark " + std::to_string(marks) + " of " + std::to_string(r.length) + " samples");
+        }
+        marks++;
+    }
+    if (marks != 3)
+    {
+        fail("straight key", std::to_string(marks) + " marks");
+    }
+    printf("straight key: %u marks as long as the closures\n", marks);
+}
+
+} // namespace
+
+int main()
+{
+    const uint32_t speeds[] = { KEYER_MIN_WPM, 12, 20, 35, KEYER_MAX_WPM };
+    for (uint32_t wpm : speeds)
+    {
+        check_paris(wpm);
+    }
+    check_iambic();
+    check_straight();
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
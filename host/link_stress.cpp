@@ -0,0 +1,182 @@
+// The inter-core mailboxes (core_link.h) between two threads: one publishing
+// tune requests as the user interface on core 0 does, one taking them and
+// publishing its state as the radio loop on core 1 does.
+//
+//   link_stress [seconds]        2 by default
+//
+// Checks that every message arrives whole (its payload is a function of its
+// sequence number), that sequence numbers never go backwards, and that the
+// last message sent is always delivered. Reports how many were coalesced and
+// the publish-to-take latency. Build with -fsanitize=thread to have the slot
+// accesses checked for races as well.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "core_link.h"
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+vfo_link::Mailbox<vfo_link::TuneRequest> requests;
+vfo_link::Mailbox<vfo_link::RadioState> states;
+
+std::atomic<uint32_t> last_seq = 0; // Set once the UI thread has sent its last request
+std::atomic<uint32_t> failures = 0;
+Clock::time_point start;
+
+// time_us carries nanoseconds here, truncated like the device's 32-bit timer
+uint32_t now_ns()
+{
+    return uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+}
+
+uint32_t hz_for(uint32_t seq)
+{
+    return 1000000 + seq * 7;
+}
+
+void fail(const char* what, uint32_t seq)
+{
+    if (failures.fetch_add(1) < 10)
+    {
+        fprintf(stderr, "link_stress: %s at seq %u\n", what, seq);
+    }
+}
+
+// Short random pauses, so the two sides meet at every point of publish and take
+void pause(std::minstd_rand& rng)
+{
+    uint32_t spins = rng() % 512;
+    for (uint32_t i = 0; i < spins; i++)
+    {
+        asm volatile("");
+    }
+    if (rng() % 64 == 0)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void ui_thread(double seconds)
+{
+    std::minstd_rand rng(1);
+    uint32_t seq = 0;
+    uint32_t state_seq = 0;
+    auto end = Clock::now() + std::chrono::duration<double>(seconds);
+
+    while (Clock::now() < end)
+    {
+        seq++;
+        requests.publish({ seq, now_ns(), hz_for(seq), uint8_t(seq % vfo_band::bands.size()) });
+
+        vfo_link::RadioState s;
+        if (states.take(s))
+        {
+            if (s.hz != hz_for(s.request_seq) || s.band != s.request_seq % vfo_band::bands.size()
+                || s.audio_ok != (s.request_seq & 1))
+            {
+                fail("torn radio state", s.request_seq);
+            }
+            if (s.request_seq < state_seq || s.request_seq > seq)
+            {
+                fail("radio state out of order", s.request_seq);
+            }
+            state_seq = s.request_seq;
+        }
+        pause(rng);
+    }
+    last_seq.store(seq);
+
+    // The radio must end up reporting the last request
+    auto deadline = Clock::now() + std::chrono::seconds(1);
+    while (state_seq != seq && Clock::now() < deadline)
+    {
+        vfo_link::RadioState s;
+        if (states.take(s))
+        {
+            state_seq = s.request_seq;
+        }
+    }
+    if (state_seq != seq)
+    {
+        fail("last request never reported back", seq);
+    }
+}
+
+void radio_thread(std::vector<uint32_t>& latency_ns)
+{
+    std::minstd_rand rng(2);
+    uint32_t seen = 0;
+    auto deadline = Clock::time_point::max();
+
+    while (Clock::now() < deadline)
+    {
+        uint32_t last = last_seq.load();
+        if (last && deadline == Clock::time_point::max())
+        {
+            deadline = Clock::now() + std::chrono::seconds(1);
+        }
+        if (last && seen == last)
+        {
+            return;
+        }
+
+        vfo_link::TuneRequest r;
+        if (requests.take(r))
+        {
+            latency_ns.push_back(now_ns() - r.time_us);
+            if (r.hz != hz_for(r.seq) || r.band != r.seq % vfo_band::bands.size())
+            {
+                fail("torn tune request", r.seq);
+            }
+            if (r.seq <= seen)
+            {
+                fail("tune request out of order", r.seq);
+            }
+            seen = r.seq;
+            states.publish({ r.seq, r.hz, r.band, vfo_band::Mode::USB, bool(r.seq & 1) });
+        }
+        pause(rng);
+    }
+    fail("last request never taken", seen);
+}
+
+uint32_t percentile(const std::vector<uint32_t>& sorted, uint32_t p)
+{
+    return sorted.empty() ? 0 : sorted[std::min<size_t>(sorted.size() - 1, sorted.size() * p / 100)];
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 2;
+    std::vector<uint32_t> latency_ns;
+    latency_ns.reserve(1 << 20);
+
+    start = Clock::now();
+    std::thread radio(radio_thread, std::ref(latency_ns));
+    std::thread ui(ui_thread, seconds);
+    ui.join();
+    radio.join();
+
+    std::sort(latency_ns.begin(), latency_ns.end());
+    printf("requests: %u published, %u coalesced, %zu taken\n", requests.published(), requests.coalesced(),
+        latency_ns.size());
+    printf("states: %u published, %u coalesced\n", states.published(), states.coalesced());
+    printf("request latency ns: p50 %u p99 %u max %u\n", percentile(latency_ns, 50), percentile(latency_ns, 99),
+        latency_ns.empty() ? 0 : latency_ns.back());
+
+    uint32_t failed = failures.load();
+    printf("%s\n", failed ? "FAIL" : "ok");
+    return failed ? 1 : 0;
+}
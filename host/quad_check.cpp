@@ -0,0 +1,222 @@
+// The quadrature LO (VFO_QUADRATURE, synth.h) against the simulator's Si5351
+// model, which follows the registers of CLK0 and CLK1, their phase offsets
+// and the PLL resets.
+//
+//   quad_check [steps]             retunes per band, 200 by default
+//
+// For every band: select it at the bottom edge, then retune across it. Checks
+// that CLK0 and CLK1 sit on the requested frequency within the PLL's
+// fractional resolution, that CLK1 is 90 degrees behind CLK0 throughout,
+// that the VCO stays inside the plan's limits, and that a retune is a single
+// PLLA burst with no PLL reset, while a band change takes exactly one. Bands
+// with no quadrature pair must keep CLK1 off. A sweep (which powers CLK1 down)
+// and the band change back are tried too. Then the divider rule is checked
+// for every 100 kHz from 3 to 30 MHz: a pair from 4.8 MHz up, with the VCO
+// inside the datasheet's 600-900 MHz, and none below.
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "sim.h"
+
+#include "band_plan.h"
+#include "synth.h"
+
+extern "C" {
+#include "si5351/si5351.h"
+}
+
+static_assert(VFO_QUADRATURE, "quad_check is built with VFO_QUADRATURE=1");
+
+namespace vfo_sim
+{
+void finish(int code)
+{
+    exit(code);
+}
+} // namespace vfo_sim
+
+namespace
+{
+
+#define CHECK_I2C_HZ 48000 // As the firmware runs the bus
+#define CHECK_PHASE_TOLERANCE_DEG 1e-6
+#define CHECK_MIN_HZ 3000000
+#define CHECK_MAX_HZ 30000000
+
+uint32_t failures = 0;
+
+void fail(const char* fmt, uint32_t a, double b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "quad_check: ");
+        fprintf(stderr, fmt, a, b);
+        fputc('\n', stderr);
+    }
+}
+
+// The PLL feedback fraction has a denominator of RFRAC_DENOM and is rounded down
+double resolution_hz(uint32_t divider)
+{
+    return SIM_XTAL_HZ / (double(RFRAC_DENOM) * divider) + 1e-3;
+}
+
+// Returns the frequency error
+double check_pair(const vfo_band::Band& band, uint32_t hz)
+{
+    vfo_sim::ClockPair pair = vfo_sim::clock_pair();
+    double error = std::fabs(pair.clk0_hz - hz);
+    if (!band.quad_divider)
+    {
+        if (pair.clk1_hz != 0)
+        {
+            fail("CLK1 on at %u Hz, with no quadrature pair", hz);
+        }
+        return error;
+    }
+
+    if (error > resolution_hz(band.quad_divider))
+    {
+        fail("CLK0 at %u Hz is off by %.3f Hz", hz, error);
+    }
+    if (pair.clk1_hz != pair.clk0_hz)
+    {
+        fail("CLK1 at %u Hz is %.3f Hz", hz, pair.clk1_hz);
+    }
+    if (std::isnan(pair.clk1_lag_deg) || std::fabs(pair.clk1_lag_deg - 90) > CHECK_PHASE_TOLERANCE_DEG)
+    {
+        fail("CLK1 at %u Hz lags by %.6f degrees", hz, pair.clk1_lag_deg);
+    }
+    if (pair.vco_hz < BAND_VCO_MIN - 1 || pair.vco_hz > BAND_VCO_MAX + 1)
+    {
+        fail("VCO at %u Hz is %.0f Hz", hz, pair.vco_hz);
+    }
+    return error;
+}
+
+void run_band(uint32_t index, uint32_t steps)
+{
+    const vfo_band::Band& band = vfo_band::bands[index];
+
+    vfo_sim::SimStats before = vfo_sim::stats();
+    vfo_synth::select_band(index, band.low_hz);
+    uint32_t band_resets = vfo_sim::stats().pll_resets - before.pll_resets;
+    if (band_resets != 1)
+    {
+        fail("band from %u Hz took %.0f PLL resets", band.low_hz, band_resets);
+    }
+    double worst = check_pair(band, band.low_hz);
+
+    // Evenly across the band, ending on the top edge
+    uint64_t retune_bytes = 0;
+    before = vfo_sim::stats();
+    for (uint32_t i = 1; i <= steps; i++)
+    {
+        uint32_t hz = band.low_hz + uint32_t(uint64_t(band.high_hz - band.low_hz) * i / steps);
+        uint64_t bytes = vfo_sim::stats().i2c_bytes;
+        vfo_synth::set_frequency(hz);
+        bytes = vfo_sim::stats().i2c_bytes - bytes;
+        if (retune_bytes && bytes != retune_bytes)
+        {
+            fail("retune to %u Hz took %.0f bytes", hz, double(bytes));
+        }
+        retune_bytes = bytes;
+        worst = std::max(worst, check_pair(band, hz));
+    }
+    uint32_t retune_resets = vfo_sim::stats().pll_resets - before.pll_resets;
+    if (retune_resets)
+    {
+        fail("%u PLL resets while tuning from %.0f Hz", retune_resets, band.low_hz);
+    }
+    // Register address and the eight PLLA parameters, plus the bus address
+    if (retune_bytes != 1 + 1 + SI5351_PARAMETERS_LENGTH)
+    {
+        fail("retune from %u Hz took %.0f bytes", band.low_hz, double(retune_bytes));
+    }
+
+    uint32_t divider = band.quad_divider ? band.quad_divider : band.ms_divider;
+    printf("%-10s %8u-%8u Hz  divider %3u  VCO %3u-%3u MHz  %s  worst error %.3f Hz, %u bytes per retune\n",
+        band.name, band.low_hz, band.high_hz, divider, uint32_t(uint64_t(band.low_hz) * divider / 1000000),
+        uint32_t(uint64_t(band.high_hz) * divider / 1000000), band.quad_divider ? "I/Q " : "I   ", worst,
+        uint32_t(retune_bytes));
+}
+
+// A sweep moves PLLA under CLK1, so it goes off; the band change back restores the pair
+void run_sweep(uint32_t index)
+{
+    const vfo_band::Band& band = vfo_band::bands[index];
+    uint8_t point[SYNTH_POINT_LEN];
+    vfo_synth::pack_sweep_point(10000000, point);
+    vfo_synth::start_sweep(point);
+    if (vfo_sim::clock_pair().clk1_hz != 0)
+    {
+        fail("CLK1 on during a sweep from band %u", index);
+    }
+    vfo_synth::select_band(index, band.default_hz);
+    check_pair(band, band.default_hz);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t steps = argc > 1 ? uint32_t(atoi(argv[1])) : 200;
+    if (steps == 0)
+    {
+        fprintf(stderr, "usage: quad_check [steps]\n");
+        return 2;
+    }
+
+    vfo_sim::set_log_enabled(false);
+    vfo_sim::attach_devices(0);
+
+    hal_i2c_init(0, CHECK_I2C_HZ, 0, 1);
+    if (!si5351_init(SIM_SI5351_ADDRESS, SI5351_CRYSTAL_LOAD_8PF, SIM_XTAL_HZ, 0))
+    {
+        fprintf(stderr, "quad_check: no Si5351\n");
+        return 1;
+    }
+    vfo_synth::init_synth();
+    si5351_output_enable(SI5351_CLK0, 1);
+    si5351_output_enable(SI5351_CLK1, 1);
+
+    for (uint32_t i = 0; i < vfo_band::bands.size(); i++)
+    {
+        run_band(i, steps);
+    }
+    for (uint32_t i = 0; i < vfo_band::bands.size(); i++)
+    {
+        run_sweep(i);
+    }
+
+    // The divider rule itself, as if every 100 kHz were the edge of a band: a
+    // pair wherever an even divider up to 126 keeps the VCO in range, none below
+    uint32_t lowest = 0;
+    for (uint32_t hz = CHECK_MIN_HZ; hz <= CHECK_MAX_HZ; hz += 100000)
+    {
+        uint32_t divider = vfo_band::quadrature_divider(hz, hz);
+        uint64_t vco = uint64_t(hz) * divider;
+        bool reachable = uint64_t(hz) * BAND_QUAD_DIVIDER_MAX >= BAND_VCO_MIN;
+        if (!reachable)
+        {
+            if (divider)
+            {
+                fail("%u Hz given divider %.0f, under the VCO minimum", hz, divider);
+            }
+            continue;
+        }
+        if (!divider || divider & 1 || divider > BAND_QUAD_DIVIDER_MAX || vco < BAND_VCO_MIN || vco > BAND_VCO_MAX)
+        {
+            fail("no quadrature divider for %u Hz (%.0f)", hz, divider);
+        }
+        else if (!lowest)
+        {
+            lowest = hz;
+        }
+    }
+    printf("quadrature divider for every 100 kHz from %u Hz to %u Hz, none below\n", lowest, CHECK_MAX_HZ);
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
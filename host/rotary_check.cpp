@@ -0,0 +1,240 @@
+// The table-driven encoder decoder (rotary_decoder.h) on noisy edge sequences.
+//
+//   rotary_check
+//
+// Edge sequences as the GPIO IRQ sees them, one pins word per call. Clean
+// turns must give one step per detent (two in half-step mode) in the right
+// direction. Contact bounce, repeated reads of the same code and turns
+// reversed part way through a detent must not change that. Invalid
+// transitions, both pins changing between two reads, may cost a detent but
+// must never add one, nor in full-step mode step the wrong way. Two encoders on one pins word,
+// each with its own decoder, must not see each other's edges.
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "rotary_decoder.h"
+
+namespace
+{
+
+#define CHECK_PIN_A 4 // As main.cpp wires it: A is DT, B is CLK
+#define CHECK_PIN_B 3
+#define CHECK_DETENTS 2000
+
+uint32_t failures = 0;
+
+void fail(const char* what, long a, long b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "rotary_check: %s (%ld, %ld)\n", what, a, b);
+    }
+}
+
+uint32_t noise = 1;
+
+uint32_t random(uint32_t range)
+{
+    noise = noise * 1664525u + 1013904223u;
+    return (noise >> 8) % range;
+}
+
+// Codes (B << 1 | A) a detent goes through, from and back to 11
+const uint8_t clockwise[] = { 1, 0, 2, 3 };
+const uint8_t counterclockwise[] = { 2, 0, 1, 3 };
+
+struct Sequence
+{
+    std::vector<uint8_t> codes;
+    uint8_t code = 3;
+    int32_t detents = 0; // Net, clockwise positive
+    int32_t half_detents = 0; // Stable states at 00 or 11 passed, net
+
+    void add(uint8_t c)
+    {
+        code = c;
+        codes.push_back(c);
+    }
+
+    // The moving contact chatters between the old and new code first
+    void edge(uint8_t next, uint32_t bounces)
+    {
+        uint8_t old = code;
+        for (uint32_t i = 0; i < bounces; i++)
+        {
+            add(next);
+            add(old);
+        }
+        add(next);
+    }
+
+    // Given abandon_at edges (fewer than four), turns back to where it started
+    void detent(bool cw, uint32_t max_bounces, uint32_t abandon_at = 4)
+    {
+        const uint8_t* path = cw ? clockwise : counterclockwise;
+        uint8_t start = code;
+        uint32_t edges = abandon_at < 4 ? abandon_at : 4;
+        for (uint32_t i = 0; i < edges; i++)
+        {
+            edge(path[i], random(max_bounces + 1));
+            if (random(4) == 0)
+            {
+                add(code); // The other pin's IRQ reads the same code again
+            }
+        }
+        if (abandon_at < 4)
+        {
+            for (uint32_t i = edges; i-- > 0;)
+            {
+                edge(i ? path[i - 1] : start, random(max_bounces + 1));
+            }
+            return;
+        }
+        detents += cw ? 1 : -1;
+        half_detents += cw ? 2 : -2;
+    }
+};
+
+uint32_t pins_for(uint8_t code, uint32_t pin_a, uint32_t pin_b)
+{
+    return uint32_t(code & 1) << pin_a | uint32_t(code >> 1) << pin_b;
+}
+
+struct Count
+{
+    int32_t cw;
+    int32_t ccw;
+};
+
+Count decode(vfo_input::RotaryDecoder& decoder, const std::vector<uint8_t>& codes)
+{
+    Count c = {};
+    for (uint8_t code : codes)
+    {
+        int8_t step = decoder.process(pins_for(code, CHECK_PIN_A, CHECK_PIN_B));
+        c.cw += step > 0;
+        c.ccw += step < 0;
+    }
+    return c;
+}
+
+void check_exact(const char* name, uint32_t max_bounces, bool abandon)
+{
+    noise = 7;
+    Sequence s;
+    for (uint32_t i = 0; i < CHECK_DETENTS; i++)
+    {
+        bool cw = (i / 50) % 3 != 1; // Runs one way, then back
+        s.detent(cw, max_bounces, abandon && random(5) == 0 ? 1 + random(3) : 4);
+    }
+
+    vfo_input::RotaryDecoder full(CHECK_PIN_A, CHECK_PIN_B);
+    vfo_input::RotaryDecoder half(CHECK_PIN_A, CHECK_PIN_B, true);
+    Count f = decode(full, s.codes);
+    Count h = decode(half, s.codes);
+    printf("%-28s %6zu reads: full %+5d (%+5d expected), half %+5d (%+5d)\n", name, s.codes.size(), f.cw - f.ccw,
+        s.detents, h.cw - h.ccw, s.half_detents);
+    if (f.cw - f.ccw != s.detents)
+    {
+        fail("full-step count", f.cw - f.ccw, s.detents);
+    }
+    if (h.cw - h.ccw != s.half_detents)
+    {
+        fail("half-step count", h.cw - h.ccw, s.half_detents);
+    }
+}
+
+// Clockwise only, with invalid jumps thrown in anywhere: a spike on both pins
+// and back, or a read missed altogether. Full step must give no
+// counterclockwise step, never more than the detents turned, and lose at most
+// one to each fault. Half step commits at every stable state, so a fault that
+// leaves what reads as a valid half step back costs that step too: at most one
+// wrong step per fault, and never more than the net turned.
+void check_invalid()
+{
+    noise = 11;
+    Sequence s;
+    for (uint32_t i = 0; i < CHECK_DETENTS; i++)
+    {
+        s.detent(true, 2);
+    }
+    std::vector<uint8_t> codes;
+    uint32_t spikes = 0, missed = 0;
+    for (uint8_t code : s.codes)
+    {
+        if (random(30) == 0)
+        {
+            missed++;
+            continue;
+        }
+        codes.push_back(code);
+        if (random(20) == 0)
+        {
+            codes.push_back(uint8_t(code ^ 3));
+            codes.push_back(code);
+            spikes++;
+        }
+    }
+
+    vfo_input::RotaryDecoder full(CHECK_PIN_A, CHECK_PIN_B);
+    vfo_input::RotaryDecoder half(CHECK_PIN_A, CHECK_PIN_B, true);
+    Count f = decode(full, codes);
+    Count h = decode(half, codes);
+    printf("%u spikes, %u missed reads in %d detents: full %d cw %d ccw, half %d cw %d ccw\n", spikes, missed,
+        s.detents, f.cw, f.ccw, h.cw, h.ccw);
+    int32_t faults = int32_t(spikes + missed);
+    if (f.ccw || f.cw > s.detents || h.ccw > faults || h.cw - h.ccw > s.half_detents)
+    {
+        fail("steps from invalid transitions", f.ccw, h.ccw);
+    }
+    if (f.cw < s.detents - faults || h.cw - h.ccw < s.half_detents - faults * 2)
+    {
+        fail("detents lost", f.cw, h.cw - h.ccw);
+    }
+}
+
+// Encoders on GPIOs 3/4 and 10/11, edges interleaved in one pins word
+void check_two_encoders()
+{
+    noise = 13;
+    Sequence a, b;
+    for (uint32_t i = 0; i < CHECK_DETENTS / 4; i++)
+    {
+        a.detent(true, 2);
+        b.detent(i % 2, 2);
+    }
+    vfo_input::RotaryDecoder first(CHECK_PIN_A, CHECK_PIN_B);
+    vfo_input::RotaryDecoder second(10, 11);
+    int32_t first_steps = 0, second_steps = 0;
+    size_t i = 0, j = 0;
+    uint8_t code_a = 3, code_b = 3;
+    while (i < a.codes.size() || j < b.codes.size())
+    {
+        // Whichever pin moved, both decoders see the whole word, as a shared callback would
+        bool take_a = j >= b.codes.size() || (i < a.codes.size() && random(2));
+        (take_a ? code_a : code_b) = take_a ? a.codes[i++] : b.codes[j++];
+        uint32_t pins = pins_for(code_a, CHECK_PIN_A, CHECK_PIN_B) | pins_for(code_b, 10, 11);
+        first_steps += first.process(pins);
+        second_steps += second.process(pins);
+    }
+    printf("two encoders: %+d (%+d expected) and %+d (%+d)\n", first_steps, a.detents, second_steps, b.detents);
+    if (first_steps != a.detents || second_steps != b.detents)
+    {
+        fail("two encoders", first_steps, second_steps);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    check_exact("clean", 0, false);
+    check_exact("bouncing", 4, false);
+    check_exact("bouncing, turned back", 4, true);
+    check_invalid();
+    check_two_encoders();
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,353 @@
+// The band-scope (spectrum.h) and the FFT under it (fft.h), down to the pixels
+// on the simulator's SSD1306.
+//
+//   scope_check
+//
+// The FFT against a DFT in double precision, at several sizes. Column levels
+// for complex tones across the band: each must land in the column holding its
+// bin, at the level its power maps to, with the columns away from it near the
+// bottom. Then the strip itself, pixel for pixel: render_spectrum() into a
+// frame buffer for several page ranges, every pixel inside the range against
+// the column height its level gives and every byte outside untouched; and
+// draw_spectrum_strip() as main.cpp calls it, read back from the panel. Last
+// the waterfall, scrolled by the panel's start line past a full screen of rows:
+// after every row the screen must show the newest at the top and the ones
+// before it in order below, each dithered from its own levels, for no more
+// than one page over the bus.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "sim.h"
+
+#include "fft.h"
+#include "spectrum.h"
+
+#include "pico-ssd1306/ssd1306.h"
+
+namespace vfo_sim
+{
+void finish(int code)
+{
+    exit(code);
+}
+} // namespace vfo_sim
+
+namespace
+{
+
+#define CHECK_I2C_HZ 48000 // As the firmware runs the bus
+#define CHECK_TONE_LEVEL 0.9 // Of full scale
+#define CHECK_LEVEL_TOLERANCE 3 // Of 255, for the table-driven log
+#define CHECK_AWAY_COLUMNS 3 // Columns either side of a tone left out of the floor check
+#define CHECK_FLOOR_LEVEL 80 // Below this away from the tone: 41 dB down
+#define CHECK_WATERFALL_ROWS 150 // Past two full screens, so the start line wraps
+
+uint32_t failures = 0;
+
+void fail(const char* what, double a, double b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "scope_check: %s (%.3f, %.3f)\n", what, a, b);
+    }
+}
+
+template <uint32_t N>
+void check_fft(double max_error_bound, double snr_bound)
+{
+    int16_t re[N];
+    int16_t im[N];
+    std::vector<double> x_re(N), x_im(N);
+    uint32_t noise = 7;
+    for (uint32_t n = 0; n < N; n++)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        re[n] = int16_t(int32_t(noise >> 16) - 32768) / 2;
+        noise = noise * 1664525u + 1013904223u;
+        im[n] = int16_t(int32_t(noise >> 16) - 32768) / 2;
+        x_re[n] = re[n];
+        x_im[n] = im[n];
+    }
+    vfo_dsp::Fft<N>::forward(re, im);
+
+    // Scaled by 1/N, as each stage halves
+    double max_error = 0, signal = 0, error = 0;
+    for (uint32_t k = 0; k < N; k++)
+    {
+        double sum_re = 0, sum_im = 0;
+        for (uint32_t n = 0; n < N; n++)
+        {
+            double a = -2 * M_PI * double(uint64_t(k) * n % N) / N;
+            sum_re += x_re[n] * std::cos(a) - x_im[n] * std::sin(a);
+            sum_im += x_re[n] * std::sin(a) + x_im[n] * std::cos(a);
+        }
+        sum_re /= N;
+        sum_im /= N;
+        double e = std::hypot(re[k] - sum_re, im[k] - sum_im);
+        max_error = std::max(max_error, e);
+        signal += sum_re * sum_re + sum_im * sum_im;
+        error += e * e;
+    }
+    double snr = 10 * std::log10(signal / std::max(error, 1e-12));
+    printf("fft %4u: max error %5.2f LSB  SNR %5.1f dB\n", N, max_error, snr);
+    if (max_error > max_error_bound)
+    {
+        fail("FFT error, LSB", N, max_error);
+    }
+    if (snr < snr_bound)
+    {
+        fail("FFT SNR, dB", N, snr);
+    }
+}
+
+// A complex tone on bin k (negative below DC) of SCOPE_FFT_SIZE, or between two
+void tone(double k, int16_t* iq)
+{
+    double a = CHECK_TONE_LEVEL * 32767;
+    for (uint32_t n = 0; n < SCOPE_FFT_SIZE; n++)
+    {
+        double phase = 2 * M_PI * k * double(n) / SCOPE_FFT_SIZE;
+        iq[n * 2] = int16_t(std::lround(a * std::cos(phase)));
+        iq[n * 2 + 1] = int16_t(std::lround(a * std::sin(phase)));
+    }
+}
+
+void check_levels()
+{
+    // The Hann window's coherent gain is a half, and the FFT scales by 1/N, so
+    // the bin holds a quarter of the tone's power; full scale power is 2^30
+    double amplitude = CHECK_TONE_LEVEL * 32767 / 2;
+    double db = 10 * std::log10(amplitude * amplitude / double(1u << 30));
+    int32_t expected = std::clamp(int32_t(std::lround(255 * (db + SCOPE_RANGE_DB) / SCOPE_RANGE_DB)), 0, 255);
+
+    // Halfway between bins the window's leakage reaches furthest, and the peak
+    // is down by its scalloping loss, so only the column and the floor are checked
+    const double bins[] = { -128, -97, -40, -1, 0, 1, 2, 33, 64, 127, -70.5, 20.5 };
+    int16_t iq[SCOPE_FFT_SIZE * 2];
+    uint8_t levels[SCOPE_WIDTH];
+    for (double k : bins)
+    {
+        tone(k, iq);
+        vfo_scope::compute_levels(iq, levels);
+
+        // DC in the middle, negative frequencies to the left
+        uint32_t bins_per_column = SCOPE_FFT_SIZE / SCOPE_WIDTH;
+        int32_t column = int32_t(std::floor(k + SCOPE_FFT_SIZE / 2)) / int32_t(bins_per_column);
+        bool on_bin = k == std::floor(k);
+        uint32_t peak = uint32_t(std::max_element(levels, levels + SCOPE_WIDTH) - levels);
+        uint8_t floor = 0;
+        for (int32_t x = 0; x < SCOPE_WIDTH; x++)
+        {
+            // The spectrum wraps: the top bin sits next to the bottom one
+            int32_t distance = std::abs(x - column);
+            if (std::min(distance, SCOPE_WIDTH - distance) > CHECK_AWAY_COLUMNS)
+            {
+                floor = std::max(floor, levels[x]);
+            }
+        }
+        printf("bin %6.1f: column %3u level %3u (expected %3d at %3d), %3u elsewhere\n", k, peak, levels[peak],
+            on_bin ? expected : levels[column], column, floor);
+        if (int32_t(peak) != column)
+        {
+            fail("tone in the wrong column", k, peak);
+        }
+        if (on_bin && std::abs(levels[column] - expected) > CHECK_LEVEL_TOLERANCE)
+        {
+            fail("tone level", k, levels[column]);
+        }
+        if (floor >= CHECK_FLOOR_LEVEL)
+        {
+            fail("level away from the tone", k, floor);
+        }
+    }
+}
+
+// Lit rows counted up from the bottom of the strip, independently of render_spectrum()
+bool expected_pixel(uint8_t level, uint32_t row, uint32_t height)
+{
+    uint32_t lit = uint32_t(std::ceil(level * double(height) / 256));
+    return row >= height - lit;
+}
+
+// Every level, then a ramp the other way, so all of them land on every page height
+void test_levels(uint8_t* levels, uint32_t seed)
+{
+    for (uint32_t x = 0; x < SCOPE_WIDTH; x++)
+    {
+        levels[x] = uint8_t((x * 2 + seed) * (seed & 1 ? 1 : 255));
+    }
+}
+
+void check_render()
+{
+    struct Range
+    {
+        uint32_t first_page;
+        uint32_t pages;
+    };
+    const Range ranges[] = { { 7, 1 }, { 0, 8 }, { 2, 3 }, { 4, 4 }, { 0, 1 } };
+    uint8_t levels[SCOPE_WIDTH];
+    uint8_t fb[SCOPE_WIDTH * 8];
+
+    for (const Range& r : ranges)
+    {
+        uint32_t wrong = 0;
+        for (uint32_t seed = 0; seed < 4; seed++)
+        {
+            test_levels(levels, seed);
+            memset(fb, 0xA5, sizeof(fb));
+            vfo_scope::render_spectrum(fb, r.first_page, r.pages, levels);
+
+            uint32_t height = r.pages * 8;
+            for (uint32_t page = 0; page < 8; page++)
+            {
+                bool inside = page >= r.first_page && page < r.first_page + r.pages;
+                for (uint32_t x = 0; x < SCOPE_WIDTH; x++)
+                {
+                    uint8_t expected = 0xA5;
+                    if (inside)
+                    {
+                        expected = 0;
+                        for (uint32_t bit = 0; bit < 8; bit++)
+                        {
+                            uint32_t row = (page - r.first_page) * 8 + bit;
+                            expected |= uint8_t(expected_pixel(levels[x], row, height)) << bit;
+                        }
+                    }
+                    if (fb[page * SCOPE_WIDTH + x] != expected)
+                    {
+                        wrong++;
+                    }
+                }
+            }
+        }
+        printf("render pages %u-%u: %u bytes wrong\n", r.first_page, r.first_page + r.pages - 1, wrong);
+        if (wrong)
+        {
+            fail("render", r.first_page, wrong);
+        }
+    }
+}
+
+// As main.cpp draws it: the bottom page, sent on its own
+void check_strip()
+{
+    vfo_sim::attach_devices(0);
+    hal_i2c_init(0, CHECK_I2C_HZ, 0, 1);
+    pico_ssd1306::SSD1306 display(0, SIM_DISPLAY_ADDRESS, pico_ssd1306::Size::W128xH64);
+    // The first full frame turns the panel on, as the main screen's does
+    display.sendBuffer();
+
+    int16_t iq[SCOPE_FFT_SIZE * 2];
+    uint8_t levels[SCOPE_WIDTH];
+    uint32_t wrong = 0;
+    const double bins[] = { -50, 3.5, 90 };
+    for (double k : bins)
+    {
+        tone(k, iq);
+        vfo_scope::compute_levels(iq, levels);
+        vfo_scope::draw_spectrum_strip(display, iq, 7, 1);
+
+        for (uint32_t y = 0; y < 64; y++)
+        {
+            for (uint32_t x = 0; x < SCOPE_WIDTH; x++)
+            {
+                bool expected = y >= 56 && expected_pixel(levels[x], y - 56, 8);
+                wrong += vfo_sim::display_pixel(x, y) != expected;
+            }
+        }
+    }
+    vfo_scope::ScopeStats stats = vfo_scope::get_scope_stats();
+    printf("strip on the panel: %u pixels wrong over %u frames\n", wrong, stats.frames);
+    if (wrong || stats.frames != 3)
+    {
+        fail("strip on the panel", wrong, stats.frames);
+    }
+}
+
+// The waterfall's 4x4 ordered dither, by display RAM row and column
+bool expected_dot(uint8_t level, uint32_t ram_row, uint32_t x)
+{
+    static const uint8_t thresholds[4][4] = {
+        { 0, 8, 2, 10 },
+        { 12, 4, 14, 6 },
+        { 3, 11, 1, 9 },
+        { 15, 7, 13, 5 }
+    };
+    return level > thresholds[ram_row % 4][x % 4] * 16 + 8;
+}
+
+// As main.cpp shows it: a blank screen, then one row per frame
+void check_waterfall()
+{
+    vfo_sim::attach_devices(0);
+    hal_i2c_init(0, CHECK_I2C_HZ, 0, 1);
+    pico_ssd1306::SSD1306 display(0, SIM_DISPLAY_ADDRESS, pico_ssd1306::Size::W128xH64);
+    display.clear();
+    display.sendBuffer();
+
+    vfo_scope::Waterfall waterfall;
+    std::vector<std::vector<uint8_t>> rows; // Newest last
+    int16_t iq[SCOPE_FFT_SIZE * 2];
+    uint32_t wrong = 0;
+    uint64_t max_bytes = 0;
+    for (uint32_t n = 0; n < CHECK_WATERFALL_ROWS; n++)
+    {
+        // A tone drifting across the band, so no two rows look alike
+        tone(double(n * 7 % SCOPE_FFT_SIZE) - SCOPE_FFT_SIZE / 2 + 0.25, iq);
+        std::vector<uint8_t> levels(SCOPE_WIDTH);
+        vfo_scope::compute_levels(iq, levels.data());
+        rows.push_back(levels);
+
+        uint64_t bytes = vfo_sim::stats().i2c_bytes;
+        vfo_scope::draw_waterfall(display, waterfall, iq);
+        max_bytes = std::max(max_bytes, vfo_sim::stats().i2c_bytes - bytes);
+
+        // Row y shows the row drawn y frames ago, which went into RAM row -(n + 1 - y)
+        for (uint32_t y = 0; y < SCOPE_PAGES * 8; y++)
+        {
+            uint32_t ram_row = (SCOPE_PAGES * 8 * CHECK_WATERFALL_ROWS - (n + 1) + y) % (SCOPE_PAGES * 8);
+            for (uint32_t x = 0; x < SCOPE_WIDTH; x++)
+            {
+                bool expected = y <= n && expected_dot(rows[n - y][x], ram_row, x);
+                wrong += vfo_sim::display_pixel(x, y) != expected;
+            }
+        }
+    }
+    printf("waterfall on the panel: %u pixels wrong over %u rows, %llu bytes a row at most\n", wrong,
+        CHECK_WATERFALL_ROWS, (unsigned long long)max_bytes);
+    if (wrong)
+    {
+        fail("waterfall on the panel", wrong);
+    }
+    // A page of data and its addressing, against a full frame's eight
+    if (max_bytes > (SCOPE_WIDTH + 1) * 2)
+    {
+        fail("bus bytes per waterfall row", double(max_bytes));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    vfo_sim::set_log_enabled(false);
+
+    // Each stage truncates after halving, so the error grows with the stages
+    // while the output, scaled by 1/N, shrinks as 1/sqrt(N) on noise
+    check_fft<64>(6, 59);
+    check_fft<256>(6, 54);
+    check_fft<1024>(8, 48);
+
+    check_levels();
+    check_render();
+    check_strip();
+    check_waterfall();
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,352 @@
+// The settings log (settings.h) on the simulator's flash image, with the power
+// cut at every flash operation it makes.
+//
+//   settings_check
+//
+// A scripted workload of set() and service() runs from blank flash, long
+// enough for several sector rotations and spare erases. It is run once to
+// count its flash operations, then again for each of them with the power going
+// part way through that one, from no bytes done to all of them, and at points
+// inside a record. init_settings() afterwards must give every key
+// its last committed value or the one being written when the power went, never
+// anything else, and the store must go on committing. Then the memory channel
+// calls, the store rotating with the audio never silent, and the time
+// init_settings() takes on the host to recover an active sector holding more
+// and more records.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "sim.h"
+
+#include "settings.h"
+
+#include "hardware/flash.h"
+
+namespace vfo_sim
+{
+void finish(int code)
+{
+    exit(code);
+}
+} // namespace vfo_sim
+
+namespace
+{
+
+#define CHECK_STEPS 600 // Workload commits: enough to go round the sectors twice
+#define CHECK_RECOVERIES 2000 // init_settings() calls timed per fill level
+
+using Values = std::map<uint16_t, uint32_t>;
+
+uint32_t failures = 0;
+
+void fail(const char* what, uint32_t a, uint32_t b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "settings_check: %s (%u, %u)\n", what, a, b);
+    }
+}
+
+void blank_flash()
+{
+    memset(sim_flash, 0xFF, sizeof(sim_flash));
+}
+
+void idle()
+{
+    vfo_sim::advance_to(vfo_sim::now_us() + SETTINGS_IDLE_US);
+}
+
+// The keys the firmware uses, a band's worth of frequencies and the channels
+uint16_t workload_key(uint32_t n)
+{
+    static const uint16_t keys[] = { vfo_settings::KEY_FREQUENCY, vfo_settings::KEY_STEP_POWER, vfo_settings::KEY_BAND,
+        vfo_settings::KEY_CORRECTION };
+    uint32_t pick = n % 24;
+    if (pick < 4)
+    {
+        return keys[pick];
+    }
+    if (pick < 12)
+    {
+        return uint16_t(vfo_settings::KEY_BAND_FREQUENCY + pick - 4);
+    }
+    return uint16_t(vfo_settings::KEY_CHANNEL + pick - 12);
+}
+
+// What a run has committed, and what its last service() call was writing
+struct Model
+{
+    Values committed;
+    Values cache;
+    uint32_t commits;
+};
+
+// Steps of one to five sets, then an idle service; every fourth one may not
+// erase, so some spare erases wait for a later step
+void run_workload(Model& model)
+{
+    uint32_t noise = 1;
+    for (uint32_t step = 0; step < CHECK_STEPS; step++)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        for (uint32_t i = 0; i <= (noise >> 29) % 5; i++)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            uint16_t key = workload_key(noise >> 8);
+            uint32_t value = 7000000 + (noise >> 12);
+            vfo_settings::set(key, value);
+            model.cache[key] = value;
+        }
+        idle();
+        vfo_settings::service(step % 4 != 3);
+        uint32_t commits = vfo_settings::get_settings_stats().commits;
+        if (commits != model.commits)
+        {
+            model.commits = commits;
+            model.committed = model.cache;
+        }
+    }
+}
+
+uint32_t flash_operations()
+{
+    return vfo_sim::stats().flash_programs + vfo_sim::stats().flash_erases;
+}
+
+// Every key recovered must hold a value it was committed with or was being
+// written with; a key never committed may be missing
+uint32_t check_recovered(const Model& model)
+{
+    uint32_t wrong = 0;
+    for (uint32_t n = 0; n < 24; n++)
+    {
+        uint16_t key = workload_key(n);
+        auto committed = model.committed.find(key);
+        auto cached = model.cache.find(key);
+        uint32_t value;
+        if (!vfo_settings::get(key, value))
+        {
+            wrong += committed != model.committed.end();
+        }
+        else
+        {
+            wrong += (committed == model.committed.end() || committed->second != value)
+                && (cached == model.cache.end() || cached->second != value);
+        }
+    }
+    return wrong;
+}
+
+// After recovery the store has to take new values and keep them over a reset
+bool check_still_works()
+{
+    vfo_settings::set(vfo_settings::KEY_FREQUENCY, 14074000);
+    vfo_settings::set(vfo_settings::KEY_BAND, 5);
+    idle();
+    vfo_settings::service(true);
+    // A torn spare may need its erase before the commit gets through
+    idle();
+    vfo_settings::service(true);
+    vfo_settings::init_settings();
+    return vfo_settings::get_or(vfo_settings::KEY_FREQUENCY, 0) == 14074000
+        && vfo_settings::get_or(vfo_settings::KEY_BAND, 0) == 5;
+}
+
+void check_power_cuts()
+{
+    blank_flash();
+    Model clean = {};
+    uint32_t before = flash_operations();
+    vfo_settings::init_settings();
+    run_workload(clean);
+    uint32_t operations = flash_operations() - before;
+    vfo_settings::SettingsStats stats = vfo_settings::get_settings_stats();
+    printf("workload: %u flash operations, %u commits, %u deferred, ends in sector %u\n", operations, stats.commits,
+        stats.commits_deferred, stats.sector);
+    if (stats.commits < CHECK_STEPS / 2)
+    {
+        fail("workload commits", stats.commits);
+    }
+
+    // Whole records and ones torn in the magic, the value and the CRC
+    const uint32_t tears[] = { 0, 2, 6, 28, 96, 140, 252, FLASH_SECTOR_SIZE };
+    for (uint32_t bytes : tears)
+    {
+        uint32_t wrong = 0;
+        uint32_t broken = 0;
+        uint32_t torn = 0;
+        for (uint32_t cut = 0; cut < operations; cut++)
+        {
+            blank_flash();
+            Model model = {};
+            vfo_sim::cut_flash_power(cut, bytes);
+            try
+            {
+                vfo_settings::init_settings();
+                run_workload(model);
+                fail("no power cut at operation", cut, bytes);
+            }
+            catch (const vfo_sim::PowerCut&)
+            {
+            }
+
+            vfo_settings::init_settings();
+            torn += vfo_settings::get_settings_stats().torn;
+            uint32_t n = check_recovered(model);
+            if (n && !wrong)
+            {
+                fail("keys wrong after a cut at operation", cut, bytes);
+            }
+            wrong += n;
+            if (!check_still_works())
+            {
+                if (!broken)
+                {
+                    fail("store not committing after a cut at operation", cut, bytes);
+                }
+                broken++;
+            }
+        }
+        printf("power cut %4u bytes in: %u cuts, %u torn records skipped, %u keys wrong, %u stores broken\n", bytes,
+            operations, torn, wrong, broken);
+    }
+}
+
+void check_channels()
+{
+    blank_flash();
+    vfo_settings::init_settings();
+    uint32_t hz = 0;
+    bool ok = !vfo_settings::get_channel(0, hz) && !vfo_settings::set_channel(SETTINGS_CHANNELS, 7100000)
+        && !vfo_settings::get_channel(SETTINGS_CHANNELS, hz);
+    for (uint32_t channel = 0; channel < SETTINGS_CHANNELS; channel++)
+    {
+        ok &= vfo_settings::set_channel(channel, 3500000 + channel * 1000);
+    }
+    ok &= vfo_settings::set_channel(5, 0);
+    idle();
+    vfo_settings::service(true);
+    vfo_settings::init_settings();
+    for (uint32_t channel = 0; channel < SETTINGS_CHANNELS; channel++)
+    {
+        bool stored = vfo_settings::get_channel(channel, hz);
+        ok &= channel == 5 ? !stored : stored && hz == 3500000 + channel * 1000;
+    }
+    printf("channels: %s\n", ok ? "stored, cleared and out of range as expected" : "wrong");
+    if (!ok)
+    {
+        fail("channels", 0);
+    }
+}
+
+// The demodulator keeps the output busy for good: service() is never allowed
+// to erase, yet the store has to keep rotating and committing, each change
+// reaching flash within the erase wait and two idle periods
+void check_never_silent()
+{
+    blank_flash();
+    vfo_settings::init_settings();
+    Values model;
+    uint32_t rotations = 0;
+    uint32_t sector = vfo_settings::get_settings_stats().sector;
+    uint64_t pending_since = 0; // Oldest change not yet committed, or 0
+    uint64_t longest = 0;
+    uint32_t noise = 3;
+    for (uint32_t step = 0; step < CHECK_STEPS * 2; step++)
+    {
+        noise = noise * 1664525u + 1013904223u;
+        uint16_t key = workload_key(noise >> 8);
+        uint32_t value = 7000000 + (noise >> 12);
+        vfo_settings::set(key, value);
+        model[key] = value;
+        pending_since = pending_since ? pending_since : vfo_sim::now_us();
+
+        uint32_t commits = vfo_settings::get_settings_stats().commits;
+        idle();
+        vfo_settings::service(false);
+        vfo_settings::SettingsStats stats = vfo_settings::get_settings_stats();
+        if (stats.commits != commits)
+        {
+            longest = std::max(longest, vfo_sim::now_us() - pending_since);
+            pending_since = 0;
+        }
+        rotations += stats.sector != sector;
+        sector = stats.sector;
+    }
+    vfo_settings::SettingsStats stats = vfo_settings::get_settings_stats();
+    printf("never silent: %u commits, %u deferred, %u rotations, %u erases forced, longest wait %.1f s\n",
+        stats.commits, stats.commits_deferred, rotations, stats.erases_forced, longest / 1e6);
+    // Blank flash leaves the first SETTINGS_SECTORS - 1 spares erased already
+    if (rotations <= SETTINGS_SECTORS || stats.erases_forced < rotations - (SETTINGS_SECTORS - 1))
+    {
+        fail("rotations without silence", rotations, stats.erases_forced);
+    }
+    if (longest > SETTINGS_ERASE_WAIT_US + 2 * SETTINGS_IDLE_US || pending_since)
+    {
+        fail("change left uncommitted for us", uint32_t(longest), uint32_t(pending_since));
+    }
+
+    vfo_settings::init_settings();
+    uint32_t wrong = 0;
+    for (const auto& [key, value] : model)
+    {
+        wrong += vfo_settings::get_or(key, 0) != value;
+    }
+    if (wrong)
+    {
+        fail("keys wrong after running without silence", wrong);
+    }
+}
+
+// Fills the active sector one commit at a time
+void bench_recovery()
+{
+    blank_flash();
+    vfo_settings::init_settings();
+    uint32_t records = 0;
+    for (uint32_t fill : { 0u, 64u, 128u, 192u, FLASH_SECTOR_SIZE / 16 - 1 })
+    {
+        for (; records < fill; records++)
+        {
+            vfo_settings::set(vfo_settings::KEY_FREQUENCY, 7000000 + records);
+            idle();
+            vfo_settings::service(true);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < CHECK_RECOVERIES; i++)
+        {
+            vfo_settings::init_settings();
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        vfo_settings::SettingsStats stats = vfo_settings::get_settings_stats();
+        printf("recovery: %3u records in sector %u, %6.2f us each on the host\n", stats.records, stats.sector,
+            us / CHECK_RECOVERIES);
+        if (stats.records != fill || vfo_settings::get_or(vfo_settings::KEY_FREQUENCY, 0) != (fill ? 7000000 + fill - 1 : 0))
+        {
+            fail("recovered records", stats.records, fill);
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    vfo_sim::set_log_enabled(false);
+
+    check_power_cuts();
+    check_channels();
+    check_never_silent();
+    bench_recovery();
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
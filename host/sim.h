@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Host simulator internals shared by the HAL pieces. Everything runs on one
+// thread against a virtual clock: the application's main loop runs in zero
+// simulated time and the clock only moves while it sleeps, so a run is
+// deterministic and its speed is limited only by the host.
+namespace vfo_sim
+{
+
+#define SIM_ENCODER_SWITCH 2 // Matches the pins in main.cpp
+#define SIM_ENCODER_CLK 3
+#define SIM_ENCODER_DT 4
+#define SIM_KEYER_DIT 6 // Matches audio.cpp
+#define SIM_KEYER_DAH 7
+
+#define SIM_DISPLAY_ADDRESS 0x3C
+#define SIM_SI5351_ADDRESS 0x60
+#define SIM_XTAL_HZ 25000000
+
+// Clock and event queue
+uint64_t now_us();
+void schedule(uint64_t at_us, std::function<void()> action);
+void advance_to(uint64_t t_us);
+
+// Run to the next event or the deadline; false if an event (or __sev) came first
+bool wait_until(uint64_t deadline_us);
+
+// Input pins, as seen by the application
+void drive_pin(uint32_t gpio, int level); // 0, 1, or -1 to release to the pull
+
+// USB CDC input for the CAT port
+void send_serial(const char* text);
+
+struct I2cDevice
+{
+    virtual ~I2cDevice() = default;
+    virtual int write(const uint8_t* src, size_t len) = 0;
+    virtual int read(uint8_t* dst, size_t len) = 0;
+};
+void attach_i2c(uint8_t address, I2cDevice* device);
+
+// Devices
+void attach_devices(int64_t xtal_ppb);
+
+// Called on every change of the modelled CLK0 frequency, 0 when it goes off
+void watch_clk0(std::function<void(double hz)> watcher);
+double clk0_hz();
+
+// CLK0 and CLK1 as the model has them, 0 when off. CLK1's phase behind CLK0
+// is NaN unless both run from the same PLL at the same frequency and that PLL
+// has been reset since their dividers, controls or offsets were last written.
+struct ClockPair
+{
+    double clk0_hz;
+    double clk1_hz;
+    double vco_hz; // CLK0's PLL
+    double clk1_lag_deg;
+};
+ClockPair clock_pair();
+
+// SWR bridge on CLK0 with a series RLC load resonant at f0_hz, read by the
+// ADC: forward detector on input 0, reflected on input 1 (sim_adc.cpp)
+void set_load(double f0_hz, double r_ohms, double q);
+void write_display_pbm(const char* path);
+void print_display();
+bool display_pixel(uint32_t x, uint32_t y); // Lit, as the panel shows it
+
+// Audio output
+bool open_wav(const char* path);
+void close_wav();
+
+// Flash image persistence
+bool load_flash(const char* path);
+bool save_flash(const char* path);
+
+// Power-fail injection: after operations more flash erases or programs, the
+// next one stops bytes into its range and throws PowerCut out to the caller,
+// as the supply going would leave it. Fires once.
+struct PowerCut
+{
+};
+void cut_flash_power(uint32_t operations, uint32_t bytes);
+
+struct SimStats
+{
+    uint32_t display_frames;
+    uint32_t retunes; // CLK0 frequency changes
+    uint32_t pll_resets;
+    uint64_t i2c_bytes;
+    uint32_t audio_buffers;
+    uint32_t audio_underruns;
+    uint32_t wakes; // Returns from wait_until() before the deadline
+    uint32_t flash_programs;
+    uint32_t flash_erases;
+};
+SimStats& stats();
+
+void log(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+void set_log_enabled(bool enabled);
+
+// Write the outputs, print the report and exit the process
+[[noreturn]] void finish(int code);
+
+} // namespace vfo_sim
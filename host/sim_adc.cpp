@@ -0,0 +1,95 @@
+// Host backend of hal_adc.h: a return-loss bridge between CLK0 and a load,
+// with a diode detector on each arm. Forward reads the source, reflected
+// reads |gamma| of it; both sit on a small offset and carry a little noise.
+// A burst takes the ADC's conversion time in simulated time.
+#include "sim.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+#include "hal_adc.h"
+
+namespace vfo_sim
+{
+
+namespace
+{
+
+#define SIM_ADC_SAMPLE_US 2 // 500 ksps, shared by the enabled inputs
+#define SIM_BRIDGE_OHMS 50.0
+#define SIM_DETECTOR_OFFSET 40 // Codes with no RF
+#define SIM_DETECTOR_SPAN 3000 // Codes for the full source on the forward arm
+#define SIM_DETECTOR_NOISE 4 // Peak, in codes
+
+double load_f0_hz = 7100000;
+double load_r_ohms = 45;
+double load_q = 30;
+
+uint32_t channel_mask = 0;
+uint32_t noise_state = 1;
+
+// Deterministic, so runs repeat exactly
+int32_t noise()
+{
+    noise_state = noise_state * 1664525u + 1013904223u;
+    return int32_t(noise_state >> 16) % (SIM_DETECTOR_NOISE * 2 + 1) - SIM_DETECTOR_NOISE;
+}
+
+double gamma_at(double hz)
+{
+    double x = load_r_ohms * load_q * (hz / load_f0_hz - load_f0_hz / hz);
+    std::complex<double> z(load_r_ohms, x);
+    return std::abs((z - SIM_BRIDGE_OHMS) / (z + SIM_BRIDGE_OHMS));
+}
+
+uint16_t convert(uint32_t input, double hz)
+{
+    double level = 0;
+    if (hz > 0 && input == 0)
+    {
+        level = SIM_DETECTOR_SPAN;
+    }
+    else if (hz > 0 && input == 1)
+    {
+        level = SIM_DETECTOR_SPAN * gamma_at(hz);
+    }
+    int32_t code = SIM_DETECTOR_OFFSET + int32_t(std::lround(level)) + noise();
+    return uint16_t(std::clamp(code, 0, 4095));
+}
+
+} // namespace
+
+void set_load(double f0_hz, double r_ohms, double q)
+{
+    load_f0_hz = f0_hz;
+    load_r_ohms = r_ohms;
+    load_q = q;
+}
+
+} // namespace vfo_sim
+
+using namespace vfo_sim;
+
+bool hal_adc_start(uint32_t mask)
+{
+    channel_mask = mask;
+    log("adc: inputs 0x%x, load %.0f Hz %.1f ohm Q %.1f", mask, load_f0_hz, load_r_ohms, load_q);
+    return mask != 0;
+}
+
+void hal_adc_read(uint16_t* dst, size_t count)
+{
+    // CLK0 as it is at the start of the burst
+    double hz = clk0_hz();
+    uint32_t input = __builtin_ctz(channel_mask);
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i] = convert(input, hz);
+        do
+        {
+            input = (input + 1) % 32;
+        } while (!(channel_mask & (1u << input)));
+    }
+    advance_to(now_us() + count * SIM_ADC_SAMPLE_US);
+}
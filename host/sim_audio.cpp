@@ -0,0 +1,209 @@
+// Host backend of hal_audio.h. Buffers given to the pool play in order at
+// the sample rate of simulated time; each finished buffer goes back to the
+// free list and calls the buffer-done handler, and is appended to the WAV file.
+#include "sim.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "hal_audio.h"
+
+struct audio_buffer_pool
+{
+    audio_buffer_t* free_list;
+    audio_buffer_t* play_head;
+    audio_buffer_t* play_tail;
+    const audio_format_t* format;
+    uint32_t buffer_samples;
+};
+
+namespace vfo_sim
+{
+
+namespace
+{
+
+audio_buffer_pool_t* output = nullptr;
+uint32_t sample_rate = 0;
+uint64_t start_us = 0;
+uint64_t samples_played = 0; // Including the buffer now playing
+audio_buffer_t* playing = nullptr;
+void (*buffer_done)(void) = nullptr;
+
+FILE* wav = nullptr;
+uint32_t wav_samples = 0;
+
+void put_u32(uint8_t* p, uint32_t v)
+{
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+    p[2] = uint8_t(v >> 16);
+    p[3] = uint8_t(v >> 24);
+}
+
+// 16 bit mono PCM; the sizes are filled in by close_wav()
+void write_wav_header(uint32_t rate, uint32_t samples)
+{
+    uint8_t h[44];
+    memcpy(h, "RIFF", 4);
+    put_u32(h + 4, 36 + samples * 2);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_u32(h + 16, 16);
+    put_u32(h + 20, 1 | 1 << 16); // PCM, mono
+    put_u32(h + 24, rate);
+    put_u32(h + 28, rate * 2);
+    put_u32(h + 32, 2 | 16 << 16); // Block align, bits per sample
+    memcpy(h + 36, "data", 4);
+    put_u32(h + 40, samples * 2);
+    fseek(wav, 0, SEEK_SET);
+    fwrite(h, 1, sizeof(h), wav);
+    fseek(wav, 0, SEEK_END);
+}
+
+void write_samples(const int16_t* samples, uint32_t count)
+{
+    if (!wav)
+    {
+        return;
+    }
+    // audio.cpp hands the DAC offset binary (finish_block adds 0x7FFF); store it signed
+    std::vector<int16_t> pcm(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        pcm[i] = samples ? int16_t(uint16_t(samples[i]) ^ 0x8000) : 0;
+    }
+    fwrite(pcm.data(), sizeof(int16_t), count, wav);
+    wav_samples += count;
+}
+
+uint64_t sample_time(uint64_t samples)
+{
+    return start_us + samples * 1000000 / sample_rate;
+}
+
+// A buffer boundary: the DMA hands back the buffer it just played and starts the next
+void play_next()
+{
+    bool finished = playing != nullptr;
+    if (playing)
+    {
+        playing->next = output->free_list;
+        output->free_list = playing;
+        stats().audio_buffers++;
+    }
+
+    playing = output->play_head;
+    uint32_t count = output->buffer_samples;
+    if (playing)
+    {
+        output->play_head = playing->next;
+        if (!output->play_head)
+        {
+            output->play_tail = nullptr;
+        }
+        count = playing->sample_count;
+        write_samples((const int16_t*)playing->buffer->bytes, count);
+    }
+    else
+    {
+        // Nothing queued; the output carries on with silence
+        write_samples(nullptr, count);
+        stats().audio_underruns += samples_played != 0;
+    }
+
+    samples_played += count;
+    schedule(sample_time(samples_played), play_next);
+    if (finished && buffer_done)
+    {
+        buffer_done();
+    }
+}
+
+} // namespace
+
+bool open_wav(const char* path)
+{
+    wav = fopen(path, "wb");
+    if (wav)
+    {
+        write_wav_header(0, 0);
+    }
+    return wav != nullptr;
+}
+
+void close_wav()
+{
+    if (wav)
+    {
+        write_wav_header(sample_rate, wav_samples);
+        fclose(wav);
+        wav = nullptr;
+    }
+}
+
+} // namespace vfo_sim
+
+using namespace vfo_sim;
+
+extern "C" {
+
+audio_buffer_pool_t* hal_audio_start(const hal_audio_config_t* config)
+{
+    static audio_format_t format = { config->sample_rate, AUDIO_BUFFER_FORMAT_PCM_S16, 1 };
+    static audio_buffer_format_t buffer_format = { &format, 2 };
+
+    audio_buffer_pool_t* pool = new audio_buffer_pool_t{};
+    pool->format = &format;
+    pool->buffer_samples = config->buffer_samples;
+    for (uint32_t i = 0; i < config->buffer_count; i++)
+    {
+        size_t size = size_t(config->buffer_samples) * buffer_format.sample_stride;
+        mem_buffer_t* mem = new mem_buffer_t{ size, new uint8_t[size](), 0 };
+        audio_buffer_t* buffer = new audio_buffer_t{ mem, &buffer_format, 0, config->buffer_samples, 0, pool->free_list };
+        pool->free_list = buffer;
+    }
+
+    output = pool;
+    sample_rate = config->sample_rate;
+    start_us = now_us();
+    samples_played = 0;
+    schedule(start_us, play_next);
+    return pool;
+}
+
+void hal_audio_on_buffer_done(void (*handler)(void))
+{
+    buffer_done = handler;
+}
+
+audio_buffer_t* hal_audio_take(audio_buffer_pool_t* pool, bool block)
+{
+    while (!pool->free_list && block)
+    {
+        wait_until(at_the_end_of_time);
+    }
+    audio_buffer_t* buffer = pool->free_list;
+    if (buffer)
+    {
+        pool->free_list = buffer->next;
+        buffer->next = nullptr;
+    }
+    return buffer;
+}
+
+void hal_audio_give(audio_buffer_pool_t* pool, audio_buffer_t* buffer)
+{
+    buffer->next = nullptr;
+    if (pool->play_tail)
+    {
+        pool->play_tail->next = buffer;
+    }
+    else
+    {
+        pool->play_head = buffer;
+    }
+    pool->play_tail = buffer;
+}
+
+} // extern "C"
@@ -0,0 +1,366 @@
+// I2C device models: the SSD1306 display and the Si5351 synthesizer.
+#include "sim.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace vfo_sim
+{
+
+namespace
+{
+
+std::function<void(double hz)> clk0_watcher;
+
+#define SSD1306_WIDTH 128
+#define SSD1306_PAGES 8
+
+// Graphics RAM and the command subset pico-ssd1306 uses. Commands arrive one
+// per transfer, so multi-byte commands collect their arguments across transfers.
+class Ssd1306 : public I2cDevice
+{
+public:
+    int write(const uint8_t* src, size_t len) override
+    {
+        if (len == 0)
+        {
+            return 0;
+        }
+        // Control byte: D/C# selects data or command for the rest of the transfer
+        bool data = src[0] & 0x40;
+        for (size_t i = 1; i < len; i++)
+        {
+            data ? write_data(src[i]) : write_command(src[i]);
+        }
+        return int(len);
+    }
+
+    int read(uint8_t* dst, size_t len) override
+    {
+        memset(dst, 0, len);
+        return int(len);
+    }
+
+    // A pixel as the panel shows it; dark while the display is off. The
+    // start line picks the RAM row at the top, wrapping round the 64
+    bool pixel(uint32_t x, uint32_t y) const
+    {
+        uint32_t row = (y + start_line) % (SSD1306_PAGES * 8);
+        return on && (gram[row / 8][x] >> (row % 8) & 1);
+    }
+
+private:
+    void write_data(uint8_t b)
+    {
+        gram[page][column] = b;
+        if (++column > column_end)
+        {
+            column = column_start;
+            if (++page > page_end)
+            {
+                // The whole window written, however many transfers it took
+                page = page_start;
+                stats().display_frames++;
+            }
+        }
+    }
+
+    void write_command(uint8_t c)
+    {
+        if (args_needed)
+        {
+            args[args_seen++] = c;
+            if (args_seen == args_needed)
+            {
+                apply(pending, args);
+                args_needed = 0;
+            }
+            return;
+        }
+
+        switch (c)
+        {
+        case 0x21: // Column address
+        case 0x22: // Page address
+            start_args(c, 2);
+            break;
+        case 0x20: // Memory mode
+        case 0x81: // Contrast
+        case 0x8D: // Charge pump
+        case 0xA8: // Multiplex
+        case 0xD3: // Display offset
+        case 0xD5: // Clock divide
+        case 0xD9: // Precharge
+        case 0xDA: // COM pins
+        case 0xDB: // VCOM detect
+            start_args(c, 1);
+            break;
+        case 0xAE:
+            on = false;
+            break;
+        case 0xAF:
+            on = true;
+            break;
+        default:
+            if ((c & 0xC0) == 0x40) // Start line
+            {
+                start_line = c & 0x3F;
+            }
+            break;
+        }
+    }
+
+    void start_args(uint8_t c, uint32_t count)
+    {
+        pending = c;
+        args_needed = count;
+        args_seen = 0;
+    }
+
+    void apply(uint8_t c, const uint8_t* a)
+    {
+        if (c == 0x21)
+        {
+            column_start = column = a[0] % SSD1306_WIDTH;
+            column_end = a[1] % SSD1306_WIDTH;
+        }
+        else if (c == 0x22)
+        {
+            page_start = page = a[0] % SSD1306_PAGES;
+            page_end = a[1] % SSD1306_PAGES;
+        }
+    }
+
+    uint8_t gram[SSD1306_PAGES][SSD1306_WIDTH] = {};
+    uint32_t column = 0, column_start = 0, column_end = SSD1306_WIDTH - 1;
+    uint32_t page = 0, page_start = 0, page_end = SSD1306_PAGES - 1;
+    uint8_t pending = 0;
+    uint8_t args[2] = {};
+    uint32_t args_needed = 0;
+    uint32_t args_seen = 0;
+    uint32_t start_line = 0;
+    bool on = false;
+};
+
+// Register file; after every write the CLK0 frequency is worked out from the
+// PLL and multisynth parameters and logged when it changes.
+class Si5351 : public I2cDevice
+{
+public:
+    explicit Si5351(double xtal_hz) : xtal_hz(xtal_hz)
+    {
+        regs[3] = 0xFF; // All outputs disabled
+        regs[16] = 0x80; // CLK0 powered down
+    }
+
+    int write(const uint8_t* src, size_t len) override
+    {
+        if (len == 0)
+        {
+            return 0;
+        }
+        address = src[0];
+        for (size_t i = 1; i < len; i++)
+        {
+            written(address);
+            regs[address++] = src[i];
+        }
+        update();
+        return int(len);
+    }
+
+    int read(uint8_t* dst, size_t len) override
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            // Status reads back ready: SYS_INIT and loss-of-lock clear
+            dst[i] = address == 0 ? 0 : regs[address];
+            address++;
+        }
+        return int(len);
+    }
+
+    double output_hz() const
+    {
+        return last_hz;
+    }
+
+    ClockPair pair() const
+    {
+        ClockPair p = { clk_hz(0), clk_hz(1), vco_hz(0), std::nan("") };
+        if (p.clk0_hz && p.clk0_hz == p.clk1_hz && synced && vco_hz(1) == p.vco_hz)
+        {
+            // Offsets are in quarter VCO periods
+            double lag = ((regs[166] & 0x7F) - (regs[165] & 0x7F)) / (4 * p.vco_hz);
+            p.clk1_lag_deg = std::fmod(lag * p.clk0_hz * 360 + 360, 360);
+        }
+        return p;
+    }
+
+private:
+    // a + b/c from the packed P1/P2/P3 layout used by both PLLs and multisynths
+    static double ratio(const uint8_t* p)
+    {
+        uint32_t p1 = uint32_t(p[2] & 0x03) << 16 | uint32_t(p[3]) << 8 | p[4];
+        uint32_t p2 = uint32_t(p[5] & 0x0F) << 16 | uint32_t(p[6]) << 8 | p[7];
+        uint32_t p3 = uint32_t(p[5] >> 4) << 16 | uint32_t(p[0]) << 8 | p[1];
+        return p3 ? (p1 + 512 + double(p2) / p3) / 128.0 : 0;
+    }
+
+    // VCO of the PLL that output n runs from
+    double vco_hz(uint32_t n) const
+    {
+        return xtal_hz * ratio(&regs[regs[16 + n] & 0x20 ? 34 : 26]);
+    }
+
+    double clk_hz(uint32_t n) const
+    {
+        uint8_t control = regs[16 + n];
+        if (control & 0x80 || regs[3] & (1u << n))
+        {
+            return 0;
+        }
+        const uint8_t* ms = &regs[42 + 8 * n];
+        double divider = (ms[2] & 0x0C) == 0x0C ? 4 : ratio(ms);
+        uint32_t r = 1u << (ms[2] >> 4 & 0x07);
+        return divider ? vco_hz(n) / (divider * r) : 0;
+    }
+
+    // The multisynths only start in step from a PLL reset; new dividers,
+    // controls or phase offsets leave them wherever they were until the next.
+    // PLL parameters do not: every divider follows the same VCO edges.
+    void written(uint8_t reg)
+    {
+        if ((reg >= 16 && reg <= 23) || (reg >= 42 && reg <= 89) || (reg >= 165 && reg <= 170))
+        {
+            synced = false;
+        }
+    }
+
+    void update()
+    {
+        if (regs[177] & 0xA0)
+        {
+            // Self-clearing
+            regs[177] &= uint8_t(~0xA0);
+            synced = true;
+            stats().pll_resets++;
+        }
+
+        double hz = clk_hz(0);
+        if (hz != last_hz)
+        {
+            last_hz = hz;
+            stats().retunes++;
+            if (clk0_watcher)
+            {
+                clk0_watcher(hz);
+            }
+            if (hz)
+            {
+                log("si5351: CLK0 %.3f Hz", hz);
+            }
+            else
+            {
+                log("si5351: CLK0 off");
+            }
+        }
+    }
+
+    double xtal_hz;
+    uint8_t regs[256] = {};
+    uint8_t address = 0;
+    double last_hz = 0;
+    bool synced = false;
+};
+
+Ssd1306* display = nullptr;
+Si5351* synth = nullptr;
+
+} // namespace
+
+void watch_clk0(std::function<void(double hz)> watcher)
+{
+    clk0_watcher = std::move(watcher);
+}
+
+double clk0_hz()
+{
+    return synth ? synth->output_hz() : 0;
+}
+
+ClockPair clock_pair()
+{
+    return synth ? synth->pair() : ClockPair{ 0, 0, 0, std::nan("") };
+}
+
+void attach_devices(int64_t xtal_ppb)
+{
+    // The firmware's correction describes the crystal, so a matching error here reads back exact
+    static Ssd1306 ssd1306;
+    static Si5351 si5351(SIM_XTAL_HZ * (1.0 + xtal_ppb / 1e9));
+    display = &ssd1306;
+    synth = &si5351;
+    attach_i2c(SIM_DISPLAY_ADDRESS, &ssd1306);
+    attach_i2c(SIM_SI5351_ADDRESS, &si5351);
+}
+
+bool display_pixel(uint32_t x, uint32_t y)
+{
+    return display && display->pixel(x, y);
+}
+
+// Binary PBM with lit pixels white, as on the panel
+void write_display_pbm(const char* path)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f)
+    {
+        log("display: cannot write %s", path);
+        return;
+    }
+    fprintf(f, "P4\n%d %d\n", SSD1306_WIDTH, SSD1306_PAGES * 8);
+    for (uint32_t y = 0; y < SSD1306_PAGES * 8; y++)
+    {
+        for (uint32_t x = 0; x < SSD1306_WIDTH; x += 8)
+        {
+            uint8_t bits = 0;
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                bits |= uint8_t(!display->pixel(x + i, y)) << (7 - i);
+            }
+            fputc(bits, f);
+        }
+    }
+    fclose(f);
+}
+
+// Two pixel rows per line with half-block characters
+void print_display()
+{
+    static const char* const blocks[4] = { " ", "▀", "▄", "█" };
+    printf("+");
+    for (uint32_t x = 0; x < SSD1306_WIDTH; x++)
+    {
+        printf("-");
+    }
+    printf("+\n");
+    for (uint32_t y = 0; y < SSD1306_PAGES * 8; y += 2)
+    {
+        printf("|");
+        for (uint32_t x = 0; x < SSD1306_WIDTH; x++)
+        {
+            printf("%s", blocks[display->pixel(x, y) | display->pixel(x, y + 1) << 1]);
+        }
+        printf("|\n");
+    }
+    printf("+");
+    for (uint32_t x = 0; x < SSD1306_WIDTH; x++)
+    {
+        printf("-");
+    }
+    printf("+\n");
+}
+
+} // namespace vfo_sim
@@ -0,0 +1,498 @@
+// Host backend of the HAL (hal.h): virtual clock, event queue, timers, GPIO
+// and the I2C bus; plus the SDK stand-ins for USB stdio and the flash image.
+#include "sim.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <queue>
+#include <vector>
+
+#include "hal.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "pico/bootrom.h"
+#include "pico/stdio.h"
+#include "pico/time.h"
+
+namespace vfo_sim
+{
+
+namespace
+{
+
+struct Event
+{
+    uint64_t at_us;
+    uint64_t order; // Keeps events due at the same time in the order they were scheduled
+    std::function<void()> action;
+
+    bool operator>(const Event& other) const
+    {
+        return at_us != other.at_us ? at_us > other.at_us : order > other.order;
+    }
+};
+
+std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+uint64_t clock_us = 0;
+uint64_t event_order = 0;
+bool event_flag = false; // Set by __sev(), cleared by the next wait
+
+#define SIM_EDGE_FALL 0x4 // Event bits as GPIO_IRQ_EDGE_FALL/RISE
+#define SIM_EDGE_RISE 0x8
+
+struct Pin
+{
+    bool out;
+    bool out_level;
+    bool pull_up;
+    int driven = -1; // Level the simulator applies, or -1
+    bool edge_irq;
+};
+
+Pin pins[NUM_BANK0_GPIOS];
+hal_gpio_callback_t gpio_callback = nullptr;
+
+std::map<uint8_t, I2cDevice*> i2c_devices;
+uint32_t i2c_baudrate = 0;
+uint32_t i2c_transfers = 0;
+
+std::deque<char> serial_in;
+void (*chars_available)(void*) = nullptr;
+void* chars_available_param = nullptr;
+
+int32_t next_alarm_id = 1;
+
+SimStats sim_stats = {};
+bool log_enabled = true;
+
+int64_t power_cut_after = -1; // Flash operations left before the cut, or -1
+uint32_t power_cut_bytes = 0;
+
+bool pin_level(uint32_t gpio)
+{
+    const Pin& p = pins[gpio];
+    if (p.out)
+    {
+        return p.out_level;
+    }
+    if (p.driven >= 0)
+    {
+        return p.driven;
+    }
+    return p.pull_up;
+}
+
+void run_timer(repeating_timer_t* timer, int32_t id, uint64_t period_us)
+{
+    if (timer->alarm_id != id)
+    {
+        // Cancelled
+        return;
+    }
+    if (timer->callback(timer))
+    {
+        schedule(clock_us + period_us, [=] { run_timer(timer, id, period_us); });
+    }
+    else
+    {
+        timer->alarm_id = 0;
+    }
+}
+
+// The transfer blocks the caller for the time it takes on the wire: 9 clocks
+// per byte with the address byte; interrupts still run meanwhile
+void i2c_transfer_time(size_t len)
+{
+    if (i2c_baudrate)
+    {
+        advance_to(clock_us + (len + 1) * 9 * 1000000ull / i2c_baudrate);
+    }
+}
+
+// Whether the power goes during a flash operation on count bytes, and if so
+// cuts count to the part done first
+bool power_fails(size_t& count)
+{
+    if (power_cut_after < 0 || power_cut_after-- > 0)
+    {
+        return false;
+    }
+    count = std::min<size_t>(count, power_cut_bytes);
+    return true;
+}
+
+} // namespace
+
+uint64_t now_us()
+{
+    return clock_us;
+}
+
+void schedule(uint64_t at_us, std::function<void()> action)
+{
+    events.push({ at_us, event_order++, std::move(action) });
+}
+
+void advance_to(uint64_t t_us)
+{
+    while (!events.empty() && events.top().at_us <= t_us)
+    {
+        Event e = events.top();
+        events.pop();
+        clock_us = std::max(clock_us, e.at_us);
+        e.action();
+    }
+    clock_us = std::max(clock_us, t_us);
+}
+
+bool wait_until(uint64_t deadline_us)
+{
+    if (event_flag)
+    {
+        event_flag = false;
+        return false;
+    }
+    if (events.empty() || events.top().at_us > deadline_us)
+    {
+        advance_to(deadline_us);
+        return true;
+    }
+
+    // Any interrupt ends a WFE, whether or not it posted anything
+    uint64_t next = events.top().at_us;
+    advance_to(next);
+    event_flag = false;
+    sim_stats.wakes++;
+    return false;
+}
+
+void drive_pin(uint32_t gpio, int level)
+{
+    bool before = pin_level(gpio);
+    pins[gpio].driven = level;
+    bool after = pin_level(gpio);
+    if (before == after || !gpio_callback)
+    {
+        return;
+    }
+
+    if (pins[gpio].edge_irq)
+    {
+        gpio_callback(gpio, after ? SIM_EDGE_RISE : SIM_EDGE_FALL);
+    }
+}
+
+void send_serial(const char* text)
+{
+    serial_in.insert(serial_in.end(), text, text + strlen(text));
+    if (chars_available)
+    {
+        chars_available(chars_available_param);
+    }
+}
+
+void attach_i2c(uint8_t address, I2cDevice* device)
+{
+    i2c_devices[address] = device;
+}
+
+bool load_flash(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        return false;
+    }
+    size_t n = fread(sim_flash, 1, sizeof(sim_flash), f);
+    fclose(f);
+    return n == sizeof(sim_flash);
+}
+
+bool save_flash(const char* path)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f)
+    {
+        return false;
+    }
+    size_t n = fwrite(sim_flash, 1, sizeof(sim_flash), f);
+    fclose(f);
+    return n == sizeof(sim_flash);
+}
+
+void cut_flash_power(uint32_t operations, uint32_t bytes)
+{
+    power_cut_after = operations;
+    power_cut_bytes = bytes;
+}
+
+SimStats& stats()
+{
+    return sim_stats;
+}
+
+void set_log_enabled(bool enabled)
+{
+    log_enabled = enabled;
+}
+
+void log(const char* fmt, ...)
+{
+    if (!log_enabled)
+    {
+        return;
+    }
+    printf("[%4llu.%06llu] ", (unsigned long long)(clock_us / 1000000), (unsigned long long)(clock_us % 1000000));
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    putchar('\n');
+}
+
+} // namespace vfo_sim
+
+using namespace vfo_sim;
+
+// Pico SDK stand-ins
+
+extern "C" {
+
+const absolute_time_t at_the_end_of_time = UINT64_MAX;
+const absolute_time_t nil_time = 0;
+
+uint8_t sim_flash[PICO_FLASH_SIZE_BYTES];
+
+void panic(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+    finish(1);
+}
+
+uint64_t time_us_64(void)
+{
+    return clock_us;
+}
+
+void sleep_until(absolute_time_t target)
+{
+    advance_to(target);
+}
+
+void sleep_us(uint64_t us)
+{
+    advance_to(clock_us + us);
+}
+
+void sleep_ms(uint32_t ms)
+{
+    advance_to(clock_us + uint64_t(ms) * 1000);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+    return wait_until(timeout_timestamp);
+}
+
+void __sev(void)
+{
+    event_flag = true;
+}
+
+void __wfe(void)
+{
+    wait_until(at_the_end_of_time);
+}
+
+void hal_i2c_init(uint, uint baudrate, uint, uint)
+{
+    i2c_baudrate = baudrate;
+}
+
+int hal_i2c_write(uint, uint8_t address, const uint8_t* src, size_t len, bool)
+{
+    auto device = i2c_devices.find(address);
+    if (device == i2c_devices.end())
+    {
+        return PICO_ERROR_GENERIC;
+    }
+    sim_stats.i2c_bytes += len + 1;
+    i2c_transfers++;
+    i2c_transfer_time(len);
+    return device->second->write(src, len);
+}
+
+int hal_i2c_read(uint, uint8_t address, uint8_t* dst, size_t len, bool)
+{
+    auto device = i2c_devices.find(address);
+    if (device == i2c_devices.end())
+    {
+        return PICO_ERROR_GENERIC;
+    }
+    sim_stats.i2c_bytes += len + 1;
+    i2c_transfers++;
+    i2c_transfer_time(len);
+    return device->second->read(dst, len);
+}
+
+hal_i2c_stats_t hal_i2c_get_stats(uint)
+{
+    // One core, so the bus is never contended
+    return hal_i2c_stats_t{ i2c_transfers, 0, 0 };
+}
+
+void hal_gpio_input(uint gpio, bool pull_up)
+{
+    pins[gpio].out = false;
+    pins[gpio].pull_up = pull_up;
+}
+
+void hal_gpio_output(uint gpio, bool level)
+{
+    pins[gpio].out = true;
+    pins[gpio].out_level = level;
+}
+
+bool hal_gpio_get(uint gpio)
+{
+    return pin_level(gpio);
+}
+
+uint32_t hal_gpio_get_all(void)
+{
+    uint32_t all = 0;
+    for (uint32_t i = 0; i < 32; i++)
+    {
+        all |= uint32_t(pin_level(i)) << i;
+    }
+    return all;
+}
+
+void hal_gpio_put(uint gpio, bool level)
+{
+    pins[gpio].out_level = level;
+}
+
+void hal_gpio_on_edges(uint gpio, hal_gpio_callback_t callback)
+{
+    pins[gpio].edge_irq = true;
+    gpio_callback = callback;
+}
+
+uint32_t hal_time_us(void)
+{
+    return uint32_t(clock_us);
+}
+
+uint64_t hal_time_us_64(void)
+{
+    return clock_us;
+}
+
+void hal_sleep_ms(uint32_t ms)
+{
+    sleep_ms(ms);
+}
+
+bool hal_timer_every_ms(uint32_t period_ms, hal_timer_callback_t callback, void* user_data, hal_timer_t* timer)
+{
+    return hal_timer_every_us(period_ms * 1000, callback, user_data, timer);
+}
+
+bool hal_timer_every_us(uint32_t period_us, hal_timer_callback_t callback, void* user_data, hal_timer_t* timer)
+{
+    // The callbacks take no simulated time, so the period is the same however it is measured
+    uint64_t period = period_us;
+    if (period == 0)
+    {
+        return false;
+    }
+    int32_t id = next_alarm_id++;
+    *timer = { -int64_t(period), id, callback, user_data };
+    schedule(clock_us + period, [=] { run_timer(timer, id, period); });
+    return true;
+}
+
+void hal_timer_cancel(hal_timer_t* timer)
+{
+    // run_timer() drops a pending call back whose id no longer matches
+    timer->alarm_id = 0;
+}
+
+bool stdio_init_all(void)
+{
+    return true;
+}
+
+int getchar_timeout_us(uint32_t)
+{
+    if (serial_in.empty())
+    {
+        return PICO_ERROR_TIMEOUT;
+    }
+    char c = serial_in.front();
+    serial_in.pop_front();
+    return (unsigned char)c;
+}
+
+int stdio_put_string(const char* s, int len, bool newline, bool)
+{
+    log("usb> %.*s%s", len, s, newline ? "\\n" : "");
+    return len;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void*), void* param)
+{
+    chars_available = fn;
+    chars_available_param = param;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    if (flash_offs % FLASH_SECTOR_SIZE || count % FLASH_SECTOR_SIZE || flash_offs + count > sizeof(sim_flash))
+    {
+        panic("flash_range_erase: bad range %08x+%zx", flash_offs, count);
+    }
+    bool cut = power_fails(count);
+    memset(sim_flash + flash_offs, 0xFF, count);
+    if (cut)
+    {
+        throw PowerCut();
+    }
+    sim_stats.flash_erases++;
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count)
+{
+    if (flash_offs % FLASH_PAGE_SIZE || count % FLASH_PAGE_SIZE || flash_offs + count > sizeof(sim_flash))
+    {
+        panic("flash_range_program: bad range %08x+%zx", flash_offs, count);
+    }
+    bool cut = power_fails(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        sim_flash[flash_offs + i] &= data[i];
+    }
+    if (cut)
+    {
+        throw PowerCut();
+    }
+    sim_stats.flash_programs++;
+}
+
+void reset_usb_boot(uint32_t, uint32_t)
+{
+    log("reset_usb_boot");
+    finish(0);
+}
+
+} // extern "C"
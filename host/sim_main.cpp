@@ -0,0 +1,334 @@
+// VFO firmware host simulator.
+//
+//   vfo_sim [--wav out.wav] [--pbm out.pbm] [--flash flash.bin] [--xtal-ppb N]
+//           [--load f0_hz,ohms,q] [--duration ms] [--show] [script]
+//
+// The unmodified application (main.cpp is built with main renamed to
+// vfo_main) runs against the host HAL. The script drives the encoder, the
+// switch, the keyer paddles and the CAT port; one command per line:
+//
+//   wait <ms>                  let time pass
+//   turn <detents> [ms]        rotate the dial, positive tunes up; ms per detent (default 12)
+//   press | release            encoder switch
+//   click | doubleclick | longpress
+//   paddle dit|dah|both <ms>   hold the paddles
+//   pin <gpio> 0|1|z           drive any input pin, z releases it to its pull
+//   cat <text>                 bytes for the USB CAT port
+//   show                       print the display
+//   snapshot <file.pbm>        save the display
+//   note <text>                add a line to the log
+//
+// Each command starts when the previous one ends. The run stops at the end
+// of the script, or after --duration ms of simulated time. --load sets the
+// antenna the analyzer (CAT ZA;) measures, 7100000,45,30 by default.
+#include "sim.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "hardware/flash.h"
+
+int vfo_main();
+
+namespace vfo_sim
+{
+
+namespace
+{
+
+#define SIM_DEFAULT_DURATION_MS 2000
+#define SIM_CLICK_MS 80
+#define SIM_DOUBLE_CLICK_GAP_MS 120
+#define SIM_LONG_PRESS_MS 900
+#define SIM_DETENT_MS 12
+
+const char* wav_path = nullptr;
+const char* pbm_path = nullptr;
+const char* flash_path = nullptr;
+bool show_at_exit = false;
+
+std::chrono::steady_clock::time_point host_start;
+
+[[noreturn]] void usage()
+{
+    fprintf(stderr, "usage: vfo_sim [--wav file] [--pbm file] [--flash file] [--xtal-ppb n] [--load f0_hz,ohms,q] [--duration ms] [--show] [script]\n");
+    exit(2);
+}
+
+[[noreturn]] void script_error(const std::string& path, int line, const std::string& what)
+{
+    fprintf(stderr, "%s:%d: %s\n", path.c_str(), line, what.c_str());
+    exit(2);
+}
+
+// One detent of quadrature on CLK/DT, four edges; DT leads when tuning up
+void schedule_detent(uint64_t at, uint64_t detent_us, bool up)
+{
+    uint32_t first = up ? SIM_ENCODER_DT : SIM_ENCODER_CLK;
+    uint32_t second = up ? SIM_ENCODER_CLK : SIM_ENCODER_DT;
+    uint64_t edge = detent_us / 4;
+    schedule(at, [=] { drive_pin(first, 0); });
+    schedule(at + edge, [=] { drive_pin(second, 0); });
+    schedule(at + 2 * edge, [=] { drive_pin(first, 1); });
+    schedule(at + 3 * edge, [=] { drive_pin(second, 1); });
+}
+
+void schedule_press(uint64_t at, uint64_t ms)
+{
+    schedule(at, [] { drive_pin(SIM_ENCODER_SWITCH, 0); });
+    schedule(at + ms * 1000, [] { drive_pin(SIM_ENCODER_SWITCH, 1); });
+}
+
+// Returns the time the script ends
+uint64_t load_script(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        fprintf(stderr, "cannot open %s\n", path.c_str());
+        exit(2);
+    }
+
+    uint64_t t = 0;
+    std::string text;
+    int line = 0;
+    while (std::getline(in, text))
+    {
+        line++;
+        std::istringstream words(text.substr(0, text.find('#')));
+        std::string command;
+        if (!(words >> command))
+        {
+            continue;
+        }
+
+        std::string rest;
+        std::getline(words >> std::ws, rest);
+
+        if (command == "wait")
+        {
+            uint64_t ms = std::stoull(rest);
+            t += ms * 1000;
+        }
+        else if (command == "turn")
+        {
+            std::istringstream args(rest);
+            long detents = 0;
+            uint64_t ms = SIM_DETENT_MS;
+            if (!(args >> detents))
+            {
+                script_error(path, line, "turn needs a detent count");
+            }
+            args >> ms;
+            for (long i = 0; i < labs(detents); i++)
+            {
+                schedule_detent(t, ms * 1000, detents > 0);
+                t += ms * 1000;
+            }
+        }
+        else if (command == "press" || command == "release")
+        {
+            int level = command == "release";
+            schedule(t, [=] { drive_pin(SIM_ENCODER_SWITCH, level); });
+        }
+        else if (command == "click")
+        {
+            schedule_press(t, SIM_CLICK_MS);
+            t += SIM_CLICK_MS * 1000;
+        }
+        else if (command == "doubleclick")
+        {
+            schedule_press(t, SIM_CLICK_MS);
+            t += (SIM_CLICK_MS + SIM_DOUBLE_CLICK_GAP_MS) * 1000;
+            schedule_press(t, SIM_CLICK_MS);
+            t += SIM_CLICK_MS * 1000;
+        }
+        else if (command == "longpress")
+        {
+            schedule_press(t, SIM_LONG_PRESS_MS);
+            t += SIM_LONG_PRESS_MS * 1000;
+        }
+        else if (command == "paddle")
+        {
+            std::istringstream args(rest);
+            std::string which;
+            uint64_t ms = 0;
+            if (!(args >> which >> ms) || (which != "dit" && which != "dah" && which != "both"))
+            {
+                script_error(path, line, "paddle dit|dah|both <ms>");
+            }
+            bool dit = which != "dah";
+            bool dah = which != "dit";
+            schedule(t, [=] {
+                if (dit)
+                    drive_pin(SIM_KEYER_DIT, 0);
+                if (dah)
+                    drive_pin(SIM_KEYER_DAH, 0);
+            });
+            t += ms * 1000;
+            schedule(t, [=] {
+                drive_pin(SIM_KEYER_DIT, -1);
+                drive_pin(SIM_KEYER_DAH, -1);
+            });
+        }
+        else if (command == "pin")
+        {
+            std::istringstream args(rest);
+            uint32_t gpio = 0;
+            std::string level;
+            if (!(args >> gpio >> level) || gpio >= NUM_BANK0_GPIOS || (level != "0" && level != "1" && level != "z"))
+            {
+                script_error(path, line, "pin <gpio> 0|1|z");
+            }
+            int value = level == "z" ? -1 : level == "1";
+            schedule(t, [=] { drive_pin(gpio, value); });
+        }
+        else if (command == "cat")
+        {
+            schedule(t, [=] {
+                log("usb< %s", rest.c_str());
+                send_serial(rest.c_str());
+            });
+        }
+        else if (command == "show")
+        {
+            schedule(t, [] { print_display(); });
+        }
+        else if (command == "snapshot")
+        {
+            if (rest.empty())
+            {
+                script_error(path, line, "snapshot needs a file name");
+            }
+            schedule(t, [=] { write_display_pbm(rest.c_str()); });
+        }
+        else if (command == "note")
+        {
+            schedule(t, [=] { log("%s", rest.c_str()); });
+        }
+        else
+        {
+            script_error(path, line, "unknown command " + command);
+        }
+    }
+    return t;
+}
+
+} // namespace
+
+void finish(int code)
+{
+    double host_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - host_start).count();
+    double sim_s = now_us() / 1e6;
+
+    close_wav();
+    if (pbm_path)
+    {
+        write_display_pbm(pbm_path);
+    }
+    if (flash_path && !save_flash(flash_path))
+    {
+        fprintf(stderr, "cannot write %s\n", flash_path);
+    }
+    if (show_at_exit)
+    {
+        print_display();
+    }
+
+    const SimStats& s = stats();
+    printf("sim: %.3f s simulated in %.3f s (%.1fx real time)\n", sim_s, host_s, host_s > 0 ? sim_s / host_s : 0);
+    printf("sim: %u display frames, %u CLK0 changes, %u PLL resets, %llu I2C bytes, %u wakes\n", s.display_frames,
+        s.retunes, s.pll_resets, (unsigned long long)s.i2c_bytes, s.wakes);
+    printf("sim: %u audio buffers, %u underruns, %u flash programs, %u erases\n", s.audio_buffers, s.audio_underruns,
+        s.flash_programs, s.flash_erases);
+    fflush(stdout);
+    exit(code);
+}
+
+} // namespace vfo_sim
+
+using namespace vfo_sim;
+
+int main(int argc, char** argv)
+{
+    const char* script = nullptr;
+    int64_t xtal_ppb = 140000;
+    long duration_ms = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--wav" && has_value)
+        {
+            wav_path = argv[++i];
+        }
+        else if (arg == "--pbm" && has_value)
+        {
+            pbm_path = argv[++i];
+        }
+        else if (arg == "--flash" && has_value)
+        {
+            flash_path = argv[++i];
+        }
+        else if (arg == "--xtal-ppb" && has_value)
+        {
+            xtal_ppb = atoll(argv[++i]);
+        }
+        else if (arg == "--load" && has_value)
+        {
+            double f0_hz = 0, ohms = 0, q = 0;
+            if (sscanf(argv[++i], "%lf,%lf,%lf", &f0_hz, &ohms, &q) != 3 || f0_hz <= 0 || ohms <= 0 || q <= 0)
+            {
+                usage();
+            }
+            set_load(f0_hz, ohms, q);
+        }
+        else if (arg == "--duration" && has_value)
+        {
+            duration_ms = atol(argv[++i]);
+        }
+        else if (arg == "--show")
+        {
+            show_at_exit = true;
+        }
+        else if (arg[0] != '-' && !script)
+        {
+            script = argv[i];
+        }
+        else
+        {
+            usage();
+        }
+    }
+
+    host_start = std::chrono::steady_clock::now();
+
+    // A blank chip, unless there is an image from an earlier run
+    memset(sim_flash, 0xFF, sizeof(sim_flash));
+    if (flash_path && load_flash(flash_path))
+    {
+        log("flash: loaded %s", flash_path);
+    }
+    if (wav_path && !open_wav(wav_path))
+    {
+        fprintf(stderr, "cannot write %s\n", wav_path);
+        return 2;
+    }
+    attach_devices(xtal_ppb);
+
+    uint64_t end_us = script ? load_script(script) : SIM_DEFAULT_DURATION_MS * 1000ull;
+    if (duration_ms >= 0)
+    {
+        end_us = uint64_t(duration_ms) * 1000;
+    }
+    schedule(end_us, [] { finish(0); });
+
+    vfo_main();
+    finish(0);
+}
@@ -0,0 +1,218 @@
+// The sweep engine (sweep.h) against the simulator's Si5351 model, on the
+// simulated 48 kHz bus.
+//
+//   sweep_check [period_us]        SWEEP_MIN_PERIOD_US by default
+//
+// For each plan, checks that CLK0 takes every point in order, once, within
+// the multisynth's fractional resolution of the nominal frequency; that the
+// step callback for a point comes after its burst has gone out and before
+// the next is written; and that tuning comes back afterwards. Plans the
+// engine must refuse are tried too. Reports the worst error and the points
+// per second reached.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "sim.h"
+
+#include "band_plan.h"
+#include "event_loop.h"
+#include "hardware/sync.h"
+#include "sweep.h"
+#include "synth.h"
+
+extern "C" {
+#include "si5351/si5351.h"
+}
+
+// The sweep is all this links of the firmware: its wake-ups only need to end a wait
+namespace vfo_loop
+{
+void post_wake(uint32_t)
+{
+    __sev();
+}
+} // namespace vfo_loop
+
+namespace vfo_sim
+{
+void finish(int code)
+{
+    exit(code);
+}
+} // namespace vfo_sim
+
+namespace
+{
+
+#define CHECK_I2C_HZ 48000 // As the firmware runs the bus
+
+struct Change
+{
+    uint64_t time_us;
+    double hz;
+};
+
+struct Step
+{
+    uint64_t time_us;
+    uint32_t index;
+    uint32_t hz;
+};
+
+std::vector<Change> changes;
+std::vector<Step> steps;
+uint32_t failures = 0;
+
+void fail(const char* fmt, uint32_t a, double b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "sweep_check: ");
+        fprintf(stderr, fmt, a, b);
+        fputc('\n', stderr);
+    }
+}
+
+void on_step(uint32_t index, uint32_t hz, void*)
+{
+    steps.push_back({ vfo_sim::now_us(), index, hz });
+}
+
+// The multisynth fraction has a denominator of RFRAC_DENOM and is rounded down
+double resolution_hz(uint32_t hz)
+{
+    return double(hz) * hz / (double(SYNTH_SWEEP_VCO_HZ) * RFRAC_DENOM) + 1e-3;
+}
+
+void run_plan(const vfo_sweep::SweepPlan& plan, uint32_t period_us)
+{
+    const vfo_band::Band& band = vfo_band::bands[vfo_synth::get_band()];
+
+    if (!vfo_sweep::prepare(plan))
+    {
+        fail("plan from %u Hz refused", plan.start_hz);
+        return;
+    }
+    uint32_t count = vfo_sweep::point_count();
+
+    changes.clear();
+    steps.clear();
+    vfo_sweep::SweepStats before = vfo_sweep::get_sweep_stats();
+    uint64_t start_us = vfo_sim::now_us();
+    if (!vfo_sweep::start(period_us, on_step, nullptr))
+    {
+        fail("sweep from %u Hz did not start", plan.start_hz);
+        return;
+    }
+    while (vfo_sweep::active())
+    {
+        vfo_sim::wait_until(vfo_sim::now_us() + 1000000);
+        vfo_sweep::service();
+    }
+    uint64_t sweep_us = vfo_sim::now_us() - start_us;
+
+    // As the radio loop does at the end
+    vfo_synth::select_band(vfo_synth::get_band(), band.default_hz);
+
+    if (changes.size() != count + 1)
+    {
+        fail("%u points, but CLK0 changed %.0f times", count, double(changes.size()));
+    }
+    double worst = 0;
+    for (uint32_t i = 0; i < std::min<size_t>(count, changes.size()); i++)
+    {
+        double error = std::fabs(changes[i].hz - vfo_sweep::point_hz(i));
+        worst = std::max(worst, error);
+        if (error > resolution_hz(vfo_sweep::point_hz(i)))
+        {
+            fail("point %u off by %.3f Hz", i, error);
+        }
+    }
+    if (!changes.empty() && std::fabs(changes.back().hz - band.default_hz) > 1)
+    {
+        fail("tuned back to %u Hz, CLK0 at %.3f Hz", band.default_hz, changes.back().hz);
+    }
+
+    if (steps.size() != count)
+    {
+        fail("%u points, but %.0f step callbacks", count, double(steps.size()));
+    }
+    for (uint32_t i = 0; i < std::min<size_t>(count, steps.size()); i++)
+    {
+        const Step& s = steps[i];
+        if (s.index != i || s.hz != vfo_sweep::point_hz(i))
+        {
+            fail("step callback %u out of order", i);
+        }
+        if (i < changes.size() && s.time_us < changes[i].time_us)
+        {
+            fail("point %u measured before it was written", i);
+        }
+        if (i + 1 < count && i + 1 < changes.size() && s.time_us > changes[i + 1].time_us)
+        {
+            fail("point %u measured after the next was written", i);
+        }
+    }
+
+    vfo_sweep::SweepStats after = vfo_sweep::get_sweep_stats();
+    printf("%u-%u Hz step %u: %u points, worst error %.3f Hz, %.1f points/s, %u late\n", plan.start_hz,
+        plan.stop_hz, plan.step_hz, count, worst, count * 1e6 / sweep_us, after.late - before.late);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t period_us = argc > 1 ? uint32_t(atoi(argv[1])) : SWEEP_MIN_PERIOD_US;
+
+    vfo_sim::set_log_enabled(false);
+    vfo_sim::attach_devices(0);
+    vfo_sim::watch_clk0([](double hz) { changes.push_back({ vfo_sim::now_us(), hz }); });
+
+    hal_i2c_init(0, CHECK_I2C_HZ, 0, 1);
+    if (!si5351_init(SIM_SI5351_ADDRESS, SI5351_CRYSTAL_LOAD_8PF, SIM_XTAL_HZ, 0))
+    {
+        fprintf(stderr, "sweep_check: no Si5351\n");
+        return 1;
+    }
+    vfo_synth::init_synth();
+    vfo_synth::select_band(0, vfo_band::bands[0].default_hz);
+    si5351_output_enable(SI5351_CLK0, 1);
+
+    const vfo_sweep::SweepPlan plans[] = {
+        { 1000000, 30000000, 100000 }, // HF antenna
+        { 7000000, 7300000, 1000 }, // One band, fine
+        { 14000000, 14350000, 350 }, // Close to SWEEP_MAX_POINTS
+        { SYNTH_SWEEP_MIN_HZ, SYNTH_SWEEP_MAX_HZ, 100000 }, // The whole range
+        { 10000000, 10000000, 1 }, // A single point
+    };
+    for (const auto& plan : plans)
+    {
+        run_plan(plan, period_us);
+    }
+
+    const vfo_sweep::SweepPlan refused[] = {
+        { 7000000, 7300000, 0 },
+        { 7300000, 7000000, 1000 },
+        { 7000000, 7300000, 100 }, // Too many points
+        { SYNTH_SWEEP_MIN_HZ - 1, 2000000, 1000 },
+        { 90000000, SYNTH_SWEEP_MAX_HZ + 1, 100000 },
+    };
+    for (const auto& plan : refused)
+    {
+        if (vfo_sweep::prepare(plan))
+        {
+            fail("plan from %u Hz accepted", plan.start_hz);
+        }
+    }
+    if (vfo_sweep::start(SWEEP_MIN_PERIOD_US - 1, on_step, nullptr))
+    {
+        fail("period of %u us accepted", SWEEP_MIN_PERIOD_US - 1);
+    }
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
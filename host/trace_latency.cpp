@@ -0,0 +1,215 @@
+// Tune latency from trace dumps (trace.h, the CAT command TD;).
+//
+//   trace_latency [log...]        reads stdin without arguments
+//
+// Any text can surround the dumps: a serial capture, or the simulator's log.
+// Only "#T <time_us> <event> <arg>" lines are read; records repeated by a
+// later dump are skipped. Each pickup of the dial by the main loop is one
+// tune, timed from the first encoder IRQ it consumed to:
+//
+//   pickup   the main loop taking the rotation
+//   rf       the last Si5351 register burst before the display is sent
+//   pixel    the display send that shows the new frequency
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace
+{
+
+struct Record
+{
+    uint32_t time_us;
+    uint32_t event;
+    uint32_t arg;
+};
+
+struct Tune
+{
+    uint32_t encoder_us;
+    uint32_t pickup_us;
+    uint32_t rf_us; // 0 until seen
+    uint32_t pixel_us;
+};
+
+std::vector<Record> records;
+std::vector<Record> dump;
+uint32_t last_time_us = 0;
+bool have_last = false;
+
+// A dump repeats whatever the ring still holds from the one before
+void end_dump()
+{
+    for (const Record& r : dump)
+    {
+        if (!have_last || int32_t(r.time_us - last_time_us) > 0)
+        {
+            records.push_back(r);
+        }
+    }
+    if (!dump.empty())
+    {
+        last_time_us = std::max(last_time_us, dump.back().time_us);
+        have_last = true;
+    }
+    dump.clear();
+}
+
+void read_stream(std::istream& in)
+{
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::string::size_type at = line.find("#T ");
+        if (at == std::string::npos)
+        {
+            continue;
+        }
+        const char* text = line.c_str() + at + 3;
+        unsigned long time_us, event, arg;
+        if (strncmp(text, "end", 3) == 0)
+        {
+            end_dump();
+        }
+        else if (sscanf(text, "%lu %lu %lu", &time_us, &event, &arg) == 3)
+        {
+            dump.push_back({ uint32_t(time_us), uint32_t(event), uint32_t(arg) });
+        }
+    }
+    end_dump();
+}
+
+std::vector<Tune> find_tunes()
+{
+    std::vector<Tune> tunes;
+    uint32_t first_encoder_us = 0;
+    bool encoder_pending = false;
+    Tune* open = nullptr;
+
+    for (const Record& r : records)
+    {
+        switch (r.event)
+        {
+        case TRACE_ENCODER:
+            if (!encoder_pending)
+            {
+                first_encoder_us = r.time_us;
+                encoder_pending = true;
+            }
+            break;
+        case TRACE_PICKUP:
+            open = nullptr;
+            if (encoder_pending)
+            {
+                tunes.push_back({ first_encoder_us, r.time_us, 0, 0 });
+                open = &tunes.back();
+                encoder_pending = false;
+            }
+            break;
+        case TRACE_SI5351_WRITE:
+            if (open && !open->pixel_us)
+            {
+                open->rf_us = r.time_us;
+            }
+            break;
+        case TRACE_DISPLAY_SENT:
+            if (open && !open->pixel_us)
+            {
+                open->pixel_us = r.time_us;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return tunes;
+}
+
+void print_histogram(const char* name, std::vector<uint32_t> us)
+{
+    if (us.empty())
+    {
+        printf("%s: no samples\n\n", name);
+        return;
+    }
+    std::sort(us.begin(), us.end());
+    auto pct = [&](uint32_t p) { return us[std::min<size_t>(us.size() - 1, us.size() * p / 100)]; };
+    printf("%s: n=%zu min=%u p50=%u p90=%u p99=%u max=%u us\n", name, us.size(), us.front(), pct(50), pct(90), pct(99),
+        us.back());
+
+    // 1-2-5 buckets from 10 us
+    static const uint32_t edges[] = { 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000,
+        200000, 500000 };
+    size_t counts[std::size(edges) + 1] = {};
+    for (uint32_t v : us)
+    {
+        counts[std::upper_bound(std::begin(edges), std::end(edges), v) - std::begin(edges)]++;
+    }
+    size_t most = *std::max_element(std::begin(counts), std::end(counts));
+    for (size_t i = 0; i <= std::size(edges); i++)
+    {
+        if (counts[i] == 0)
+        {
+            continue;
+        }
+        char label[24];
+        if (i < std::size(edges))
+        {
+            snprintf(label, sizeof(label), "< %u us", edges[i]);
+        }
+        else
+        {
+            snprintf(label, sizeof(label), ">= %u us", edges[i - 1]);
+        }
+        printf("  %12s %6zu %s\n", label, counts[i], std::string(counts[i] * 50 / most + 1, '#').c_str());
+    }
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        read_stream(std::cin);
+    }
+    for (int i = 1; i < argc; i++)
+    {
+        std::ifstream in(argv[i]);
+        if (!in)
+        {
+            fprintf(stderr, "cannot open %s\n", argv[i]);
+            return 2;
+        }
+        read_stream(in);
+    }
+
+    std::vector<Tune> tunes = find_tunes();
+    printf("%zu records, %zu tunes\n\n", records.size(), tunes.size());
+
+    std::vector<uint32_t> pickup, rf, pixel;
+    for (const Tune& t : tunes)
+    {
+        pickup.push_back(t.pickup_us - t.encoder_us);
+        if (t.rf_us)
+        {
+            rf.push_back(t.rf_us - t.encoder_us);
+        }
+        if (t.pixel_us)
+        {
+            pixel.push_back(t.pixel_us - t.encoder_us);
+        }
+    }
+    print_histogram("encoder to pickup", pickup);
+    print_histogram("tune to RF", rf);
+    print_histogram("tune to pixel", pixel);
+    return 0;
+}
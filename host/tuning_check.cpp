@@ -0,0 +1,238 @@
+// The tuning rate engine (tuning_rate.h) replayed against spin profiles, with
+// the frequency stepped as main.cpp steps it.
+//
+//   tuning_check
+//
+// Each profile is a list of detent times: slow fine tuning, steady spins at
+// speeds inside each segment of the default curve with jitter on every detent,
+// a flick that speeds up and dies away, a reversal and a pause. They are fed
+// to the main loop's code one detent per wake, and again as a loop busy with a
+// display frame for 25 ms after every update sees them, several at a time.
+// Fine tuning must stay at 1x and move one step per detent; a steady spin,
+// once a few detents in, must get its segment's multiplier; a reversal or a
+// pause must start the speed over from its first detent; every accelerated
+// step must land on a multiple of the step it took; and the dial stays inside
+// the band.
+// Each starts at the bottom of 40 m; reported is how far it tuned, and how
+// many detents it took to cross the band's 200 kHz if it got there.
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "band_plan.h"
+#include "frequency.h"
+#include "tuning_rate.h"
+
+namespace
+{
+
+#define CHECK_DIAL_HZ 7074000 // 40 metres, 100 Hz a step
+#define CHECK_SETTLE_DETENTS 8 // Smoothing the speed takes this many to catch up
+#define CHECK_BUSY_US 25000 // A display frame after each update
+
+uint32_t failures = 0;
+
+void fail(const char* what, long a, long b = 0)
+{
+    if (failures++ < 20)
+    {
+        fprintf(stderr, "tuning_check: %s (%ld, %ld)\n", what, a, b);
+    }
+}
+
+uint32_t noise = 1;
+
+// Uniform in [-range, range]
+int32_t jitter(int32_t range)
+{
+    noise = noise * 1664525u + 1013904223u;
+    return range ? int32_t((noise >> 8) % uint32_t(2 * range + 1)) - range : 0;
+}
+
+struct Detent
+{
+    uint32_t at_us;
+    int32_t direction;
+    uint32_t expected; // Multiplier it must get, or 0 where either neighbour will do
+};
+
+struct Profile
+{
+    std::string name;
+    std::vector<Detent> detents;
+    uint32_t now_us = 1000000;
+
+    // count detents at rate per second, each up to jitter_permille early or
+    // late; the multiplier is checked from detent settle on
+    void spin(uint32_t count, uint32_t rate, int32_t direction, int32_t jitter_permille, uint32_t expected,
+        uint32_t settle = CHECK_SETTLE_DETENTS)
+    {
+        uint32_t interval = 1000000 / rate;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            now_us += uint32_t(int32_t(interval) + jitter(int32_t(interval) * jitter_permille / 1000));
+            detents.push_back({ now_us, direction, i < settle ? 0 : expected });
+        }
+    }
+
+    void pause(uint32_t us)
+    {
+        now_us += us;
+    }
+};
+
+// Multiplier for a steady speed, from the curve itself
+uint32_t segment(uint32_t detents_per_sec)
+{
+    uint32_t m = 1;
+    for (const vfo_input::AccelPoint& point : vfo_input::default_accel_curve)
+    {
+        if (detents_per_sec >= point.detents_per_sec)
+        {
+            m = point.multiplier;
+        }
+    }
+    return m;
+}
+
+std::vector<Profile> profiles()
+{
+    std::vector<Profile> list;
+
+    Profile fine = { "fine, 2-4/s", {} };
+    fine.spin(40, 3, 1, 300, 1, 0);
+    list.push_back(fine);
+
+    // The middle of each segment of the default curve
+    for (uint32_t rate : { 3u, 9u, 16u, 25u, 37u, 60u })
+    {
+        Profile steady = { "steady " + std::to_string(rate) + "/s", {} };
+        steady.spin(80, rate, 1, 100, segment(rate));
+        list.push_back(steady);
+    }
+
+    // Up to 60/s over a second and back down, the way a flick of the knob goes
+    Profile flick = { "flick", {} };
+    for (uint32_t rate = 5; rate <= 60; rate += 5)
+    {
+        flick.spin(rate / 10 + 1, rate, 1, 50, 0);
+    }
+    for (uint32_t rate = 60; rate >= 5; rate -= 5)
+    {
+        flick.spin(rate / 10 + 1, rate, 1, 50, 0);
+    }
+    list.push_back(flick);
+
+    // Fast one way, then back after the hand turns round: the first detent
+    // back is timed on its own, not smoothed with the spin before it
+    Profile reversal = { "reversal", {} };
+    reversal.spin(30, 40, 1, 50, 0);
+    reversal.spin(1, 5, -1, 0, 1, 0);
+    reversal.spin(30, 40, -1, 50, 0);
+    list.push_back(reversal);
+
+    Profile pause = { "pause", {} };
+    pause.spin(30, 40, 1, 50, 0);
+    pause.pause(TUNING_IDLE_US + 50000);
+    pause.spin(1, 40, 1, 0, 1, 0);
+    list.push_back(pause);
+    return list;
+}
+
+struct Result
+{
+    uint32_t wrong_multiplier;
+    uint32_t off_grid;
+    uint32_t outside;
+    uint32_t updates;
+    int64_t moved_hz;
+    size_t crossed; // Detents to the top of the band, 0 if short of it
+};
+
+// As main.cpp: the detents pending at a wake are one count, timed by the last
+void replay(const Profile& p, uint32_t busy_us, Result& r)
+{
+    const vfo_band::Band& band = vfo_band::bands[vfo_band::find_band(CHECK_DIAL_HZ)];
+    uint32_t step_hz = vfo_ui::pow10[band.step_power];
+    vfo_input::TuningRate tuning;
+    vfo_ui::Frequency frequency(band.low_hz);
+    uint32_t start_hz = frequency.hz();
+
+    size_t i = 0;
+    while (i < p.detents.size())
+    {
+        // Everything that came in while the loop was busy
+        uint32_t wake_us = p.detents[i].at_us;
+        int32_t count = 0;
+        uint32_t count_time = 0;
+        uint32_t expected = p.detents[i].expected;
+        do
+        {
+            count += p.detents[i].direction;
+            count_time = p.detents[i].at_us;
+            i++;
+        } while (i < p.detents.size() && p.detents[i].at_us < wake_us + busy_us
+            && p.detents[i].direction == p.detents[i - 1].direction);
+
+        uint32_t multiplier = tuning.update(count, count_time);
+        frequency.step(step_hz * multiplier, count, band.low_hz, band.high_hz, multiplier > 1);
+        r.updates++;
+
+        if (expected && multiplier != expected)
+        {
+            r.wrong_multiplier++;
+        }
+        if (frequency.hz() % (step_hz * multiplier) != 0)
+        {
+            r.off_grid++;
+        }
+        if (frequency.hz() < band.low_hz || frequency.hz() > band.high_hz)
+        {
+            r.outside++;
+        }
+        if (frequency.hz() == band.high_hz && !r.crossed)
+        {
+            r.crossed = i;
+        }
+    }
+    r.moved_hz = int64_t(frequency.hz()) - start_hz;
+}
+
+} // namespace
+
+int main()
+{
+    for (const Profile& p : profiles())
+    {
+        for (uint32_t busy_us : { 0u, uint32_t(CHECK_BUSY_US) })
+        {
+            Result r = {};
+            replay(p, busy_us, r);
+            printf("%-12s %s %3zu detents in %3u updates: %+7lld Hz", p.name.c_str(), busy_us ? "busy" : "idle",
+                p.detents.size(), r.updates, (long long)r.moved_hz);
+            if (r.crossed)
+            {
+                printf(", across in %zu", r.crossed);
+            }
+            printf("; %u multipliers wrong, %u off the step, %u outside\n", r.wrong_multiplier, r.off_grid, r.outside);
+            if (r.wrong_multiplier || r.off_grid || r.outside)
+            {
+                fail(p.name.c_str(), long(r.wrong_multiplier), long(r.off_grid + r.outside));
+            }
+        }
+    }
+
+    // Fine tuning is exact: one step per detent
+    Profile fine = profiles()[0];
+    Result r = {};
+    replay(fine, 0, r);
+    uint32_t step_hz = vfo_ui::pow10[vfo_band::bands[vfo_band::find_band(CHECK_DIAL_HZ)].step_power];
+    if (r.moved_hz != int64_t(fine.detents.size() * step_hz))
+    {
+        fail("fine tuning moved", long(r.moved_hz), long(fine.detents.size() * step_hz));
+    }
+
+    printf("%s\n", failures ? "FAIL" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Input events passed from interrupt handlers to the main loop.
+namespace vfo_input
+{
+
+#define INPUT_QUEUE_LEN 32
+
+enum class InputEventType : uint8_t
+{
+    Rotate, // value = signed detents
+    Press,
+    Release,
+    LongPress,
+    Click, // Single press and release, once the double-click window has passed
+    DoubleClick
+};
+
+struct InputEvent
+{
+    uint32_t time_us; // time_us_32() when the event was seen
+    InputEventType type;
+    uint8_t source; // Encoder or button number
+    int16_t value;
+};
+
+// Fixed-capacity lock-free single-producer/single-consumer ring.
+// Only the producer writes head and only the consumer writes tail, so push and
+// pop need no locks or interrupt masking. The GPIO and alarm IRQs share one
+// NVIC priority and cannot preempt each other, so together they are a single producer.
+template <typename T, uint32_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer; returns false and counts an overflow if the ring is full
+    bool push(const T& item)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity)
+        {
+            overflows.store(overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        items[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer; returns false when empty
+    bool pop(T& item)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = items[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+    }
+
+    uint32_t overflow_count() const
+    {
+        return overflows.load(std::memory_order_relaxed);
+    }
+
+private:
+    T items[Capacity];
+    std::atomic<uint32_t> head = 0;
+    std::atomic<uint32_t> tail = 0;
+    std::atomic<uint32_t> overflows = 0;
+};
+
+using InputQueue = SpscQueue<InputEvent, INPUT_QUEUE_LEN>;
+
+} // namespace vfo_input
@@ -0,0 +1,273 @@
+#include "keyer.h"
+#include "placement.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vfo_audio
+{
+
+namespace
+{
+
+// Morse characters are packed LSB first (0 = dit, 1 = dah) under a leading 1 marker,
+// so the element sequence is walked with code & 1, code >>= 1 until only the marker is left.
+constexpr uint8_t morse(const char* pattern)
+{
+    uint32_t len = 0;
+    while (pattern[len])
+    {
+        len++;
+    }
+    uint8_t code = 1;
+    while (len--)
+    {
+        code = (code << 1) | (pattern[len] == '-' ? 1 : 0);
+    }
+    return code;
+}
+
+constexpr uint8_t morse_letters[26] HOT_DATA("keyer") = {
+    morse(".-"), morse("-..."), morse("-.-."), morse("-.."), morse("."), morse("..-."), morse("--."),
+    morse("...."), morse(".."), morse(".---"), morse("-.-"), morse(".-.."), morse("--"), morse("-."),
+    morse("---"), morse(".--."), morse("--.-"), morse(".-."), morse("..."), morse("-"), morse("..-"),
+    morse("...-"), morse(".--"), morse("-..-"), morse("-.--"), morse("--..")
+};
+
+constexpr uint8_t morse_digits[10] HOT_DATA("keyer") = {
+    morse("-----"), morse(".----"), morse("..---"), morse("...--"), morse("....-"),
+    morse("....."), morse("-...."), morse("--..."), morse("---.."), morse("----.")
+};
+
+// Returns 0 for characters with no Morse equivalent
+uint8_t HOT_FUNC(morse_lookup)(char c)
+{
+    if (c >= 'a' && c <= 'z')
+    {
+        c -= 'a' - 'A';
+    }
+    if (c >= 'A' && c <= 'Z')
+    {
+        return morse_letters[c - 'A'];
+    }
+    if (c >= '0' && c <= '9')
+    {
+        return morse_digits[c - '0'];
+    }
+    switch (c)
+    {
+    case '/':
+        return morse("-..-.");
+    case '?':
+        return morse("..--..");
+    case '.':
+        return morse(".-.-.-");
+    case ',':
+        return morse("--..--");
+    case '=':
+        return morse("-...-");
+    default:
+        return 0;
+    }
+}
+
+} // namespace
+
+void Keyer::init(uint32_t rate)
+{
+    sample_rate = rate;
+
+    // Raised-cosine ramp; rise reads it forwards, fall reads it backwards
+    for (uint32_t i = 0; i < KEYER_RAMP_LEN; i++)
+    {
+        ramp[i] = int16_t(32767 * 0.5f * (1.0f - cosf(i * (float)M_PI / KEYER_RAMP_LEN)));
+    }
+
+    set_wpm(wpm);
+}
+
+void Keyer::set_wpm(uint32_t new_wpm)
+{
+    wpm = std::clamp<uint32_t>(new_wpm, KEYER_MIN_WPM, KEYER_MAX_WPM);
+
+    // PARIS timing: a dit is 1.2 / wpm seconds
+    dit_len = (sample_rate * 6) / (wpm * 5);
+}
+
+void Keyer::set_mode(KeyerMode new_mode)
+{
+    mode = new_mode;
+}
+
+void Keyer::set_paddles(bool dit, bool dah)
+{
+    dit_paddle = dit;
+    dah_paddle = dah;
+
+    // Iambic memory: remember the opposite paddle if it is touched during a
+    // mark. Mode A leaves a squeeze out, so letting go of both paddles ends on
+    // the element being sent; mode B keeps it and sends the alternate after.
+    if (key_down && (mode == KeyerMode::IambicB || !(dit && dah)))
+    {
+        if (last == Element::Dit && dah)
+        {
+            dah_memory = true;
+        }
+        else if (last == Element::Dah && dit)
+        {
+            dit_memory = true;
+        }
+    }
+}
+
+bool Keyer::send(const char* msg)
+{
+    uint32_t head = text_head.load(std::memory_order_relaxed);
+    uint32_t tail = text_tail.load(std::memory_order_acquire);
+    if (head - tail + strlen(msg) > KEYER_TEXT_LEN)
+    {
+        return false;
+    }
+    while (*msg)
+    {
+        text[head++ % KEYER_TEXT_LEN] = *msg++;
+    }
+    text_head.store(head, std::memory_order_release);
+    return true;
+}
+
+bool Keyer::busy() const
+{
+    return key_down || remaining || code || ramp_pos
+        || text_head.load(std::memory_order_acquire) != text_tail.load(std::memory_order_relaxed);
+}
+
+void HOT_FUNC(Keyer::start_mark)(Element element)
+{
+    last = element;
+    key_down = true;
+    remaining = element == Element::Dah ? dit_len * 3 : dit_len;
+}
+
+void HOT_FUNC(Keyer::start_space)(uint32_t dits)
+{
+    key_down = false;
+    remaining = dit_len * dits;
+}
+
+// Next element of queued text; returns false when the queue is empty
+bool HOT_FUNC(Keyer::next_text_element)()
+{
+    if (code == 1)
+    {
+        // Character finished; pad the inter-element space out to a character space
+        code = 0;
+        start_space(2);
+        return true;
+    }
+
+    while (code == 0)
+    {
+        uint32_t tail = text_tail.load(std::memory_order_relaxed);
+        if (tail == text_head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        char c = text[tail % KEYER_TEXT_LEN];
+        text_tail.store(tail + 1, std::memory_order_release);
+
+        if (c == ' ')
+        {
+            // Character space + 4 = word space
+            start_space(4);
+            return true;
+        }
+        code = morse_lookup(c);
+    }
+
+    start_mark((code & 1) ? Element::Dah : Element::Dit);
+    code >>= 1;
+    return true;
+}
+
+// Called on an element boundary (remaining == 0)
+void HOT_FUNC(Keyer::next_element)()
+{
+    if (key_down && last != Element::None)
+    {
+        // Every mark is followed by one dit of space
+        start_space(1);
+        return;
+    }
+
+    if (next_text_element())
+    {
+        return;
+    }
+
+    if (mode == KeyerMode::Straight)
+    {
+        // No element timing; the key follows the paddle directly
+        key_down = dit_paddle;
+        last = Element::None;
+        return;
+    }
+
+    bool dit = dit_paddle || dit_memory;
+    bool dah = dah_paddle || dah_memory;
+    Element alternate = last == Element::Dit ? Element::Dah : Element::Dit;
+
+    Element element = Element::None;
+    if (dit && dah)
+    {
+        element = alternate;
+    }
+    else if (dit)
+    {
+        element = Element::Dit;
+    }
+    else if (dah)
+    {
+        element = Element::Dah;
+    }
+
+    dit_memory = false;
+    dah_memory = false;
+
+    if (element != Element::None)
+    {
+        start_mark(element);
+    }
+    else
+    {
+        last = Element::None;
+    }
+}
+
+void HOT_FUNC(Keyer::process)(int16_t* samples, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (remaining == 0)
+        {
+            next_element();
+        }
+        if (remaining)
+        {
+            remaining--;
+        }
+
+        int32_t gain;
+        if (key_down)
+        {
+            gain = ramp_pos < KEYER_RAMP_LEN ? ramp[ramp_pos++] : 32767;
+        }
+        else
+        {
+            gain = ramp_pos ? ramp[--ramp_pos] : 0;
+        }
+        samples[i] = int16_t((samples[i] * gain) >> 15);
+    }
+}
+
+} // namespace vfo_audio
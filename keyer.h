@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace vfo_audio
+{
+
+// Length of the raised-cosine rise/fall ramps, in samples (~5ms at 44.1kHz)
+#define KEYER_RAMP_LEN 224
+#define KEYER_TEXT_LEN 64
+#define KEYER_MIN_WPM 5
+#define KEYER_MAX_WPM 60
+
+enum class KeyerMode : uint8_t
+{
+    Straight, // Dit paddle acts as a straight key
+    IambicA, // Remembers the opposite paddle only when it is closed on its own
+    IambicB // Also remembers it through a squeeze, so a release sends one more element
+};
+
+// CW keyer/sidetone shaper.
+// All timing is counted in samples inside process(), so element lengths are
+// exact regardless of how late the audio block is filled.
+class Keyer
+{
+public:
+    void init(uint32_t sample_rate);
+
+    void set_wpm(uint32_t wpm);
+    uint32_t get_wpm() const
+    {
+        return wpm;
+    }
+    void set_mode(KeyerMode mode);
+    KeyerMode get_mode() const
+    {
+        return mode;
+    }
+
+    // Paddle levels (true == closed); sampled once per block
+    void set_paddles(bool dit, bool dah);
+
+    // Queue text to send; returns false if it does not fit
+    bool send(const char* text);
+
+    // True while a mark, space or queued text is still in progress
+    bool busy() const;
+
+    // Apply the keying envelope to a block of signed samples in place
+    void process(int16_t* samples, uint32_t count);
+
+    // Samples per dit at the current speed
+    uint32_t dit_samples() const
+    {
+        return dit_len;
+    }
+
+private:
+    enum class Element : uint8_t
+    {
+        None,
+        Dit,
+        Dah
+    };
+
+    void next_element();
+    bool next_text_element();
+    void start_mark(Element element);
+    void start_space(uint32_t dits);
+
+    int16_t ramp[KEYER_RAMP_LEN] = {};
+
+    uint32_t sample_rate = 44100;
+    uint32_t wpm = 18;
+    uint32_t dit_len = 0;
+    KeyerMode mode = KeyerMode::IambicB;
+
+    // Current element; remaining counts down to the next boundary
+    uint32_t remaining = 0;
+    bool key_down = false;
+    Element last = Element::None;
+    uint32_t ramp_pos = 0;
+
+    // Paddle state and iambic memory
+    bool dit_paddle = false;
+    bool dah_paddle = false;
+    bool dit_memory = false;
+    bool dah_memory = false;
+
+    // Text queue; written by send(), drained by process()
+    char text[KEYER_TEXT_LEN] = {};
+    std::atomic<uint32_t> text_head = 0;
+    std::atomic<uint32_t> text_tail = 0;
+    uint8_t code = 0; // Remaining elements of the current character, with a leading 1 marker
+};
+
+} // namespace vfo_audio
@@ -6,8 +6,6 @@
 #include "pico-ssd1306/ssd1306.h"
 #include "pico-ssd1306/textRenderer/TextRenderer.h"
 
-#include "hardware/i2c.h"
-
 // 5351 Frequency Synthesizer library
 extern "C" {
 #include "si5351/si5351.h"
@@ -15,9 +13,28 @@ extern "C" {
 
 #include <array>
 #include <atomic>
-#include <format>
 
+#include "analyzer.h"
 #include "audio.h"
+#include "band_plan.h"
+#include "boot.h"
+#include "buttons.h"
+#include "core_link.h"
+#include "demod.h"
+#include "encoder.h"
+#include "event_loop.h"
+#include "frequency.h"
+#include "hal.h"
+#include "input_events.h"
+#if VFO_ENCODER_PIO
+#include "quadrature.h"
+#endif
+#include "radio.h"
+#include "settings.h"
+#include "tuning_rate.h"
+#include "spectrum.h"
+#include "synth.h"
+#include "trace.h"
 
 // Use the namespace for convenience
 using namespace pico_ssd1306;
@@ -25,10 +42,10 @@ using namespace pico_ssd1306;
 // Utility function to blind the light for debugging
 void blink(uint32_t count)
 {
-    gpio_put(PICO_DEFAULT_LED_PIN, 1);
-    sleep_ms(count);
-    gpio_put(PICO_DEFAULT_LED_PIN, 0);
-    sleep_ms(count);
+    hal_gpio_put(PICO_DEFAULT_LED_PIN, 1);
+    hal_sleep_ms(count);
+    hal_gpio_put(PICO_DEFAULT_LED_PIN, 0);
+    hal_sleep_ms(count);
 }
 
 // Rotary encoder connections
@@ -36,142 +53,126 @@ void blink(uint32_t count)
 #define ENCODER_CLK 3 // Pin for A (CLK)
 #define ENCODER_DT 4 // Pin for B (DT)
 
+// A second button, to ground: swaps the main screen for a full-screen waterfall (VFO_RX_DEMOD)
+#define SCOPE_BUTTON 5
+
 #define DISPLAY_CLOCK 1
 #define DISPLAY_DATA 0
 #define DISPLAY_ADDRESS 0x3C // The display's address on the bus
+#define DISPLAY_READY_TIMEOUT_US 100000 // Power-on until the controller answers, with margin
 
-std::atomic<int> encoder_count = 0; // Counter for the encoder position
-std::atomic<bool> button_pressed = false;
-std::atomic<bool> button_state = false;
+#if VFO_ENCODER_PIO
+vfo_input::QuadratureEncoder encoder;
+#endif
+vfo_input::TuningRate tuning;
 
-uint64_t frequency = 7000000;
-// Get the encoder state
-uint8_t read_encoder_state(void)
-{
-    return (gpio_get(ENCODER_DT) > 0 ? 1 : 0) | ((gpio_get(ENCODER_CLK) > 0 ? 1 : 0) << 1);
-}
+// Written by the GPIO and button timer IRQs, drained by the main loop
+vfo_input::InputQueue input_queue;
 
-// Handle the encoder switch
-long long int handle_switch(long int a, void* p)
-{
-    if (gpio_get(ENCODER_SWITCH) == 1 && button_state == false)
-    {
-        // Trigger button press
-        button_pressed = true;
-        button_state = true;
-    }
-    else if (gpio_get(ENCODER_SWITCH) == 0 && button_state == true)
-    {
-        button_state = 0;
-    }
-    return 0;
-}
+vfo_ui::Frequency frequency(7000000);
 
-// Handle the encoder
-void encoder_callback(uint gpio, uint32_t events)
-{
-    if (gpio == ENCODER_SWITCH)
-    {
-        // Debounce the switch
-        add_alarm_in_ms(50, handle_switch, nullptr, true);
-    }
-    else if (gpio == ENCODER_CLK || gpio == ENCODER_DT)
+// Current band and the last frequency used on each
+uint32_t band = vfo_band::find_band(7000000);
+std::array<uint32_t, vfo_band::bands.size()> band_frequency = [] {
+    std::array<uint32_t, vfo_band::bands.size()> f = {};
+    for (uint32_t i = 0; i < f.size(); i++)
     {
-        // Track the pulses on the encoder and turn into a sensible rotary count.
-        static uint8_t saved_enc = 0;
-        uint8_t enc_now, enc_prev;
-
-        enc_now = read_encoder_state();
-        if (enc_now == saved_enc)
-        {
-            return;
-        }
-
-        // swap the state before we return
-        enc_prev = saved_enc;
-        saved_enc = enc_now;
-
-        if ((enc_prev == 2 && enc_now == 3) || (enc_prev == 3 && enc_now == 1) || (enc_prev == 1 && enc_now == 0) || (enc_prev == 0 && enc_now == 2))
-        {
-            encoder_count++;
-        }
-        else if ((enc_prev == 3 && enc_now == 2) || (enc_prev == 2 && enc_now == 0) || (enc_prev == 0 && enc_now == 1) || (enc_prev == 1 && enc_now == 3))
-        {
-            encoder_count--;
-        }
+        f[i] = vfo_band::bands[i].default_hz;
     }
-}
+    return f;
+}();
 
 int main()
 {
+    // Bring-up order is RF first: the synthesizer is programmed as soon as it is
+    // ready, then the radio loop starts (on core 1 with VFO_DUAL_CORE, alongside
+    // the display set-up here), and the display comes last. Devices are polled
+    // for readiness rather than waited for with fixed delays.
     stdio_init_all();
+    vfo_boot::stage_done("stdio");
 
-    // Init i2c0 controller
-    i2c_init(i2c0, 48000);
-
-    // Set up pins 0 and 1 for I2C, pull both up internally
-    gpio_set_function(DISPLAY_CLOCK, GPIO_FUNC_I2C);
-    gpio_set_function(DISPLAY_DATA, GPIO_FUNC_I2C);
-    gpio_pull_up(DISPLAY_CLOCK);
-    gpio_pull_up(DISPLAY_DATA);
-
-    gpio_set_dir(DISPLAY_CLOCK, GPIO_IN);
-    gpio_set_dir(DISPLAY_DATA, GPIO_IN);
+    // Settings from the last session; may erase a flash sector, so before audio starts
+    vfo_settings::init_settings();
+    for (uint32_t i = 0; i < band_frequency.size(); i++)
+    {
+        uint32_t hz = vfo_settings::get_or(vfo_settings::KEY_BAND_FREQUENCY + i, band_frequency[i]);
+        if (vfo_band::find_band(hz) == int(i))
+        {
+            band_frequency[i] = hz;
+        }
+    }
+    band = vfo_settings::get_or(vfo_settings::KEY_BAND, band) % vfo_band::bands.size();
+    uint32_t saved_hz = vfo_settings::get_or(vfo_settings::KEY_FREQUENCY, frequency.hz());
+    frequency = vfo_ui::Frequency(vfo_band::find_band(saved_hz) == int(band) ? saved_hz : band_frequency[band]);
+    vfo_boot::stage_done("settings");
 
-    // Rotary encoder
-    gpio_set_function(ENCODER_SWITCH, GPIO_FUNC_SIO);
-    gpio_set_function(ENCODER_CLK, GPIO_FUNC_SIO);
-    gpio_set_function(ENCODER_DT, GPIO_FUNC_SIO);
+    // Init i2c0 controller on pins 0 and 1, pulled up internally
+    hal_i2c_init(0, 48000, DISPLAY_DATA, DISPLAY_CLOCK);
 
-    gpio_set_dir(ENCODER_CLK, GPIO_IN);
-    gpio_set_dir(ENCODER_DT, GPIO_IN);
-    gpio_set_dir(ENCODER_SWITCH, GPIO_IN);
+    // Initialize the Si5351 once it reports ready; the correction is stored with the settings, 140000 is roughly right
+    bool synth_ok = si5351_init(0x60, SI5351_CRYSTAL_LOAD_8PF, 25000000, int32_t(vfo_settings::get_or(vfo_settings::KEY_CORRECTION, 140000))); // I am using a 25 MHz TCXO
+    vfo_boot::stage_done(synth_ok ? "si5351 ready" : "si5351 not ready");
 
-    gpio_pull_up(ENCODER_CLK);
-    gpio_pull_up(ENCODER_DT);
-    gpio_pull_up(ENCODER_SWITCH);
+    // Just clock 0, and clock 1 once select_band() powers it up with VFO_QUADRATURE; the reset left every output disabled
+    si5351_set_clock_pwr(SI5351_CLK1, 0); // safety first
+    si5351_set_clock_pwr(SI5351_CLK2, 0); // safety first
 
-    gpio_set_irq_enabled_with_callback(ENCODER_CLK, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, &encoder_callback);
-    gpio_set_irq_enabled(ENCODER_DT, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
-    gpio_set_irq_enabled(ENCODER_SWITCH, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+    // Start where we left off; drive strength comes from the band plan
+    vfo_synth::init_synth();
+    vfo_synth::select_band(band, frequency.hz());
+    si5351_output_enable(SI5351_CLK0, 1);
+#if VFO_QUADRATURE
+    // Q for the quadrature detector; select_band() keeps it powered down where there is no pair
+    si5351_output_enable(SI5351_CLK1, 1);
+#endif
+    vfo_boot::stage_done("rf out");
+
+    // Synthesizer, audio and CAT from here on, on core 1 if VFO_DUAL_CORE;
+    // the audio bars show once it reports the output running
+    bool audio_ok = false;
+    vfo_radio::start_radio(band, frequency.hz());
+
+    // Rotary encoder; the switch is sampled by the button timer
+    vfo_input::add_button(ENCODER_SWITCH);
+#if VFO_RX_DEMOD
+    int scope_source = vfo_input::add_button(SCOPE_BUTTON);
+#endif
+    vfo_input::start_buttons(input_queue);
+
+#if VFO_ENCODER_PIO
+    // Quadrature decoded in PIO, CLK and DT are consecutive pins; with every
+    // PIO block taken the pin interrupts decode it instead. Core 1 may still be
+    // setting up the I2S output in start_output(); the encoder keeps out of that
+    // output's PIO block (quadrature.cpp), so there is nothing to wait for
+    static_assert(ENCODER_DT == ENCODER_CLK + 1);
+    if (!encoder.init(ENCODER_CLK, vfo_input::StepMode::Full))
+    {
+        vfo_input::start_encoder(ENCODER_DT, ENCODER_CLK, input_queue);
+        vfo_boot::stage_done("encoder on gpio");
+    }
+#else
+    vfo_input::start_encoder(ENCODER_DT, ENCODER_CLK, input_queue);
+#endif
 
     // LED
-    gpio_init(PICO_DEFAULT_LED_PIN);
-    gpio_set_dir(PICO_DEFAULT_LED_PIN, GPIO_OUT);
+    hal_gpio_output(PICO_DEFAULT_LED_PIN, 0);
 
     // blink();
 
-    // If you don't do anything before initializing a display pi pico is too fast and starts sending
-    // commands before the screen controller had time to set itself up, so we add an artificial delay for
-    // ssd1306 to set itself up
-    sleep_ms(250);
+    // The display controller ignores the bus for a while after power-on; it is
+    // ready once it acknowledges a no-op command
+    bool display_ok = vfo_boot::poll_ready([] {
+        const uint8_t nop[2] = { 0x00, 0xE3 };
+        return hal_i2c_write(0, DISPLAY_ADDRESS, nop, sizeof(nop), false) == sizeof(nop);
+    }, DISPLAY_READY_TIMEOUT_US);
+    vfo_boot::stage_done(display_ok ? "display ready" : "display not ready");
 
-    // Initialize the Si5351; 7Mhz
-    // Calibration to be done later; this is roughly correct
-    si5351_init(0x60, SI5351_CRYSTAL_LOAD_8PF, 25000000, 140000); // I am using a 25 MHz TCXO
-
-    // Just clock 0 for now
-    si5351_set_clock_pwr(SI5351_CLK0, 1); // safety first
-    si5351_set_clock_pwr(SI5351_CLK1, 0); // safety first
-    si5351_set_clock_pwr(SI5351_CLK2, 0); // safety first
-
-    si5351_drive_strength(SI5351_CLK0, SI5351_DRIVE_6MA);
-
-    // Start at the base of 40m band
-    si5351_set_freq(7000000ULL * 100ULL, SI5351_CLK0);
-    si5351_output_enable(SI5351_CLK0, 1);
-    si5351_output_enable(SI5351_CLK1, 0);
-    si5351_output_enable(SI5351_CLK2, 0);
-
-
-    // Create a new display object at address 0x3C and size of 128x64
-    SSD1306 display = SSD1306(i2c0, DISPLAY_ADDRESS, Size::W128xH64);
+    // Create a new display object at address 0x3C and size of 128x64; it stays dark until the first frame
+    SSD1306 display = SSD1306(0, DISPLAY_ADDRESS, Size::W128xH64);
 
     // Here we rotate the display by 180 degrees, so that it's not upside down from my perspective
     // If your screen is upside down try setting it to 1 or 0
     display.setOrientation(0);
-    display.clear();
-    display.sendBuffer();
 
     // Draw text on display
     // After passing a pointer to display, we need to tell the function what font and text to use
@@ -180,21 +181,17 @@ int main()
     // Anchor means top left of what we draw
     std::array<int, 2> rows = { 3, 34 };
 
-    uint32_t currentDigit = 6;
+    // Digit being tuned, as a power of ten (0 = 1 Hz)
+    uint32_t stepPower = vfo_settings::get_or(vfo_settings::KEY_STEP_POWER, 0) % 6;
     uint32_t x_offset = 4;
 
-    sleep_ms(500);
-
-    // Audio
-    bool audio_ok = vfo_audio::start_audio();
-
     auto drawDisplay = [&] {
         // Name of band
         display.clear();
 
         // drawRect(&display, 0, 0, 127, 63);
 
-        drawText(&display, font_12x16, "40 metre", x_offset, 2);
+        drawText(&display, font_12x16, vfo_band::bands[band].name, x_offset, 2);
        
         auto x_bar = 120;
         auto x_bar_width = 6;
@@ -206,65 +203,236 @@ int main()
             fillRect(&display, x_bar, ((x_bar_height + x_bar_gap) * i), x_bar + x_bar_width, x_bar_height + ((x_bar_height + x_bar_gap) * i));
         }
 
-        // Frequency
-        auto str = std::to_string(frequency) + "Mhz";
-        drawText(&display, font_12x16, str.c_str(), x_offset, rows[1]);
+        // Frequency in Hz, grouped in threes
+        char str[16];
+        frequency.format(str, sizeof(str));
+        drawText(&display, font_12x16, str, x_offset, rows[1]);
 
         // Underline for the current counter digit to change
         const uint32_t fontHeight = 16;
         const uint32_t fontWidth = 12;
         uint32_t pad = 1;
-        fillRect(&display, (currentDigit * fontWidth) + pad + x_offset, rows[1] + fontHeight, ((currentDigit + 1) * fontWidth) + x_offset, rows[1] + fontHeight + 2);
+        uint32_t column = frequency.digit_column(stepPower);
+        fillRect(&display, (column * fontWidth) + pad + x_offset, rows[1] + fontHeight, ((column + 1) * fontWidth) + x_offset, rows[1] + fontHeight + 2);
 
         // Send buffer to the display
         display.sendBuffer();
     };
     drawDisplay();
+    vfo_boot::stage_done("display");
+
+    // Leave the current band where it is and tune new_band to hz
+    auto changeBand = [&](uint32_t new_band, uint32_t hz) {
+        band_frequency[band] = frequency.hz();
+        vfo_settings::set(vfo_settings::KEY_BAND_FREQUENCY + band, frequency.hz());
+
+        band = new_band;
+        frequency = vfo_ui::Frequency(hz);
+        stepPower = vfo_band::bands[band].step_power;
+        vfo_settings::set(vfo_settings::KEY_BAND, band);
+        vfo_settings::set(vfo_settings::KEY_FREQUENCY, frequency.hz());
+        vfo_settings::set(vfo_settings::KEY_STEP_POWER, stepPower);
+    };
+
+    // Numbers the tune requests, so the radio state says which ones it has caught up with
+    uint32_t request_seq = 0;
+
+    // A finished analysis (CAT ZA;) holds the screen until the next input
+    static vfo_analyzer::Curve analysis;
+    bool showing_analysis = false;
+
+    // The waterfall takes the whole screen until the scope button is clicked again
+    bool showing_waterfall = false;
+#if VFO_RX_DEMOD
+    vfo_scope::Waterfall waterfall;
+#endif
 
     while (true)
     {
         // When the encoder ticks, advance
-        bool update_clock = false;
+        bool request_tune = false;
         bool update_display = false;
 
-        if (abs(encoder_count) > 2)
+        int32_t count = 0;
+        uint32_t count_time = hal_time_us();
+        int32_t digit_move = 0;
+        int32_t band_move = 0;
+        bool scope_click = false;
+#if VFO_ENCODER_PIO
+        count = -encoder.take_steps();
+#endif
+        vfo_input::InputEvent event;
+        while (input_queue.pop(event))
         {
-            auto count = -encoder_count / 2;
-            frequency += (count * pow(10, (6 - currentDigit)));
-            encoder_count = 0;
-            update_clock = true;
-            update_display = true;
+#if VFO_RX_DEMOD
+            if (event.type != vfo_input::InputEventType::Rotate && event.source == scope_source)
+            {
+                scope_click |= event.type == vfo_input::InputEventType::Click;
+                continue;
+            }
+#endif
+            switch (event.type)
+            {
+            case vfo_input::InputEventType::Rotate:
+                count -= event.value;
+                count_time = event.time_us;
+                break;
+            case vfo_input::InputEventType::Click:
+                digit_move++;
+                break;
+            case vfo_input::InputEventType::DoubleClick:
+                digit_move--;
+                break;
+            case vfo_input::InputEventType::LongPress:
+                band_move++;
+                break;
+            default:
+                break;
+            }
+        }
+        bool had_input = count != 0 || digit_move != 0 || band_move != 0 || scope_click;
+
+        if (count != 0)
+        {
+            TRACE(TRACE_PICKUP, count);
 
-            frequency = std::clamp(frequency, 7000000ull, 7200000ull);
+            // Faster spins take bigger steps
+            uint32_t multiplier = tuning.update(count, count_time);
+            const vfo_band::Band& b = vfo_band::bands[band];
+            frequency.step(vfo_ui::pow10[stepPower] * multiplier, count, b.low_hz, b.high_hz, multiplier > 1);
+            request_tune = true;
         }
 
-        // Encoder button pressed, choose the next unit to change
-        if (button_pressed)
+        // Encoder button clicked, choose the next unit to change; double click goes back
+        if (digit_move != 0)
         {
-            currentDigit++;
-            if (currentDigit > 6)
+            stepPower = uint32_t(int32_t(stepPower) - digit_move % 6 + 6) % 6;
+            vfo_settings::set(vfo_settings::KEY_STEP_POWER, stepPower);
+            update_display = true;
+        }
+
+        // Long press moves to the next band, where we left it
+        if (band_move != 0)
+        {
+            uint32_t next = band;
+            while (band_move-- > 0)
             {
-                currentDigit = 1;
+                next = vfo_band::band_up(next);
             }
-            button_pressed = false;
+            changeBand(next, band_frequency[next]);
+            request_tune = true;
+        }
+
+        // The radio applies the newest request; the display goes ahead without waiting for it
+        if (request_tune)
+        {
+            vfo_link::tune_requests.publish({ ++request_seq, count_time, frequency.hz(), uint8_t(band) });
+            vfo_link::wake_radio();
+            vfo_settings::set(vfo_settings::KEY_FREQUENCY, frequency.hz());
             update_display = true;
         }
 
-        // Update the clock
-        if (update_clock)
+#if !VFO_DUAL_CORE
+        vfo_radio::service();
+#endif
+
+        // Follow the radio, which CAT can tune as well. Until it has caught up
+        // with every request sent, the dial is ahead of it and stays as it is.
+        vfo_link::RadioState radio;
+        if (vfo_link::radio_state.take(radio))
+        {
+            if (radio.request_seq == request_seq && (radio.band != band || radio.hz != frequency.hz()))
+            {
+                if (radio.band != band)
+                {
+                    changeBand(radio.band, radio.hz);
+                }
+                frequency = vfo_ui::Frequency(radio.hz);
+                vfo_settings::set(vfo_settings::KEY_FREQUENCY, frequency.hz());
+                update_display = true;
+            }
+            if (radio.audio_ok != audio_ok)
+            {
+                audio_ok = radio.audio_ok;
+                update_display = true;
+            }
+        }
+
+#if VFO_RX_DEMOD
+        // Into the waterfall from a blank screen scrolled back to the top, and
+        // out of it with the start line put back for the main screen
+        if (scope_click)
+        {
+            showing_waterfall = !showing_waterfall;
+            waterfall = {};
+            display.setStartLine(waterfall.start_line());
+            if (showing_waterfall)
+            {
+                display.clear();
+                display.sendBuffer();
+            }
+            update_display = !showing_waterfall;
+        }
+#endif
+
+        if (vfo_analyzer::curves.take(analysis))
         {
-            si5351_set_freq(frequency * 100ULL, SI5351_CLK0);
+            // An analysis takes over from the waterfall too
+            if (showing_waterfall)
+            {
+                display.setStartLine(0);
+                showing_waterfall = false;
+            }
+            vfo_analyzer::draw_curve(display, analysis);
+            showing_analysis = true;
+        }
+        else if (showing_analysis && had_input)
+        {
+            showing_analysis = false;
+            update_display = true;
         }
 
         // Update the display
-        if (update_display)
+        if (update_display && !showing_analysis && !showing_waterfall)
         {
             drawDisplay();
         }
 
-        // Back off, just a bit
-        //sleep_ms(1);
-        vfo_audio::update_audio_buffer();
+        absolute_time_t deadline = at_the_end_of_time;
+#if VFO_RX_DEMOD
+        // Band-scope strip along the bottom page, or a waterfall row, ~20 frames
+        // a second; once due, the next WAKE_SCOPE from core 1 draws it
+        static absolute_time_t next_scope = nil_time;
+        if (!time_reached(next_scope))
+        {
+            deadline = next_scope;
+        }
+        else if (const int16_t* iq = vfo_demod::peek_scope_frames())
+        {
+            if (showing_waterfall)
+            {
+                vfo_scope::draw_waterfall(display, waterfall, iq);
+            }
+            else
+            {
+                vfo_scope::draw_spectrum_strip(display, iq, 7, 1);
+            }
+            vfo_demod::release_scope_frames();
+            next_scope = make_timeout_time_ms(50);
+            deadline = next_scope;
+        }
+#endif
+
+        // Saved once the dial has been left alone; a sector erase waits a while for silence
+        vfo_settings::service(vfo_audio::is_output_silent());
+        absolute_time_t settings_due = vfo_settings::next_service_time();
+        if (absolute_time_diff_us(settings_due, deadline) > 0)
+        {
+            deadline = settings_due;
+        }
+
+        // Sleep until an IRQ, the radio or the deadline has something for us
+        vfo_loop::wait_for_wake(vfo_loop::LOOP_MAIN, deadline);
     }
 
     reset_usb_boot(0, 0);
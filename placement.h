@@ -0,0 +1,43 @@
+#pragma once
+
+// Code and tables that must not wait on the XIP flash cache: the interrupt
+// handlers, the audio block fill and the tuning maths.
+//
+// With VFO_RAM_HOT the functions marked HOT_FUNC and the tables marked
+// HOT_DATA go to .time_critical.<name> sections. The SDK's default linker
+// script copies those to SRAM with .data at boot, so they run and read at
+// SRAM speed whatever the display drawing or a flash program did to the
+// cache. The build writes VFO.placement.txt listing every such section, its
+// address and its size (placement_report.cmake).
+//
+// Everywhere else, and with VFO_RAM_HOT=0, the markings are empty.
+// C compatible, so si5351.c marks its maths too.
+//
+//   void HOT_FUNC(encoder_callback)(uint gpio, uint32_t events) { ... }
+//   const uint8_t table[16] HOT_DATA("keyer") = { ... };
+//
+// A table defined in a header (an inline variable) needs a group of its own:
+// the linker keeps one copy of each group, not of each variable. No group may
+// be named after a HOT_FUNC function either, or code and data share a section
+// and GCC stops with a section type conflict.
+//
+// Only the marked function moves: anything it calls that is not inlined or
+// marked as well (SDK drivers, libgcc's 64-bit division) still runs from flash.
+
+#ifndef VFO_RAM_HOT
+#define VFO_RAM_HOT 0
+#endif
+
+#if VFO_RAM_HOT && PICO_ON_DEVICE
+
+#include "pico.h"
+
+#define HOT_FUNC(name) __not_in_flash_func(name)
+#define HOT_DATA(group) __not_in_flash(group)
+
+#else
+
+#define HOT_FUNC(name) name
+#define HOT_DATA(group)
+
+#endif
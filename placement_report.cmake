@@ -0,0 +1,121 @@
+# Where the firmware's code and tables ended up, read from the linker map.
+#
+#   cmake -DMAP=VFO.elf.map -DOUT=VFO.placement.txt -P placement_report.cmake
+#
+# Lists every .time_critical.* input section (what placement.h marks, plus the
+# SDK's own) with its SRAM address, size and object file, then the size of
+# each output section and whether it runs from flash or SRAM. Run after each
+# link of the firmware; prints a one-line summary.
+
+if(NOT MAP OR NOT OUT)
+    message(FATAL_ERROR "usage: cmake -DMAP=<file.map> -DOUT=<report.txt> -P placement_report.cmake")
+endif()
+
+file(READ ${MAP} map)
+
+# The discarded input sections come first; only what follows was linked
+string(FIND "${map}" "Linker script and memory map" start)
+if(start LESS 0)
+    message(FATAL_ERROR "${MAP} is not a GNU ld map")
+endif()
+string(SUBSTRING "${map}" ${start} -1 map)
+
+# RP2350 address map: XIP flash, then SRAM (including the scratch banks)
+function(region address result)
+    math(EXPR value "${address}" OUTPUT_FORMAT DECIMAL)
+    if(value GREATER_EQUAL 536870912) # 0x20000000
+        set(${result} "SRAM" PARENT_SCOPE)
+    elseif(value GREATER_EQUAL 268435456) # 0x10000000
+        set(${result} "flash" PARENT_SCOPE)
+    else()
+        set(${result} "" PARENT_SCOPE)
+    endif()
+endfunction()
+
+function(pad text width result)
+    string(LENGTH "${text}" len)
+    if(len LESS width)
+        math(EXPR fill "${width} - ${len}")
+        string(REPEAT " " ${fill} spaces)
+        set(text "${text}${spaces}")
+    endif()
+    set(${result} "${text}" PARENT_SCOPE)
+endfunction()
+
+function(pad_left text width result)
+    string(LENGTH "${text}" len)
+    if(len LESS width)
+        math(EXPR fill "${width} - ${len}")
+        string(REPEAT " " ${fill} spaces)
+        set(text "${spaces}${text}")
+    endif()
+    set(${result} "${text}" PARENT_SCOPE)
+endfunction()
+
+# Input sections; a long section name puts the address on the next line
+set(hot_pattern "\n \\.time_critical\\.([^ \t\n]+)[ \t\n]+(0x[0-9a-fA-F]+)[ \t]+(0x[0-9a-fA-F]+)[ \t]+([^\n]+)")
+string(REGEX MATCHALL "${hot_pattern}" entries "${map}")
+
+get_filename_component(elf ${MAP} NAME_WE)
+set(report "Placement of ${elf}, from ${MAP}\n\nCopied to SRAM at boot (.time_critical.*):\n")
+set(hot_count 0)
+set(hot_bytes 0)
+set(hot_flash 0)
+foreach(entry IN LISTS entries)
+    string(REGEX MATCH "${hot_pattern}" entry "${entry}")
+    set(name ${CMAKE_MATCH_1})
+    set(address ${CMAKE_MATCH_2})
+    math(EXPR size "${CMAKE_MATCH_3}" OUTPUT_FORMAT DECIMAL)
+    get_filename_component(object "${CMAKE_MATCH_4}" NAME)
+    if(size EQUAL 0)
+        continue()
+    endif()
+
+    region(${address} where)
+    if(NOT where STREQUAL "SRAM")
+        # A custom linker script without the SDK's .time_critical rule
+        set(name "${name} (NOT IN SRAM)")
+        math(EXPR hot_flash "${hot_flash} + 1")
+    endif()
+    math(EXPR hot_count "${hot_count} + 1")
+    math(EXPR hot_bytes "${hot_bytes} + ${size}")
+
+    pad_left(${size} 7 size_text)
+    pad("${name}" 40 name_text)
+    string(APPEND report "  ${address} ${size_text}  ${name_text} ${object}\n")
+endforeach()
+string(APPEND report "  ${hot_count} sections, ${hot_bytes} bytes\n\nOutput sections:\n")
+
+# Output sections start in the first column; debug sections sit at address 0
+set(section_pattern "\n(\\.[A-Za-z0-9_.]+)[ \t\n]+(0x[0-9a-fA-F]+)[ \t]+(0x[0-9a-fA-F]+)")
+string(REGEX MATCHALL "${section_pattern}" sections "${map}")
+set(totals_flash 0)
+set(totals_sram 0)
+foreach(section IN LISTS sections)
+    string(REGEX MATCH "${section_pattern}" section "${section}")
+    set(name ${CMAKE_MATCH_1})
+    set(address ${CMAKE_MATCH_2})
+    math(EXPR size "${CMAKE_MATCH_3}" OUTPUT_FORMAT DECIMAL)
+    region(${address} where)
+    if(size EQUAL 0 OR where STREQUAL "")
+        continue()
+    endif()
+
+    if(where STREQUAL "SRAM")
+        math(EXPR totals_sram "${totals_sram} + ${size}")
+    else()
+        math(EXPR totals_flash "${totals_flash} + ${size}")
+    endif()
+
+    pad("${name}" 24 name_text)
+    pad("${where}" 6 where_text)
+    pad_left(${size} 8 size_text)
+    string(APPEND report "  ${name_text} ${where_text} ${address} ${size_text}\n")
+endforeach()
+string(APPEND report "  flash ${totals_flash} bytes, SRAM ${totals_sram} bytes; .data (with the hot sections) is loaded from flash too\n")
+
+file(WRITE ${OUT} "${report}")
+message(STATUS "${OUT}: ${hot_count} sections, ${hot_bytes} bytes run from SRAM; flash ${totals_flash}, SRAM ${totals_sram}")
+if(hot_flash GREATER 0)
+    message(WARNING "${OUT}: ${hot_flash} .time_critical sections are not in SRAM")
+endif()
@@ -0,0 +1,100 @@
+#include "quadrature.h"
+#include "quadrature_encoder.pio.h"
+
+#include "event_loop.h"
+#include "hardware/irq.h"
+#include "pico/audio_i2s.h"
+#include "placement.h"
+#include "trace.h"
+
+namespace vfo_input
+{
+
+// The I2S output (pico-extras) claims a state machine in this block and loads
+// its program there, and panics if either is taken. Core 1 may be starting it
+// while the encoder is set up, so the encoder never looks in that block.
+#ifndef PICO_AUDIO_I2S_PIO
+#define PICO_AUDIO_I2S_PIO 0
+#endif
+static_assert(PICO_AUDIO_I2S_PIO < NUM_PIOS, "the audio output's PIO block must exist");
+
+QuadratureEncoder* QuadratureEncoder::irq_encoders[NUM_PIOS] = {};
+
+void HOT_FUNC(QuadratureEncoder::pio_irq)()
+{
+    for (QuadratureEncoder* encoder : irq_encoders)
+    {
+        if (encoder == nullptr || pio_sm_is_rx_fifo_empty(encoder->pio, encoder->sm))
+        {
+            continue;
+        }
+
+        // Only the newest count matters
+        int32_t count = 0;
+        while (!pio_sm_is_rx_fifo_empty(encoder->pio, encoder->sm))
+        {
+            count = int32_t(pio_sm_get(encoder->pio, encoder->sm));
+        }
+        encoder->latest.store(count, std::memory_order_relaxed);
+        TRACE(TRACE_ENCODER, count);
+        vfo_loop::post_wake(vfo_loop::WAKE_INPUT);
+    }
+}
+
+bool QuadratureEncoder::init(uint pin_a, StepMode m)
+{
+    // The jump table means the program has to sit at offset 0
+#if NUM_PIOS > 2
+    for (PIO p : { pio0, pio1, pio2 })
+#else
+    for (PIO p : { pio0, pio1 })
+#endif
+    {
+        if (pio_get_index(p) == PICO_AUDIO_I2S_PIO
+            || !pio_can_add_program_at_offset(p, &quadrature_encoder_program, 0))
+        {
+            continue;
+        }
+        int claimed = pio_claim_unused_sm(p, false);
+        if (claimed < 0)
+        {
+            continue;
+        }
+        pio_add_program_at_offset(p, &quadrature_encoder_program, 0);
+        pio = p;
+        sm = uint(claimed);
+        break;
+    }
+    if (pio == nullptr)
+    {
+        return false;
+    }
+
+    mode = m;
+    latest = 0;
+    consumed = 0;
+    quadrature_encoder_program_init(pio, sm, pin_a, QUADRATURE_SAMPLE_HZ);
+
+    // RX FIFO not empty raises IRQ 0 of this PIO block
+    irq_encoders[pio_get_index(pio)] = this;
+    uint irq = pio_get_irq_num(pio, 0);
+    irq_add_shared_handler(irq, pio_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    pio_set_irqn_source_enabled(pio, 0, pio_get_rx_fifo_not_empty_interrupt_source(sm), true);
+    irq_set_enabled(irq, true);
+    return true;
+}
+
+int32_t QuadratureEncoder::edges()
+{
+    return latest.load(std::memory_order_relaxed);
+}
+
+int32_t QuadratureEncoder::take_steps()
+{
+    int32_t per_step = int32_t(mode);
+    int32_t steps = (edges() - consumed) / per_step;
+    consumed += steps * per_step;
+    return steps;
+}
+
+} // namespace vfo_input
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#include "hardware/pio.h"
+
+// Rotary encoder decoded by a PIO state machine (quadrature_encoder.pio).
+// The state machine counts every quadrature edge and pushes the count when it
+// changes. A short PIO IRQ keeps the newest count in an atomic and wakes the
+// main loop, so reading the count needs no lock.
+namespace vfo_input
+{
+
+#define QUADRATURE_SAMPLE_HZ 1000000
+
+enum class StepMode : uint8_t
+{
+    Full = 4, // One step per full quadrature cycle (one detent on most encoders)
+    Half = 2, // One step per half cycle, for encoders with a detent at both stable states
+    Quarter = 1 // Every edge
+};
+
+class QuadratureEncoder
+{
+public:
+    // pin_a is A (CLK); B (DT) must be on pin_a + 1. Returns false if no PIO
+    // block other than the audio output's has both a free state machine and
+    // room at offset 0. One encoder per PIO block.
+    bool init(uint pin_a, StepMode mode);
+
+    void set_mode(StepMode m)
+    {
+        mode = m;
+    }
+
+    // Raw edge count since init
+    int32_t edges();
+
+    // Whole steps since the last call; partial steps carry over
+    int32_t take_steps();
+
+private:
+    PIO pio = nullptr;
+    uint sm = 0;
+    StepMode mode = StepMode::Full;
+    std::atomic<int32_t> latest = 0;
+    int32_t consumed = 0;
+
+    static void pio_irq();
+    static QuadratureEncoder* irq_encoders[NUM_PIOS];
+};
+
+} // namespace vfo_input
@@ -0,0 +1,265 @@
+#include "radio.h"
+
+#include <cstdio>
+
+#include "analyzer.h"
+#include "audio.h"
+#include "band_plan.h"
+#include "boot.h"
+#include "cat.h"
+#include "core_link.h"
+#include "demod.h"
+#include "event_loop.h"
+#include "hal.h"
+#include "keyer.h"
+#include "spectrum.h"
+#include "sweep.h"
+#include "synth.h"
+#include "trace.h"
+
+#include "pico/stdio.h"
+#if VFO_DUAL_CORE
+#include "pico/flash.h"
+#include "pico/multicore.h"
+#endif
+
+#if VFO_RX_DEMOD && !VFO_DUAL_CORE
+#error "The demodulator needs the radio loop on its own core (VFO_DUAL_CORE)"
+#endif
+
+namespace vfo_radio
+{
+
+namespace
+{
+
+vfo_cat::CatParser cat;
+vfo_link::RadioState state = {};
+RadioStats stats = {};
+
+void set_mode(vfo_band::Mode mode)
+{
+    state.mode = mode;
+#if VFO_RX_DEMOD
+    vfo_demod::set_sideband(mode == vfo_band::Mode::LSB ? vfo_demod::Sideband::LSB : vfo_demod::Sideband::USB);
+#endif
+}
+
+// A new band brings its own mode; only PLLA moves within a band.
+// During a sweep CLK0 is the sweep's: only the state moves, and the end of the
+// sweep tunes to it.
+void tune(uint32_t band, uint32_t hz)
+{
+    if (vfo_sweep::active())
+    {
+        if (band != state.band)
+        {
+            state.band = uint8_t(band);
+            set_mode(vfo_band::bands[band].mode);
+        }
+        state.hz = hz;
+        return;
+    }
+
+    if (band != state.band)
+    {
+        vfo_synth::select_band(band, hz);
+        state.band = uint8_t(band);
+        set_mode(vfo_band::bands[band].mode);
+        stats.band_changes++;
+    }
+    else if (hz != state.hz)
+    {
+        vfo_synth::set_frequency(hz);
+        stats.retunes++;
+    }
+    state.hz = hz;
+}
+
+// After the trace dump, for the same capture
+void print_stats()
+{
+    vfo_link::LinkStats link = vfo_link::get_link_stats();
+    hal_i2c_stats_t bus = hal_i2c_get_stats(0);
+    char line[160];
+    int len = snprintf(line, sizeof(line),
+        "#L requests %lu coalesced %lu states %lu coalesced %lu apply_us %lu max %lu i2c %lu waits %lu max_wait_us %lu",
+        (unsigned long)link.requests, (unsigned long)link.requests_coalesced, (unsigned long)link.states,
+        (unsigned long)link.states_coalesced, (unsigned long)link.apply_last_us, (unsigned long)link.apply_max_us,
+        (unsigned long)bus.transfers, (unsigned long)bus.waits, (unsigned long)bus.max_wait_us);
+    stdio_put_string(line, len, true, false);
+
+    // How each loop sleeps; the radio loop only waits on its own with VFO_DUAL_CORE
+    for (vfo_loop::Loop loop : { vfo_loop::LOOP_MAIN, vfo_loop::LOOP_RADIO })
+    {
+        vfo_loop::LoopStats wake = vfo_loop::get_loop_stats(loop);
+        len = snprintf(line, sizeof(line), "#W %s wakes %lu timeouts %lu spurious %lu active_permille %lu",
+            loop == vfo_loop::LOOP_MAIN ? "main" : "radio", (unsigned long)wake.wakes, (unsigned long)wake.timeouts,
+            (unsigned long)wake.spurious, (unsigned long)vfo_loop::get_active_permille(loop));
+        stdio_put_string(line, len, true, false);
+    }
+
+#if VFO_RX_DEMOD
+    // Headroom is what the slowest block left of the time its samples took to arrive
+    vfo_demod::DemodStats demod = vfo_demod::get_demod_stats();
+    uint32_t headroom = demod.max_us < demod.budget_us ? (demod.budget_us - demod.max_us) * 1000 / demod.budget_us : 0;
+    len = snprintf(line, sizeof(line), "#D blocks %lu last_us %lu max_us %lu budget_us %lu headroom_permille %lu stalls %lu",
+        (unsigned long)demod.blocks, (unsigned long)demod.last_us, (unsigned long)demod.max_us,
+        (unsigned long)demod.budget_us, (unsigned long)headroom, (unsigned long)demod.output_stalls);
+    stdio_put_string(line, len, true, false);
+
+    // The band-scope's last frame, drawn by the main loop
+    vfo_scope::ScopeStats scope = vfo_scope::get_scope_stats();
+    len = snprintf(line, sizeof(line), "#S frames %lu fft_us %lu render_us %lu send_us %lu",
+        (unsigned long)scope.frames, (unsigned long)scope.fft_us, (unsigned long)scope.render_us,
+        (unsigned long)scope.send_us);
+    stdio_put_string(line, len, true, false);
+#endif
+}
+
+void start_output()
+{
+    state.audio_ok = vfo_audio::start_audio();
+    vfo_boot::stage_done(state.audio_ok ? "audio" : "audio failed");
+    set_mode(state.mode);
+    // Whichever loop tops the output up has to wake when a buffer comes back
+    if (state.audio_ok)
+    {
+        vfo_loop::enable_audio_wake();
+#if VFO_RX_DEMOD
+        vfo_demod::start_demod();
+#endif
+    }
+
+    // CAT control over the USB serial port
+    vfo_cat::start_cat();
+    cat.update_rig(state.hz, state.mode);
+    cat.update_keyer(vfo_audio::get_keyer().get_wpm(), vfo_audio::get_keyer().get_mode());
+    vfo_link::radio_state.publish(state);
+    vfo_loop::post_wake(vfo_loop::WAKE_RADIO);
+}
+
+#if VFO_DUAL_CORE
+void core1_main()
+{
+    // Lets core 0 park this core while it programs the settings flash
+    flash_safe_execute_core_init();
+
+    // Started here so the I2S and capture DMA interrupts are serviced by this core,
+    // and wake it from WFE
+    start_output();
+
+    while (true)
+    {
+        if (!service())
+        {
+            vfo_loop::wait_for_wake(vfo_loop::LOOP_RADIO, at_the_end_of_time);
+        }
+    }
+}
+#endif
+
+} // namespace
+
+void start_radio(uint32_t band, uint32_t hz)
+{
+    state.band = uint8_t(band);
+    state.hz = hz;
+    state.mode = vfo_band::bands[band].mode;
+
+#if VFO_DUAL_CORE
+    multicore_launch_core1(core1_main);
+#else
+    start_output();
+#endif
+}
+
+bool service()
+{
+    bool changed = false;
+
+    vfo_link::TuneRequest request;
+    if (vfo_link::tune_requests.take(request))
+    {
+        tune(request.band, request.hz);
+        state.request_seq = request.seq;
+        vfo_link::note_applied(request);
+        changed = true;
+    }
+
+    // CAT commands; frequencies outside the band plan are ignored
+    vfo_cat::poll_cat(cat);
+    vfo_cat::CatRequest cat_request;
+    if (cat.take_request(cat_request))
+    {
+        int target = cat_request.set_frequency ? vfo_band::find_band(cat_request.frequency_hz) : -1;
+        if (target >= 0)
+        {
+            tune(uint32_t(target), cat_request.frequency_hz);
+            changed = true;
+        }
+        else if (cat_request.set_frequency)
+        {
+            // Refused: the parser already answers FA; with the value it was sent
+            cat.update_rig(state.hz, state.mode);
+        }
+        if (cat_request.set_mode)
+        {
+            set_mode(cat_request.mode);
+            changed = true;
+        }
+        // The keyer runs in the audio fill, which is this loop's too
+        if (cat_request.set_keyer)
+        {
+            vfo_audio::Keyer& keyer = vfo_audio::get_keyer();
+            keyer.set_wpm(cat_request.keyer_wpm);
+            keyer.set_mode(cat_request.keyer_mode);
+        }
+        if (cat_request.dump_trace)
+        {
+            vfo_trace::dump();
+            print_stats();
+            vfo_boot::report();
+        }
+        if (cat_request.analyze)
+        {
+            const vfo_band::Band& b = vfo_band::bands[state.band];
+            vfo_analyzer::start(b.low_hz, b.high_hz, ANALYZER_POINTS);
+        }
+    }
+
+    if (changed)
+    {
+        cat.update_rig(state.hz, state.mode);
+        vfo_link::radio_state.publish(state);
+        vfo_loop::post_wake(vfo_loop::WAKE_RADIO);
+    }
+
+    bool busy = changed;
+    if (vfo_sweep::active())
+    {
+        busy |= vfo_sweep::service();
+        if (!vfo_sweep::active())
+        {
+            vfo_synth::select_band(state.band, state.hz);
+            vfo_analyzer::report();
+        }
+    }
+#if VFO_RX_DEMOD
+    busy |= vfo_demod::service_demod();
+#else
+    vfo_audio::update_audio_buffer();
+#endif
+    if (busy)
+    {
+        stats.passes++;
+    }
+    return busy;
+}
+
+RadioStats get_radio_stats()
+{
+    return stats;
+}
+
+} // namespace vfo_radio
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+// The real-time side of the VFO: the Si5351, the audio output (or the
+// demodulator) and CAT. It owns the tuned frequency, band and mode; the user
+// interface asks for changes through vfo_link::tune_requests and follows
+// vfo_link::radio_state (core_link.h).
+//
+// With VFO_DUAL_CORE this runs on core 1 and sleeps in WFE between passes;
+// otherwise the main loop calls service() on every pass.
+namespace vfo_radio
+{
+
+struct RadioStats
+{
+    uint32_t passes; // Passes of the radio loop that found work
+    uint32_t retunes;
+    uint32_t band_changes;
+};
+
+// Start the radio at band and hz, which the synthesizer is already set to (vfo_synth::select_band)
+void start_radio(uint32_t band, uint32_t hz);
+
+// Apply the newest tune request and any CAT commands, top up the audio and
+// publish the state if it changed. Returns false if there was nothing to do.
+bool service();
+
+RadioStats get_radio_stats();
+
+} // namespace vfo_radio
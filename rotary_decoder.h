@@ -0,0 +1,107 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "placement.h"
+
+// Table-driven rotary encoder decoder, ported from Ben Buxton's Arduino rotary
+// library (Copyright 2011 Ben Buxton, GPL v3).
+//
+// Each row is a decoder state and each column the new pin code (B << 1 | A).
+// The next state comes from a single lookup per edge. A step is emitted only
+// after the complete Gray code sequence, so contact bounce just moves back and
+// forth between sub-states, and an illegal jump (EMI, a missed edge) drops
+// back to the start state without emitting anything.
+namespace vfo_input
+{
+
+namespace detail
+{
+
+enum : uint8_t
+{
+    R_START = 0x0,
+    DIR_CW = 0x10,
+    DIR_CCW = 0x20
+};
+
+using RotaryTable = std::array<std::array<uint8_t, 4>, 8>;
+
+// One step per detent, emitted when the code returns to 11
+constexpr RotaryTable make_full_step_table()
+{
+    constexpr uint8_t R_CW_FINAL = 0x1, R_CW_BEGIN = 0x2, R_CW_NEXT = 0x3;
+    constexpr uint8_t R_CCW_BEGIN = 0x4, R_CCW_FINAL = 0x5, R_CCW_NEXT = 0x6;
+    return { {
+        // 00          01           10           11
+        { R_START, R_CW_BEGIN, R_CCW_BEGIN, R_START }, // R_START
+        { R_CW_NEXT, R_START, R_CW_FINAL, R_START | DIR_CW }, // R_CW_FINAL
+        { R_CW_NEXT, R_CW_BEGIN, R_START, R_START }, // R_CW_BEGIN
+        { R_CW_NEXT, R_CW_BEGIN, R_CW_FINAL, R_START }, // R_CW_NEXT
+        { R_CCW_NEXT, R_START, R_CCW_BEGIN, R_START }, // R_CCW_BEGIN
+        { R_CCW_NEXT, R_CCW_FINAL, R_START, R_START | DIR_CCW }, // R_CCW_FINAL
+        { R_CCW_NEXT, R_CCW_FINAL, R_CCW_BEGIN, R_START }, // R_CCW_NEXT
+        { R_START, R_START, R_START, R_START } // unused
+    } };
+}
+
+// Two steps per detent, emitted at both 00 and 11
+constexpr RotaryTable make_half_step_table()
+{
+    constexpr uint8_t R_CCW_BEGIN = 0x1, R_CW_BEGIN = 0x2, R_START_M = 0x3;
+    constexpr uint8_t R_CW_BEGIN_M = 0x4, R_CCW_BEGIN_M = 0x5;
+    return { {
+        // 00                  01              10            11
+        { R_START_M, R_CW_BEGIN, R_CCW_BEGIN, R_START }, // R_START
+        { R_START_M | DIR_CCW, R_START, R_CCW_BEGIN, R_START }, // R_CCW_BEGIN
+        { R_START_M | DIR_CW, R_CW_BEGIN, R_START, R_START }, // R_CW_BEGIN
+        { R_START_M, R_CCW_BEGIN_M, R_CW_BEGIN_M, R_START }, // R_START_M
+        { R_START_M, R_START_M, R_CW_BEGIN_M, R_START | DIR_CW }, // R_CW_BEGIN_M
+        { R_START_M, R_CCW_BEGIN_M, R_START_M, R_START | DIR_CCW }, // R_CCW_BEGIN_M
+        { R_START, R_START, R_START, R_START }, // unused
+        { R_START, R_START, R_START, R_START } // unused
+    } };
+}
+
+// Read on every encoder edge, so they go to SRAM with the encoder IRQ
+inline constexpr RotaryTable full_step_table HOT_DATA("rotary_full") = make_full_step_table();
+inline constexpr RotaryTable half_step_table HOT_DATA("rotary_half") = make_half_step_table();
+
+// Emit bits (state >> 4) to a signed step
+inline constexpr std::array<int8_t, 4> step_value HOT_DATA("rotary_step") = { 0, 1, -1, 0 };
+
+} // namespace detail
+
+// One decoder per encoder; any number can share the same GPIO callback.
+class RotaryDecoder
+{
+public:
+    // pin_a/pin_b are the GPIOs read as bit 0 and bit 1 of the code. With
+    // A = DT and B = CLK, +1 is clockwise on the usual pull-up wiring.
+    constexpr RotaryDecoder(uint8_t pin_a, uint8_t pin_b, bool half_step = false)
+        : table(half_step ? &detail::half_step_table : &detail::full_step_table), pin_a(pin_a), pin_b(pin_b)
+    {
+    }
+
+    bool uses_pin(uint32_t gpio) const
+    {
+        return gpio == pin_a || gpio == pin_b;
+    }
+
+    // Feed the current pin levels (gpio_get_all()) on any edge of either pin.
+    // Returns +1, -1 or 0.
+    int8_t process(uint32_t pins)
+    {
+        uint32_t code = ((pins >> pin_a) & 1) | (((pins >> pin_b) & 1) << 1);
+        state = (*table)[state & 0x7][code];
+        return detail::step_value[state >> 4];
+    }
+
+private:
+    const detail::RotaryTable* table;
+    uint8_t pin_a;
+    uint8_t pin_b;
+    uint8_t state = detail::R_START;
+};
+
+} // namespace vfo_input
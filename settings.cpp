@@ -0,0 +1,414 @@
+#include "settings.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "hardware/flash.h"
+#include "pico/flash.h"
+#include "pico/stdlib.h"
+
+namespace vfo_settings
+{
+
+namespace
+{
+
+#define SETTINGS_MAGIC 0x5E77
+#define SETTINGS_FLASH_TIMEOUT_MS 100 // Waiting for core 1 to park before touching flash
+
+constexpr uint32_t region_offset = PICO_FLASH_SIZE_BYTES - SETTINGS_SECTORS * FLASH_SECTOR_SIZE;
+
+// One log entry; an erased slot reads as all ones
+struct Record
+{
+    uint16_t magic;
+    uint16_t key;
+    uint32_t value;
+    uint32_t spare; // Zero
+    uint32_t crc; // CRC-32 of the fields above
+};
+static_assert(sizeof(Record) == 16 && FLASH_PAGE_SIZE % sizeof(Record) == 0);
+
+constexpr uint32_t slots_per_sector = FLASH_SECTOR_SIZE / sizeof(Record);
+constexpr uint32_t slots_per_page = FLASH_PAGE_SIZE / sizeof(Record);
+static_assert(KEY_CHANNEL + SETTINGS_CHANNELS <= 0xFFFF && SETTINGS_MAX_KEYS + 1 < slots_per_sector);
+
+struct Entry
+{
+    uint16_t key;
+    bool dirty;
+    uint32_t value;
+};
+
+Entry cache[SETTINGS_MAX_KEYS];
+uint32_t cache_count = 0;
+bool dirty = false;
+uint64_t changed_us = 0;
+
+uint32_t active_sector = 0;
+uint32_t sequence = 0; // Header value of the active sector
+uint32_t next_slot = 0; // First erased slot in the active sector
+bool spare_erased = false; // Sector after the active one is ready for the next rotation
+uint64_t deferred_us = 0; // When commits started waiting for that, or 0
+
+// Records waiting to be programmed; kept off the stack
+Record staging[SETTINGS_MAX_KEYS];
+
+SettingsStats stats = {};
+
+uint32_t crc32(const uint8_t* data, uint32_t length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (length--)
+    {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+Record make_record(uint16_t key, uint32_t value)
+{
+    Record r = { SETTINGS_MAGIC, key, value, 0, 0 };
+    r.crc = crc32(reinterpret_cast<const uint8_t*>(&r), offsetof(Record, crc));
+    return r;
+}
+
+bool is_valid(const Record& r)
+{
+    return r.magic == SETTINGS_MAGIC && r.crc == crc32(reinterpret_cast<const uint8_t*>(&r), offsetof(Record, crc));
+}
+
+bool is_erased(const uint32_t* words, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (words[i] != 0xFFFFFFFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t sector_offset(uint32_t sector)
+{
+    return region_offset + sector * FLASH_SECTOR_SIZE;
+}
+
+// Read through XIP; the SDK flushes the cache after every program and erase
+const Record* slot(uint32_t sector, uint32_t index)
+{
+    return reinterpret_cast<const Record*>(XIP_BASE + sector_offset(sector)) + index;
+}
+
+bool sector_erased(uint32_t sector)
+{
+    return is_erased(reinterpret_cast<const uint32_t*>(slot(sector, 0)), FLASH_SECTOR_SIZE / 4);
+}
+
+struct ProgramOp
+{
+    uint32_t offset;
+    const uint8_t* data;
+};
+
+void program_page(void* param)
+{
+    const ProgramOp* op = static_cast<const ProgramOp*>(param);
+    flash_range_program(op->offset, op->data, FLASH_PAGE_SIZE);
+}
+
+void erase_one_sector(void* param)
+{
+    flash_range_erase(*static_cast<const uint32_t*>(param), FLASH_SECTOR_SIZE);
+}
+
+// Program count records from slot first onwards, one page at a time. Slots
+// outside the records are written as ones, which leaves them untouched.
+// Returns the number of records written.
+uint32_t program_slots(uint32_t sector, uint32_t first, const Record* records, uint32_t count)
+{
+    Record page[slots_per_page];
+    uint32_t written = 0;
+    while (written < count)
+    {
+        uint32_t in_page = first % slots_per_page;
+        uint32_t n = std::min(count - written, slots_per_page - in_page);
+
+        memset(page, 0xFF, sizeof(page));
+        memcpy(page + in_page, records + written, n * sizeof(Record));
+
+        ProgramOp op = { sector_offset(sector) + (first - in_page) * uint32_t(sizeof(Record)), reinterpret_cast<const uint8_t*>(page) };
+        if (flash_safe_execute(program_page, &op, SETTINGS_FLASH_TIMEOUT_MS) != PICO_OK)
+        {
+            break;
+        }
+        first += n;
+        written += n;
+    }
+    return written;
+}
+
+bool erase_sector(uint32_t sector)
+{
+    uint32_t offset = sector_offset(sector);
+    return flash_safe_execute(erase_one_sector, &offset, SETTINGS_FLASH_TIMEOUT_MS) == PICO_OK;
+}
+
+Entry* find(uint16_t key)
+{
+    for (uint32_t i = 0; i < cache_count; i++)
+    {
+        if (cache[i].key == key)
+        {
+            return &cache[i];
+        }
+    }
+    return nullptr;
+}
+
+Entry* find_or_add(uint16_t key)
+{
+    Entry* e = find(key);
+    if (!e && cache_count < SETTINGS_MAX_KEYS)
+    {
+        e = &cache[cache_count++];
+        *e = { key, false, 0 };
+    }
+    return e;
+}
+
+// Copy every live value into the spare sector. The header goes last, so a
+// power cut part way through leaves the old sector in charge.
+bool rotate()
+{
+    uint32_t target = (active_sector + 1) % SETTINGS_SECTORS;
+    if (!spare_erased)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < cache_count; i++)
+    {
+        staging[i] = make_record(cache[i].key, cache[i].value);
+    }
+    Record header = make_record(KEY_HEADER, sequence + 1);
+    if (program_slots(target, 1, staging, cache_count) != cache_count || program_slots(target, 0, &header, 1) != 1)
+    {
+        // The half-written spare has no header; erase it before trying again
+        spare_erased = false;
+        return false;
+    }
+
+    active_sector = target;
+    sequence++;
+    next_slot = 1 + cache_count;
+    stats.sector = active_sector;
+
+    // The next spare holds stale records from an earlier rotation
+    spare_erased = sector_erased((active_sector + 1) % SETTINGS_SECTORS);
+    return true;
+}
+
+bool commit()
+{
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < cache_count; i++)
+    {
+        if (cache[i].dirty)
+        {
+            staging[n++] = make_record(cache[i].key, cache[i].value);
+        }
+    }
+
+    if (next_slot + n > slots_per_sector)
+    {
+        // A rotation writes every value, dirty ones included
+        return rotate();
+    }
+
+    // Records left dirty by a partial write are written again next time
+    uint32_t written = program_slots(active_sector, next_slot, staging, n);
+    next_slot += written;
+    return written == n;
+}
+
+} // namespace
+
+void init_settings()
+{
+    uint32_t start = time_us_32();
+
+    // Flash is the only truth, as after a reset
+    cache_count = 0;
+    dirty = false;
+    sequence = 0;
+    deferred_us = 0;
+    stats = {};
+
+    // Headers only: the sector with the newest sequence number is the active one
+    bool found = false;
+    for (uint32_t s = 0; s < SETTINGS_SECTORS; s++)
+    {
+        const Record& header = *slot(s, 0);
+        if (is_valid(header) && header.key == KEY_HEADER && (!found || int32_t(header.value - sequence) > 0))
+        {
+            found = true;
+            active_sector = s;
+            sequence = header.value;
+        }
+    }
+
+    if (found)
+    {
+        // Later records override earlier ones; a record torn by a power cut fails its CRC and is skipped
+        next_slot = 1;
+        while (next_slot < slots_per_sector)
+        {
+            const Record& r = *slot(active_sector, next_slot);
+            if (is_erased(reinterpret_cast<const uint32_t*>(&r), sizeof(Record) / 4))
+            {
+                break;
+            }
+            if (is_valid(r) && r.key != KEY_HEADER)
+            {
+                if (Entry* e = find_or_add(r.key))
+                {
+                    e->value = r.value;
+                }
+                stats.records++;
+            }
+            else
+            {
+                stats.torn++;
+            }
+            next_slot++;
+        }
+    }
+    else
+    {
+        // Blank or foreign flash, start a new log
+        active_sector = 0;
+        sequence = 1;
+        next_slot = 1;
+        Record header = make_record(KEY_HEADER, sequence);
+        if (!sector_erased(active_sector))
+        {
+            erase_sector(active_sector);
+        }
+        program_slots(active_sector, 0, &header, 1);
+    }
+    stats.sector = active_sector;
+
+    // Nothing is playing yet, so this is the one time an erase costs nothing
+    uint32_t spare = (active_sector + 1) % SETTINGS_SECTORS;
+    spare_erased = sector_erased(spare) || erase_sector(spare);
+
+    stats.boot_us = time_us_32() - start;
+}
+
+bool get(uint16_t key, uint32_t& value)
+{
+    const Entry* e = find(key);
+    if (e)
+    {
+        value = e->value;
+    }
+    return e != nullptr;
+}
+
+uint32_t get_or(uint16_t key, uint32_t fallback)
+{
+    uint32_t value = fallback;
+    get(key, value);
+    return value;
+}
+
+void set(uint16_t key, uint32_t value)
+{
+    Entry* e = find(key);
+    if (e && e->value == value)
+    {
+        return;
+    }
+    e = e ? e : find_or_add(key);
+    if (!e)
+    {
+        return;
+    }
+
+    e->value = value;
+    e->dirty = true;
+    dirty = true;
+    changed_us = time_us_64();
+}
+
+bool service(bool may_erase)
+{
+    bool touched = false;
+
+    // A gap in the audio beats losing the settings at power off
+    bool overdue = deferred_us && time_us_64() - deferred_us >= SETTINGS_ERASE_WAIT_US;
+    if (!spare_erased && (may_erase || overdue))
+    {
+        spare_erased = erase_sector((active_sector + 1) % SETTINGS_SECTORS);
+        stats.erases_forced += !may_erase;
+        touched = true;
+    }
+
+    if (dirty && time_us_64() - changed_us >= SETTINGS_IDLE_US)
+    {
+        if (commit())
+        {
+            for (uint32_t i = 0; i < cache_count; i++)
+            {
+                cache[i].dirty = false;
+            }
+            dirty = false;
+            deferred_us = 0;
+            stats.commits++;
+            touched = true;
+        }
+        else
+        {
+            // Most likely the active sector is full and the spare still needs erasing
+            changed_us = time_us_64();
+            deferred_us = deferred_us ? deferred_us : changed_us;
+            stats.commits_deferred++;
+        }
+    }
+
+    return touched;
+}
+
+bool get_channel(uint32_t channel, uint32_t& hz)
+{
+    return channel < SETTINGS_CHANNELS && get(uint16_t(KEY_CHANNEL + channel), hz) && hz != 0;
+}
+
+bool set_channel(uint32_t channel, uint32_t hz)
+{
+    if (channel >= SETTINGS_CHANNELS)
+    {
+        return false;
+    }
+    set(uint16_t(KEY_CHANNEL + channel), hz);
+    return true;
+}
+
+absolute_time_t next_service_time()
+{
+    return dirty ? from_us_since_boot(changed_us + SETTINGS_IDLE_US) : at_the_end_of_time;
+}
+
+SettingsStats get_settings_stats()
+{
+    return stats;
+}
+
+} // namespace vfo_settings
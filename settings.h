@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+
+#include "pico/time.h"
+
+// Persistent settings: a log of CRC-checked key/value records in the last
+// SETTINGS_SECTORS sectors of flash. Records are appended to the active sector;
+// when it fills, the live values are copied into the next (already erased)
+// sector and its header, carrying a higher sequence number, is written last.
+// Boot reads the sector headers, then scans only the active sector.
+//
+// Flash erases stall XIP for tens of milliseconds, so they happen at boot
+// (before audio starts) or at run time while the audio output is silent. With
+// the demodulator running the output never is, so once a commit has waited
+// SETTINGS_ERASE_WAIT_US for the spare sector the erase goes ahead anyway, at
+// the cost of one gap in the audio. Page programs take under a millisecond and
+// fit inside the queued audio buffers.
+namespace vfo_settings
+{
+
+#define SETTINGS_SECTORS 4 // settings_flash.ld keeps the image out of them
+#define SETTINGS_MAX_KEYS 48
+#define SETTINGS_IDLE_US 3000000 // Commit once nothing has changed for this long
+#define SETTINGS_ERASE_WAIT_US 10000000 // Longest a commit waits for silence to erase in
+
+enum SettingKey : uint16_t
+{
+    KEY_HEADER = 0, // Sector header, value = sector sequence number
+    KEY_FREQUENCY,
+    KEY_STEP_POWER,
+    KEY_BAND,
+    KEY_CORRECTION, // Si5351 correction, parts per billion
+    KEY_BAND_FREQUENCY = 0x10, // + band index
+    KEY_CHANNEL = 0x20, // + memory channel number, value is the frequency in Hz
+};
+
+#define SETTINGS_CHANNELS 16
+
+struct SettingsStats
+{
+    uint32_t boot_us; // Time taken by init_settings()
+    uint32_t sector; // Active sector
+    uint32_t records; // Records found in the active sector at boot
+    uint32_t torn; // Records skipped at boot for a bad CRC
+    uint32_t commits;
+    uint32_t commits_deferred; // Commits put off because the spare sector could not be erased yet
+    uint32_t erases_forced; // Spare sector erases done while the audio was playing
+};
+
+// Recover the cache from flash, dropping anything held in RAM; call at boot
+// before audio starts
+void init_settings();
+
+bool get(uint16_t key, uint32_t& value);
+uint32_t get_or(uint16_t key, uint32_t fallback);
+
+// Update the cache; the write to flash waits until nothing has changed for SETTINGS_IDLE_US
+void set(uint16_t key, uint32_t value);
+
+// Write pending changes once idle; may_erase allows erasing the spare sector
+// (pass true only while nothing is playing), without it the erase waits until
+// a commit has been held up for SETTINGS_ERASE_WAIT_US. Returns true if flash
+// was touched.
+bool service(bool may_erase);
+
+// Memory channels 0 to SETTINGS_CHANNELS - 1, kept as KEY_CHANNEL + n and
+// committed like any other value. A channel set to 0 Hz is empty.
+bool get_channel(uint32_t channel, uint32_t& hz);
+bool set_channel(uint32_t channel, uint32_t hz); // False if there is no such channel
+
+// When service() next has work to do, or at_the_end_of_time
+absolute_time_t next_service_time();
+
+SettingsStats get_settings_stats();
+
+} // namespace vfo_settings
@@ -0,0 +1,135 @@
+#include "spectrum.h"
+#include "fft.h"
+
+#include <algorithm>
+
+#include "pico-ssd1306/ssd1306.h"
+#include "pico/stdlib.h"
+
+namespace vfo_scope
+{
+
+namespace
+{
+
+using ScopeFft = vfo_dsp::Fft<SCOPE_FFT_SIZE>;
+
+int16_t fft_re[SCOPE_FFT_SIZE];
+int16_t fft_im[SCOPE_FFT_SIZE];
+
+// 4x4 ordered dither thresholds for the waterfall
+constexpr uint8_t bayer[4][4] = {
+    { 0, 8, 2, 10 },
+    { 12, 4, 14, 6 },
+    { 3, 11, 1, 9 },
+    { 15, 7, 13, 5 }
+};
+
+ScopeStats stats = {};
+
+} // namespace
+
+void compute_levels(const int16_t* iq, uint8_t* levels)
+{
+    for (uint32_t n = 0; n < SCOPE_FFT_SIZE; n++)
+    {
+        fft_re[n] = int16_t((iq[n * 2] * ScopeFft::window[n]) >> 15);
+        fft_im[n] = int16_t((iq[n * 2 + 1] * ScopeFft::window[n]) >> 15);
+    }
+    ScopeFft::forward(fft_re, fft_im);
+
+    // 10log10(p) = 3.01 log2(p); log2_q8 gives 256 per octave of power
+    constexpr uint32_t bins_per_column = SCOPE_FFT_SIZE / SCOPE_WIDTH;
+    constexpr uint32_t range_q8 = (SCOPE_RANGE_DB * 256 * 100) / 301;
+    for (uint32_t x = 0; x < SCOPE_WIDTH; x++)
+    {
+        uint32_t peak = 0;
+        for (uint32_t b = 0; b < bins_per_column; b++)
+        {
+            // Shift so DC sits in the middle of the screen
+            uint32_t bin = (x * bins_per_column + b + SCOPE_FFT_SIZE / 2) % SCOPE_FFT_SIZE;
+            uint32_t power = uint32_t(fft_re[bin] * fft_re[bin]) + uint32_t(fft_im[bin] * fft_im[bin]);
+            peak = std::max(peak, power);
+        }
+
+        // Full scale power is 2^30; the bottom of the range sits range_q8 below it
+        int32_t db_q8 = int32_t(vfo_dsp::log2_q8(peak)) - int32_t((30 << 8) - range_q8);
+        levels[x] = uint8_t(std::clamp<int32_t>((db_q8 * 255) / int32_t(range_q8), 0, 255));
+    }
+}
+
+void render_spectrum(uint8_t* fb, uint32_t first_page, uint32_t pages, const uint8_t* levels)
+{
+    const uint32_t height = pages * 8;
+    for (uint32_t x = 0; x < SCOPE_WIDTH; x++)
+    {
+        // Column bitmap for the whole region, bit 0 = top row
+        uint32_t h = (levels[x] * height + 255) / 256;
+        uint64_t column = h ? (~0ull >> (64 - h)) << (height - h) : 0;
+        for (uint32_t p = 0; p < pages; p++)
+        {
+            fb[x + (first_page + p) * SCOPE_WIDTH] = uint8_t(column >> (p * 8));
+        }
+    }
+}
+
+uint32_t Waterfall::push_row(uint8_t* fb, const uint8_t* levels)
+{
+    // Newest row goes above the previous one in display RAM
+    head = (head - 1) & (SCOPE_PAGES * 8 - 1);
+
+    uint32_t page = head >> 3;
+    uint8_t bit = 1 << (head & 7);
+    const uint8_t* dither = bayer[head & 3];
+    uint8_t* row = fb + page * SCOPE_WIDTH;
+    for (uint32_t x = 0; x < SCOPE_WIDTH; x++)
+    {
+        if (levels[x] > dither[x & 3] * 16 + 8)
+        {
+            row[x] |= bit;
+        }
+        else
+        {
+            row[x] &= ~bit;
+        }
+    }
+    return page;
+}
+
+void draw_spectrum_strip(pico_ssd1306::SSD1306& display, const int16_t* iq, uint32_t first_page, uint32_t pages)
+{
+    uint8_t levels[SCOPE_WIDTH];
+
+    uint32_t t0 = time_us_32();
+    compute_levels(iq, levels);
+    uint32_t t1 = time_us_32();
+    render_spectrum(display.getBuffer(), first_page, pages, levels);
+    uint32_t t2 = time_us_32();
+    display.sendPages(first_page, first_page + pages - 1);
+    uint32_t t3 = time_us_32();
+
+    stats = { stats.frames + 1, t1 - t0, t2 - t1, t3 - t2 };
+}
+
+void draw_waterfall(pico_ssd1306::SSD1306& display, Waterfall& waterfall, const int16_t* iq)
+{
+    uint8_t levels[SCOPE_WIDTH];
+
+    uint32_t t0 = time_us_32();
+    compute_levels(iq, levels);
+    uint32_t t1 = time_us_32();
+    uint32_t page = waterfall.push_row(display.getBuffer(), levels);
+    uint32_t t2 = time_us_32();
+    display.sendPages(page, page);
+    display.setStartLine(waterfall.start_line());
+    uint32_t t3 = time_us_32();
+
+    stats = { stats.frames + 1, t1 - t0, t2 - t1, t3 - t2 };
+}
+
+ScopeStats get_scope_stats()
+{
+    return stats;
+}
+
+} // namespace vfo_scope
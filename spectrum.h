@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+
+namespace pico_ssd1306
+{
+class SSD1306;
+}
+
+// Band-scope: FFT of complex I/Q blocks drawn as a spectrum strip or a
+// full-screen waterfall, written directly into the SSD1306 frame buffer pages.
+namespace vfo_scope
+{
+
+#define SCOPE_FFT_SIZE 256
+#define SCOPE_WIDTH 128
+#define SCOPE_PAGES 8
+#define SCOPE_RANGE_DB 60 // Dynamic range mapped onto levels 0-255
+
+struct ScopeStats
+{
+    uint32_t frames;
+    uint32_t fft_us;
+    uint32_t render_us;
+    uint32_t send_us;
+};
+
+// Window and transform SCOPE_FFT_SIZE interleaved I/Q frames, then fold the
+// shifted spectrum (negative frequencies on the left) into SCOPE_WIDTH column
+// levels of 0-255 across SCOPE_RANGE_DB.
+void compute_levels(const int16_t* iq, uint8_t* levels);
+
+// Bar graph into pages [first_page, first_page + pages) of a page-major 1bpp frame buffer
+void render_spectrum(uint8_t* fb, uint32_t first_page, uint32_t pages, const uint8_t* levels);
+
+// Full-screen waterfall scrolled by the display start line, so each new row
+// costs one page write instead of a whole frame.
+class Waterfall
+{
+public:
+    // Draw a new row of levels (ordered dither) and return the page that changed
+    uint32_t push_row(uint8_t* fb, const uint8_t* levels);
+
+    // Start line to show the newest row at the top of the screen
+    uint8_t start_line() const
+    {
+        return head;
+    }
+
+private:
+    uint8_t head = 0;
+};
+
+// Application helpers: compute, draw and send, recording timings
+void draw_spectrum_strip(pico_ssd1306::SSD1306& display, const int16_t* iq, uint32_t first_page, uint32_t pages);
+void draw_waterfall(pico_ssd1306::SSD1306& display, Waterfall& waterfall, const int16_t* iq);
+
+ScopeStats get_scope_stats();
+
+} // namespace vfo_scope
@@ -0,0 +1,157 @@
+#include "sweep.h"
+
+#include <atomic>
+
+#include "event_loop.h"
+#include "hal.h"
+#include "placement.h"
+#include "synth.h"
+
+namespace vfo_sweep
+{
+
+namespace
+{
+
+uint8_t points[SWEEP_MAX_POINTS][SYNTH_POINT_LEN];
+SweepPlan plan = {};
+uint32_t count = 0;
+
+hal_timer_t timer;
+std::atomic<uint32_t> ticks = 0; // Counted by the timer IRQ
+uint32_t handled = 0; // Ticks the radio loop has taken
+uint32_t written = 0; // Points written in this sweep
+bool running = false;
+uint32_t started_us = 0;
+
+StepCallback step_callback = nullptr;
+void* step_user_data = nullptr;
+
+SweepStats stats = {};
+
+bool HOT_FUNC(on_tick)(hal_timer_t*)
+{
+    ticks.fetch_add(1, std::memory_order_relaxed);
+    vfo_loop::post_wake(vfo_loop::WAKE_SWEEP);
+    return true;
+}
+
+void stop()
+{
+    hal_timer_cancel(&timer);
+    running = false;
+}
+
+} // namespace
+
+bool prepare(const SweepPlan& new_plan)
+{
+    if (running || new_plan.step_hz == 0 || new_plan.start_hz > new_plan.stop_hz
+        || new_plan.start_hz < SYNTH_SWEEP_MIN_HZ || new_plan.stop_hz > SYNTH_SWEEP_MAX_HZ)
+    {
+        return false;
+    }
+    uint32_t n = (new_plan.stop_hz - new_plan.start_hz) / new_plan.step_hz + 1;
+    if (n > SWEEP_MAX_POINTS)
+    {
+        return false;
+    }
+
+    plan = new_plan;
+    count = n;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        vfo_synth::pack_sweep_point(point_hz(i), points[i]);
+    }
+    return true;
+}
+
+uint32_t point_count()
+{
+    return count;
+}
+
+uint32_t point_hz(uint32_t index)
+{
+    return plan.start_hz + index * plan.step_hz;
+}
+
+bool start(uint32_t period_us, StepCallback on_step, void* user_data)
+{
+    if (running || count == 0 || period_us < SWEEP_MIN_PERIOD_US)
+    {
+        return false;
+    }
+
+    step_callback = on_step;
+    step_user_data = user_data;
+    ticks.store(0, std::memory_order_relaxed);
+    handled = 0;
+
+    vfo_synth::start_sweep(points[0]);
+    written = 1;
+    stats.points++;
+    started_us = hal_time_us();
+
+    running = hal_timer_every_us(period_us, on_tick, nullptr, &timer);
+    return running;
+}
+
+void cancel()
+{
+    if (running)
+    {
+        stop();
+    }
+}
+
+bool active()
+{
+    return running;
+}
+
+bool service()
+{
+    if (!running)
+    {
+        return false;
+    }
+    uint32_t now = ticks.load(std::memory_order_relaxed);
+    if (now == handled)
+    {
+        return false;
+    }
+    if (now - handled > 1)
+    {
+        // The pace slips; every point is still written and measured in order
+        stats.late++;
+    }
+    handled = now;
+
+    // The point written on the previous tick has had the rest of the period to settle
+    uint32_t last = written - 1;
+    if (step_callback)
+    {
+        step_callback(last, point_hz(last), step_user_data);
+    }
+
+    if (written == count)
+    {
+        stop();
+        stats.sweeps++;
+        stats.last_us = hal_time_us() - started_us;
+        return true;
+    }
+
+    vfo_synth::write_sweep_point(points[written]);
+    written++;
+    stats.points++;
+    return true;
+}
+
+SweepStats get_sweep_stats()
+{
+    return stats;
+}
+
+} // namespace vfo_sweep
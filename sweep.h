@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+
+// Frequency sweeps on CLK0, for antenna and filter measurements.
+// prepare() works out the multisynth burst of every point up front (synth.h);
+// a running sweep then writes one burst per timer tick from the radio loop,
+// with no maths and no register reads in between. The step callback for a
+// point runs on the tick after the one that wrote it, just before the next
+// point goes out: the output has had the period less the burst to settle.
+namespace vfo_sweep
+{
+
+#define SWEEP_MAX_POINTS 1024
+#define SWEEP_MIN_PERIOD_US 2000 // One 9 byte burst takes 1.9 ms on the 48 kHz bus
+
+struct SweepPlan
+{
+    uint32_t start_hz;
+    uint32_t stop_hz; // Last point, if step_hz lands on it
+    uint32_t step_hz;
+};
+
+typedef void (*StepCallback)(uint32_t index, uint32_t hz, void* user_data);
+
+struct SweepStats
+{
+    uint32_t sweeps; // Run to the end
+    uint32_t points; // Bursts written
+    uint32_t late; // Ticks that came before the radio loop had taken the previous one
+    uint32_t last_us; // Length of the last complete sweep
+};
+
+// Fills the point table; false if the plan leaves SYNTH_SWEEP_MIN_HZ to
+// SYNTH_SWEEP_MAX_HZ or has more than SWEEP_MAX_POINTS points. Not while running.
+bool prepare(const SweepPlan& plan);
+uint32_t point_count();
+uint32_t point_hz(uint32_t index);
+
+// The rest is for the radio loop, which owns the synthesizer. start() moves
+// CLK0 to the first point; at the end (or cancel()) the caller tunes back.
+bool start(uint32_t period_us, StepCallback on_step, void* user_data);
+void cancel();
+bool active();
+
+// Call on every pass; returns true if it wrote or measured a point
+bool service();
+
+SweepStats get_sweep_stats();
+
+} // namespace vfo_sweep
@@ -0,0 +1,163 @@
+#include "synth.h"
+#include "placement.h"
+
+#include <array>
+#include <cstring>
+
+extern "C" {
+#include "si5351/si5351.h"
+
+// Not exported by si5351.h, but the register image must match what the driver would write
+uint64_t pll_calc(enum si5351_pll, uint64_t, struct Si5351RegSet*, int32_t, uint8_t);
+uint64_t multisynth_calc(uint64_t, uint64_t, struct Si5351RegSet*);
+}
+
+namespace vfo_synth
+{
+
+namespace
+{
+
+// Offsets of each parameter block inside the burst
+constexpr uint32_t plla_offset = SI5351_PLLA_PARAMETERS - SYNTH_BURST_FIRST;
+constexpr uint32_t pllb_offset = SI5351_PLLB_PARAMETERS - SYNTH_BURST_FIRST;
+constexpr uint32_t ms0_offset = SI5351_CLK0_PARAMETERS - SYNTH_BURST_FIRST;
+#if VFO_QUADRATURE
+constexpr uint32_t ms1_offset = SI5351_CLK1_PARAMETERS - SYNTH_BURST_FIRST;
+#endif
+
+uint8_t images[vfo_band::bands.size()][SYNTH_BURST_LEN];
+uint32_t current_band = 0;
+
+// Multisynth divider each band tunes with
+constexpr std::array<uint16_t, vfo_band::bands.size()> dividers = [] {
+    std::array<uint16_t, vfo_band::bands.size()> d = {};
+    for (uint32_t i = 0; i < d.size(); i++)
+    {
+        const vfo_band::Band& band = vfo_band::bands[i];
+        d[i] = VFO_QUADRATURE && band.quad_divider ? band.quad_divider : band.ms_divider;
+    }
+    return d;
+}();
+
+// Same layout for PLL and multisynth parameter blocks; high_bits fills the top of the third byte
+void HOT_FUNC(pack_params)(const Si5351RegSet& reg, uint8_t* out, uint8_t high_bits)
+{
+    out[0] = uint8_t(reg.p3 >> 8);
+    out[1] = uint8_t(reg.p3);
+    out[2] = uint8_t(high_bits | ((reg.p1 >> 16) & 0x03));
+    out[3] = uint8_t(reg.p1 >> 8);
+    out[4] = uint8_t(reg.p1);
+    out[5] = uint8_t(((reg.p3 >> 12) & 0xF0) | ((reg.p2 >> 16) & 0x0F));
+    out[6] = uint8_t(reg.p2 >> 8);
+    out[7] = uint8_t(reg.p2);
+}
+
+void HOT_FUNC(pack_plla)(uint32_t band, uint32_t hz, uint8_t* out)
+{
+    Si5351RegSet reg;
+    uint64_t vco = uint64_t(hz) * dividers[band] * SI5351_FREQ_MULT;
+    pll_calc(SI5351_PLLA, vco, &reg, get_correction(SI5351_PLL_INPUT_XO), 0);
+    pack_params(reg, out, 0);
+}
+
+} // namespace
+
+void init_synth()
+{
+    // PLLB is not used for tuning; keep it at the driver's fixed frequency
+    Si5351RegSet pllb;
+    pll_calc(SI5351_PLLB, SI5351_PLL_FIXED, &pllb, get_correction(SI5351_PLL_INPUT_XO), 0);
+
+    for (uint32_t i = 0; i < vfo_band::bands.size(); i++)
+    {
+        const vfo_band::Band& band = vfo_band::bands[i];
+
+        // Even integer divider: a = divider, b = 0, c = 1; R divider 1, no divide-by-4
+        Si5351RegSet ms = { 128u * dividers[i] - 512, 0, 1 };
+
+        pack_plla(i, band.default_hz, images[i] + plla_offset);
+        pack_params(pllb, images[i] + pllb_offset, 0);
+        pack_params(ms, images[i] + ms0_offset, 0);
+#if VFO_QUADRATURE
+        pack_params(ms, images[i] + ms1_offset, 0);
+#endif
+    }
+}
+
+void select_band(uint32_t band_index, uint32_t hz)
+{
+    const vfo_band::Band& band = vfo_band::bands[band_index];
+    current_band = band_index;
+
+    uint8_t* image = images[band_index];
+    pack_plla(band_index, hz, image + plla_offset);
+    si5351_write_bulk(SYNTH_BURST_FIRST, SYNTH_BURST_LEN, image);
+
+    // Powered up, integer mode, PLLA, own multisynth as source
+    uint8_t control = SI5351_CLK_INTEGER_MODE | SI5351_CLK_INPUT_MULTISYNTH_N | uint8_t(band.drive);
+#if VFO_QUADRATURE
+    // Q the same from the same PLL, delayed by divider quarter VCO periods
+    uint8_t controls[2] = { control, band.quad_divider ? control : uint8_t(SI5351_CLK_POWERDOWN) };
+    si5351_write_bulk(SI5351_CLK0_CTRL, 2, controls);
+    uint8_t offsets[2] = { 0, uint8_t(band.quad_divider) };
+    si5351_write_bulk(SI5351_CLK0_PHASE_OFFSET, 2, offsets);
+#else
+    si5351_write(SI5351_CLK0_CTRL, control);
+#endif
+
+    // Starts the multisynths together, which sets the quadrature phase
+    pll_reset(SI5351_PLLA);
+}
+
+void HOT_FUNC(set_frequency)(uint32_t hz)
+{
+    uint8_t params[SI5351_PARAMETERS_LENGTH];
+    pack_plla(current_band, hz, params);
+    si5351_write_bulk(SI5351_PLLA_PARAMETERS, SI5351_PARAMETERS_LENGTH, params);
+}
+
+uint32_t get_band()
+{
+    return current_band;
+}
+
+void pack_sweep_point(uint32_t hz, uint8_t* out)
+{
+    Si5351RegSet reg;
+    multisynth_calc(uint64_t(hz) * SI5351_FREQ_MULT, SYNTH_SWEEP_VCO_HZ * SI5351_FREQ_MULT, &reg);
+    pack_params(reg, out, 0);
+}
+
+void start_sweep(const uint8_t* first_point)
+{
+    // The multisynth leaves integer mode first: the band's even divider is
+    // still valid in fractional mode, so the output only moves with the burst
+    const vfo_band::Band& band = vfo_band::bands[current_band];
+    uint8_t control = SI5351_CLK_INPUT_MULTISYNTH_N | uint8_t(band.drive);
+#if VFO_QUADRATURE
+    // Q would follow PLLA to somewhere else; select_band() brings it back
+    uint8_t controls[2] = { control, SI5351_CLK_POWERDOWN };
+    si5351_write_bulk(SI5351_CLK0_CTRL, 2, controls);
+#else
+    si5351_write(SI5351_CLK0_CTRL, control);
+#endif
+
+    // PLLA, PLLB and MS0 in one burst, as select_band() writes them
+    uint8_t image[SYNTH_BURST_LEN];
+    memcpy(image, images[current_band], SYNTH_BURST_LEN);
+    Si5351RegSet pll;
+    pll_calc(SI5351_PLLA, SYNTH_SWEEP_VCO_HZ * SI5351_FREQ_MULT, &pll, get_correction(SI5351_PLL_INPUT_XO), 0);
+    pack_params(pll, image + plla_offset, 0);
+    memcpy(image + ms0_offset, first_point, SYNTH_POINT_LEN);
+    si5351_write_bulk(SYNTH_BURST_FIRST, SYNTH_BURST_LEN, image);
+
+    pll_reset(SI5351_PLLA);
+}
+
+void HOT_FUNC(write_sweep_point)(const uint8_t* point)
+{
+    si5351_write_bulk(SI5351_CLK0_PARAMETERS, SYNTH_POINT_LEN, const_cast<uint8_t*>(point));
+}
+
+} // namespace vfo_synth
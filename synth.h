@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+
+#include "band_plan.h"
+
+// Si5351 CLK0 driven from the band plan.
+// Each band's register image (PLLA, PLLB and multisynth 0, registers 26-49) is
+// prepared once at start-up, so a band change is one I2C burst plus the CLK0
+// control byte and a PLL reset. Tuning inside a band only rewrites the eight
+// PLLA registers, as the multisynth divider stays fixed.
+//
+// With VFO_QUADRATURE, CLK1 is the Q output for a quadrature sampling
+// detector, 90 degrees behind CLK0 (I). Multisynth 1 joins the image with the
+// same divider from PLLA, the band's quad_divider; its phase offset is that
+// divider. A band change writes both control bytes and both offsets, then the
+// one PLLA reset that lines the two dividers up. Tuning inside the band still
+// only moves PLLA: both dividers count the same VCO edges, so the pair keeps
+// its phase without another reset. Below 4.8 MHz no divider that fits the
+// offset register keeps the VCO at 600 MHz or more (band_plan.h), so those
+// bands run CLK0 alone with CLK1 powered down.
+namespace vfo_synth
+{
+
+#ifndef VFO_QUADRATURE
+#define VFO_QUADRATURE 0
+#endif
+
+#define SYNTH_BURST_FIRST 26 // SI5351_PLLA_PARAMETERS
+#if VFO_QUADRATURE
+#define SYNTH_BURST_LEN 32 // PLLA, PLLB, MS0 and MS1 parameter blocks
+#else
+#define SYNTH_BURST_LEN 24 // PLLA, PLLB and MS0 parameter blocks
+#endif
+
+// Call after si5351_init(); builds the register image for every band
+void init_synth();
+
+// Switch to band_index and tune to hz within it
+void select_band(uint32_t band_index, uint32_t hz);
+
+// Retune within the current band
+void set_frequency(uint32_t hz);
+
+uint32_t get_band();
+
+// Sweeping (sweep.h): PLLA parked at SYNTH_SWEEP_VCO_HZ and a fractional
+// multisynth 0, so every point is one 8 byte MS0 burst worked out in advance.
+// The sweep range is what that multisynth reaches from the fixed VCO.
+// select_band() returns to tuning.
+#define SYNTH_SWEEP_VCO_HZ 800000000ull
+#define SYNTH_SWEEP_MIN_HZ 1000000
+#define SYNTH_SWEEP_MAX_HZ 100000000
+#define SYNTH_POINT_LEN 8 // SI5351_PARAMETERS_LENGTH
+
+// MS0 registers (42-49) for hz; no I2C
+void pack_sweep_point(uint32_t hz, uint8_t* out);
+
+// Switch CLK0 to the sweep set-up, on the first point; CLK1 powers down
+void start_sweep(const uint8_t* first_point);
+
+// One burst, nothing recomputed
+void write_sweep_point(const uint8_t* point);
+
+} // namespace vfo_synth
@@ -0,0 +1,58 @@
+#include "trace.h"
+
+#include <atomic>
+#include <cstdio>
+
+#include "hal.h"
+#include "placement.h"
+#include "pico/stdio.h"
+
+namespace vfo_trace
+{
+
+namespace
+{
+
+struct Record
+{
+    uint32_t time_us;
+    uint32_t event; // 0 for a slot not yet written
+    uint32_t arg;
+};
+
+Record records[TRACE_BUFFER_LEN];
+
+// Claimed with fetch_add, so IRQs that preempt a writer take the next slot
+std::atomic<uint32_t> head = 0;
+
+} // namespace
+
+void dump()
+{
+#if VFO_TRACE
+    uint32_t end = head.load(std::memory_order_acquire);
+    uint32_t start = end > TRACE_BUFFER_LEN ? end - TRACE_BUFFER_LEN : 0;
+    char line[40];
+    for (uint32_t i = start; i < end; i++)
+    {
+        const Record& r = records[i & (TRACE_BUFFER_LEN - 1)];
+        if (r.event != 0)
+        {
+            int len = snprintf(line, sizeof(line), "#T %lu %lu %lu", (unsigned long)r.time_us, (unsigned long)r.event,
+                (unsigned long)r.arg);
+            stdio_put_string(line, len, true, false);
+        }
+    }
+#endif
+    stdio_put_string("#T end", 6, true, false);
+}
+
+} // namespace vfo_trace
+
+#if VFO_TRACE
+extern "C" void HOT_FUNC(trace_record)(uint32_t event, uint32_t arg)
+{
+    uint32_t slot = vfo_trace::head.fetch_add(1, std::memory_order_relaxed) & (TRACE_BUFFER_LEN - 1);
+    vfo_trace::records[slot] = { hal_time_us(), event, arg };
+}
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+
+// Latency trace points: TRACE(event, arg) stores a timestamped record in a
+// ring buffer. It is safe from any IRQ and costs a few dozen cycles; with
+// VFO_TRACE=0 (the firmware default) it compiles to nothing.
+// The CAT command TD; dumps the buffer; host/trace_latency reads the dump.
+// C linkage, so the C drivers (si5351.c) can record too.
+
+#ifndef VFO_TRACE
+#define VFO_TRACE 0
+#endif
+
+#define TRACE_BUFFER_LEN 512 // Records, a power of two
+
+enum trace_event
+{
+    TRACE_ENCODER = 1, // Encoder IRQ; arg = steps (GPIO) or raw count (PIO)
+    TRACE_PICKUP, // Main loop takes the rotation; arg = detents
+    TRACE_SI5351_WRITE, // Register burst written; arg = first register << 8 | length
+    TRACE_DISPLAY_SENT, // Frame or pages sent to the display; arg = pages
+};
+
+#if VFO_TRACE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void trace_record(uint32_t event, uint32_t arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define TRACE(event, arg) trace_record((event), (uint32_t)(arg))
+
+#else
+
+#define TRACE(event, arg) ((void)0)
+
+#endif
+
+#ifdef __cplusplus
+namespace vfo_trace
+{
+
+// Write the buffered records, oldest first, one "#T <time_us> <event> <arg>"
+// line each over USB stdio, then "#T end". Blocks until written.
+void dump();
+
+} // namespace vfo_trace
+#endif
@@ -0,0 +1,49 @@
+#include "tuning_rate.h"
+
+#include <cstdlib>
+
+namespace vfo_input
+{
+
+uint32_t TuningRate::lookup(uint32_t detents_per_sec) const
+{
+    uint32_t m = 1;
+    for (const AccelPoint& point : curve)
+    {
+        if (detents_per_sec < point.detents_per_sec)
+        {
+            break;
+        }
+        m = point.multiplier;
+    }
+    return m;
+}
+
+uint32_t TuningRate::update(int32_t detents, uint32_t now_us)
+{
+    if (detents == 0)
+    {
+        return multiplier;
+    }
+
+    uint32_t count = uint32_t(std::abs(detents));
+    int32_t direction = detents > 0 ? 1 : -1;
+    uint32_t elapsed = now_us - last_us;
+    last_us = now_us;
+
+    // Start over after a pause or a change of direction
+    if (elapsed > TUNING_IDLE_US || direction != last_direction || interval_us == 0)
+    {
+        interval_us = elapsed > TUNING_IDLE_US ? 0 : elapsed / count;
+    }
+    else
+    {
+        interval_us = (interval_us * 3 + elapsed / count) / 4;
+    }
+    last_direction = direction;
+
+    multiplier = interval_us ? lookup(1000000 / interval_us) : 1;
+    return multiplier;
+}
+
+} // namespace vfo_input
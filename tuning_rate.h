@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+// Velocity-adaptive tuning: the faster the dial turns, the bigger each detent's step.
+// Velocity comes from the spacing of detent timestamps (time_us_32), smoothed
+// over a few detents; all arithmetic is integer.
+namespace vfo_input
+{
+
+// Spins slower than this many detents per second, or after this long idle, run at 1x
+#define TUNING_IDLE_US 250000
+
+struct AccelPoint
+{
+    uint16_t detents_per_sec; // Lowest speed this multiplier applies from
+    uint16_t multiplier;
+};
+
+// 1-2-5 multipliers so accelerated steps land on round frequencies
+inline constexpr AccelPoint default_accel_curve[] = {
+    { 0, 1 },
+    { 6, 2 },
+    { 12, 5 },
+    { 20, 10 },
+    { 30, 20 },
+    { 45, 50 }
+};
+
+class TuningRate
+{
+public:
+    // curve must be sorted by detents_per_sec and start at 0; a single { 0, 1 }
+    // point turns acceleration off
+    void set_curve(std::span<const AccelPoint> c)
+    {
+        curve = c;
+    }
+
+    // Record detents turned at now_us and return the step multiplier for them.
+    // When it is above 1 the caller snaps to a multiple of the effective step.
+    uint32_t update(int32_t detents, uint32_t now_us);
+
+    // Current multiplier, for display
+    uint32_t get_multiplier() const
+    {
+        return multiplier;
+    }
+
+private:
+    uint32_t lookup(uint32_t detents_per_sec) const;
+
+    std::span<const AccelPoint> curve = default_accel_curve;
+    uint32_t last_us = 0;
+    uint32_t interval_us = 0; // Smoothed time per detent, 0 when idle
+    int32_t last_direction = 0;
+    uint32_t multiplier = 1;
+};
+
+} // namespace vfo_input